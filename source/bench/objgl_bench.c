@@ -0,0 +1,520 @@
+/*
+ * End-to-end benchmark of objgl2_readobj (buffer and file streams) and the legacy objgl_loadObj
+ * over a deterministic, synthetic OBJ corpus.
+ *
+ * cc -O2 source/bench/objgl_bench.c source/objgl2/objgl2.c source/objgl.c -o objgl_bench
+ *
+ * ./objgl_bench [--scale N] [--repeat N] [--case name] [--tmp path] [--emit name path]
+ * ./objgl_bench --huge [N] [--pad N] [--tmp path]
+ *
+ * Every measured (case, loader) pair is printed as one JSON object per line, so the output
+ * can be stored and diffed against the previous release.
+ * Allocation counting interposes malloc and friends, so it only works with glibc.
+ *
+ * --huge writes N million triangles over a grid of 1M vertices (--pad adds a comment of that many bytes to each)
+ * and loads the file as a single mmap'd buffer stream. It's for the OBJGL_64BIT_IMPL=1 build only, the default N
+ * is just over 4G indices and takes tens of GB of memory, a padded small N gets past 4GB of buffer with much less.
+ */
+#define _GNU_SOURCE
+#include "../objgl2/objgl2.h"
+#include "../objgl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static unsigned long long _benchallocs;
+static long long _benchbytes, _benchpeak;
+
+static void objgl_bench_track(void *ptr, long long oldsize){
+	if(ptr){
+		_benchbytes += (long long)malloc_usable_size(ptr) - oldsize;
+		_benchpeak = _benchbytes > _benchpeak ? _benchbytes : _benchpeak;
+		++_benchallocs;
+	}
+}
+
+void *malloc(size_t size){
+	void *ptr = __libc_malloc(size);
+	objgl_bench_track(ptr, 0);
+	return ptr;
+}
+
+void *calloc(size_t num, size_t size){
+	void *ptr = __libc_calloc(num, size);
+	objgl_bench_track(ptr, 0);
+	return ptr;
+}
+
+void *realloc(void *ptr, size_t size){
+	long long oldsize = ptr ? (long long)malloc_usable_size(ptr) : 0;
+	void *newptr = __libc_realloc(ptr, size);
+	objgl_bench_track(newptr, oldsize);
+	return newptr;
+}
+
+void free(void *ptr){
+	if(ptr){
+		_benchbytes -= (long long)malloc_usable_size(ptr);
+	}
+	__libc_free(ptr);
+}
+#define OBJGL_BENCH_ALLOCS 1
+#else
+#define OBJGL_BENCH_ALLOCS 0
+#endif
+
+typedef struct{
+	const char *name;
+	unsigned int numVertices, numFaces; //multiplied by --scale
+	unsigned int minArity, maxArity;
+	char hasTexcoords, hasNormals;
+	unsigned int negativePercent; //chance of a face using relative (negative) indices
+	unsigned int numMaterials, materialSwitch; //usemtl every materialSwitch faces, 0 means never
+	unsigned int commentPercent, commentLen; //chance of a comment before a line and its average length
+} objgl_benchcase;
+
+static const objgl_benchcase benchcases[] = {
+	{"tri_ptn", 100000, 200000, 3, 3, 1, 1, 0, 0, 0, 0, 0},
+	{"tri_p", 100000, 200000, 3, 3, 0, 0, 0, 0, 0, 0, 0},
+	{"quad_pt", 100000, 100000, 4, 4, 1, 0, 0, 0, 0, 0, 0},
+	{"ngon_pn", 100000, 60000, 3, 8, 0, 1, 0, 0, 0, 0, 0},
+	{"negative_ptn", 100000, 200000, 3, 3, 1, 1, 50, 0, 0, 0, 0},
+	{"materials_frequent", 100000, 200000, 3, 3, 1, 1, 0, 2000, 4, 0, 0},
+	{"comments_long", 100000, 200000, 3, 3, 1, 1, 0, 16, 5000, 30, 200}
+};
+
+typedef struct{
+	char *data;
+	size_t len, res;
+} objgl_benchbuffer;
+
+typedef struct{
+	unsigned long long allocs;
+	long long peakHeap;
+	unsigned int numIndices, numVertices;
+	objgl2Stats stats; //zeroed for the legacy loader
+} objgl_benchresult;
+
+static unsigned long long benchseed;
+
+//splitmix64, the corpus must be identical on every machine
+static unsigned long long objgl_bench_rand(void){
+	unsigned long long z = (benchseed += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static unsigned int objgl_bench_range(unsigned int min, unsigned int max){
+	return min + (unsigned int)(objgl_bench_rand() % (unsigned long long)(max - min + 1));
+}
+
+static void objgl_bench_reserve(objgl_benchbuffer *buf, size_t len){
+	if(buf->len + len + 1 > buf->res){
+		buf->res += buf->res + len + 1;
+		buf->data = (char*)realloc(buf->data, buf->res);
+	}
+}
+
+static void objgl_bench_append(objgl_benchbuffer *buf, const char *str, size_t len){
+	objgl_bench_reserve(buf, len);
+	memcpy(buf->data + buf->len, str, len);
+	buf->len += len;
+	buf->data[buf->len] = '\0';
+}
+
+static void objgl_bench_comment(objgl_benchbuffer *buf, const objgl_benchcase *c){
+	if(!c->commentPercent || objgl_bench_range(1, 100) > c->commentPercent){
+		return;
+	}
+
+	unsigned int len = objgl_bench_range(1, c->commentLen * 2);
+	objgl_bench_reserve(buf, len + 3);
+	buf->data[buf->len++] = '#';
+	buf->data[buf->len++] = ' ';
+
+	for(unsigned int i = 0; i < len; ++i){
+		buf->data[buf->len++] = 'a' + (char)(i % 26);
+	}
+
+	buf->data[buf->len++] = '\n';
+	buf->data[buf->len] = '\0';
+}
+
+static float objgl_bench_float(float min, float max){
+	return min + (max - min) * (float)(objgl_bench_rand() >> 40) / (float)(1 << 24);
+}
+
+static objgl_benchbuffer objgl_bench_generate(const objgl_benchcase *c, unsigned int scale){
+	objgl_benchbuffer buf = {0};
+	char line[256];
+	unsigned int numVertices = c->numVertices * scale;
+	unsigned int numFaces = c->numFaces * scale;
+
+	benchseed = 0x6F626A676C32ULL;
+
+	const char *header = "# objgl synthetic benchmark corpus\no bench\n";
+	objgl_bench_append(&buf, header, strlen(header));
+
+	for(unsigned int i = 0; i < numVertices; ++i){
+		objgl_bench_comment(&buf, c);
+		int len = snprintf(line, sizeof(line), "v %f %f %f\n", objgl_bench_float(-100, 100), objgl_bench_float(-100, 100), objgl_bench_float(-100, 100));
+		objgl_bench_append(&buf, line, len);
+
+		if(c->hasTexcoords){
+			len = snprintf(line, sizeof(line), "vt %f %f\n", objgl_bench_float(0, 1), objgl_bench_float(0, 1));
+			objgl_bench_append(&buf, line, len);
+		}
+
+		if(c->hasNormals){
+			len = snprintf(line, sizeof(line), "vn %f %f %f\n", objgl_bench_float(-1, 1), objgl_bench_float(-1, 1), objgl_bench_float(-1, 1));
+			objgl_bench_append(&buf, line, len);
+		}
+	}
+
+	for(unsigned int f = 0; f < numFaces; ++f){
+		objgl_bench_comment(&buf, c);
+
+		if(c->materialSwitch && f % c->materialSwitch == 0){
+			int len = snprintf(line, sizeof(line), "usemtl material_%u\n", objgl_bench_range(0, c->numMaterials - 1));
+			objgl_bench_append(&buf, line, len);
+		}
+
+		unsigned int arity = objgl_bench_range(c->minArity, c->maxArity);
+		char negative = c->negativePercent && objgl_bench_range(1, 100) <= c->negativePercent;
+		//faces reference vertices close to each other, just like the real meshes do
+		long long base = (long long)f * numVertices / numFaces;
+
+		objgl_bench_append(&buf, "f", 1);
+
+		for(unsigned int i = 0; i < arity; ++i){
+			long long index = base + (long long)objgl_bench_range(0, 32) - 16;
+			index = index < 0 ? 0 : index >= numVertices ? numVertices - 1 : index;
+			long long written = negative ? index - numVertices : index + 1;
+			int len;
+
+			if(c->hasTexcoords && c->hasNormals){
+				len = snprintf(line, sizeof(line), " %lld/%lld/%lld", written, written, written);
+			} else if(c->hasTexcoords){
+				len = snprintf(line, sizeof(line), " %lld/%lld", written, written);
+			} else if(c->hasNormals){
+				len = snprintf(line, sizeof(line), " %lld//%lld", written, written);
+			} else{
+				len = snprintf(line, sizeof(line), " %lld", written);
+			}
+
+			objgl_bench_append(&buf, line, len);
+		}
+
+		objgl_bench_append(&buf, "\n", 1);
+	}
+
+	return buf;
+}
+
+static double objgl_bench_now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+enum{
+	OBJGL_BENCH_BUFFERSTREAM,
+	OBJGL_BENCH_FILESTREAM,
+	OBJGL_BENCH_LEGACY
+};
+
+static const char *loadernames[] = {"objgl2_bufferstream", "objgl2_filestream", "objgl_loadObj"};
+
+static objgl_benchresult objgl_bench_load(int loader, const objgl_benchbuffer *buf, const char *tmpfile){
+	objgl_benchresult result = {0};
+
+	if(loader == OBJGL_BENCH_LEGACY){
+		ObjGLData data = objgl_loadObj(buf->data);
+		result.numIndices = data.numIndices;
+		result.numVertices = data.numVertices;
+		objgl_delete(&data);
+	} else{
+		objgl2StreamInfo strinfo = loader == OBJGL_BENCH_FILESTREAM ? objgl2_init_filestream((char*)tmpfile, 65536) : objgl2_init_bufferstream(buf->data);
+		objgl2LoadOptions options = {0};
+		options.stats = &result.stats;
+		objgl2Data data = objgl2_readobj_ex(&strinfo, &options);
+		result.numIndices = data.numIndices;
+		result.numVertices = data.numVertices;
+		objgl2_deleteobj(&data);
+		objgl2_deletestream(&strinfo);
+	}
+
+	return result;
+}
+
+static int objgl_bench_cmp(const void *a, const void *b){
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+//loads once in a child process, so the peak RSS and the allocations belong to that load only
+static objgl_benchresult objgl_bench_measure(int loader, const objgl_benchbuffer *buf, const char *tmpfile, long *maxrss){
+	objgl_benchresult result = {0};
+	int fds[2];
+	*maxrss = -1;
+
+	if(pipe(fds)){
+		return result;
+	}
+
+	pid_t pid = fork();
+
+	if(pid == 0){
+		close(fds[0]);
+#if OBJGL_BENCH_ALLOCS
+		_benchallocs = 0;
+		_benchpeak = _benchbytes = 0;
+#endif
+		result = objgl_bench_load(loader, buf, tmpfile);
+#if OBJGL_BENCH_ALLOCS
+		result.allocs = _benchallocs;
+		result.peakHeap = _benchpeak;
+#endif
+		ssize_t written = write(fds[1], &result, sizeof(result));
+		_exit(written != sizeof(result));
+	}
+
+	close(fds[1]);
+
+	if(read(fds[0], &result, sizeof(result)) != sizeof(result)){
+		result = (objgl_benchresult){0};
+	}
+
+	close(fds[0]);
+
+	struct rusage usage;
+	int status;
+
+	if(pid > 0 && wait4(pid, &status, 0, &usage) == pid){
+		*maxrss = usage.ru_maxrss;
+	}
+
+	return result;
+}
+
+#define OBJGL_BENCH_GRID 1024
+
+static void objgl_bench_flush(objgl_benchbuffer *buf, FILE *f){
+	fwrite(buf->data, 1, buf->len, f);
+	buf->len = 0;
+}
+
+//streamed to the file, the corpus doesn't fit into memory next to the loaded mesh
+static int objgl_bench_writehuge(const char *tmpfile, unsigned long long numFaces, unsigned int pad){
+	FILE *f = fopen(tmpfile, "wb");
+	objgl_benchbuffer buf = {0};
+	char line[256];
+
+	if(!f){
+		return 0;
+	}
+
+	objgl_bench_append(&buf, "o huge\n", 7);
+
+	for(unsigned int y = 0; y < OBJGL_BENCH_GRID; ++y){
+		for(unsigned int x = 0; x < OBJGL_BENCH_GRID; ++x){
+			int len = snprintf(line, sizeof(line), "v %u %u 0\n", x, y);
+			objgl_bench_append(&buf, line, len);
+		}
+
+		objgl_bench_flush(&buf, f);
+	}
+
+	unsigned long long cells = (OBJGL_BENCH_GRID - 1) * (OBJGL_BENCH_GRID - 1);
+
+	for(unsigned long long t = 0; t < numFaces; ++t){
+		unsigned long long cell = (t / 2) % cells;
+		unsigned long long a = cell / (OBJGL_BENCH_GRID - 1) * OBJGL_BENCH_GRID + cell % (OBJGL_BENCH_GRID - 1) + 1;
+		int len = t & 1 ? snprintf(line, sizeof(line), "f %llu %llu %llu\n", a + 1, a + OBJGL_BENCH_GRID + 1, a + OBJGL_BENCH_GRID) :
+			snprintf(line, sizeof(line), "f %llu %llu %llu\n", a, a + 1, a + OBJGL_BENCH_GRID);
+		objgl_bench_append(&buf, line, len);
+
+		if(pad){
+			objgl_bench_reserve(&buf, pad + 2);
+			buf.data[buf.len++] = '#';
+			memset(buf.data + buf.len, 'a', pad);
+			buf.len += pad;
+			buf.data[buf.len++] = '\n';
+		}
+
+		if(buf.len > (1 << 20)){
+			objgl_bench_flush(&buf, f);
+		}
+	}
+
+	//the buffer stream stops at the terminator
+	objgl_bench_append(&buf, "", 1);
+	objgl_bench_flush(&buf, f);
+	free(buf.data);
+
+	return !fclose(f);
+}
+
+static int objgl_bench_huge(const char *tmpfile, unsigned long long numFaces, unsigned int pad){
+	if(sizeof(objgl2Size) < 8){
+		fprintf(stderr, "--huge needs the OBJGL_64BIT_IMPL=1 build\n");
+		return 1;
+	}
+
+	unsigned long long cells = (OBJGL_BENCH_GRID - 1) * (OBJGL_BENCH_GRID - 1);
+	double start = objgl_bench_now();
+
+	if(!objgl_bench_writehuge(tmpfile, numFaces, pad)){
+		fprintf(stderr, "can't write %s\n", tmpfile);
+		return 1;
+	}
+
+	double written = objgl_bench_now();
+	int fd = open(tmpfile, O_RDONLY);
+	off_t size = fd < 0 ? -1 : lseek(fd, 0, SEEK_END);
+	//private and writable, the pages come from the page cache instead of the heap
+	char *data = size > 0 ? (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : (char*)MAP_FAILED;
+
+	if(data == MAP_FAILED){
+		fprintf(stderr, "can't map %s\n", tmpfile);
+		return 1;
+	}
+
+	objgl2StreamInfo strinfo = objgl2_init_bufferstream(data);
+	objgl2LoadOptions options = {0};
+	objgl2Stats stats = {0};
+	objgl2Error error = {0};
+	options.stats = &stats;
+	options.error = &error;
+	objgl2Data obj = objgl2_readobj_ex(&strinfo, &options);
+	double loaded = objgl_bench_now();
+	unsigned long long numIndices = obj.numIndices, numVertices = obj.numVertices;
+	//every byte parsed, no index lost past 4G, a run over the whole grid references all of it
+	int ok = error.code == OBJGL2_OK && stats.bytesRead == (unsigned long long)size - 1 && numIndices == numFaces * 3 &&
+		numVertices <= OBJGL_BENCH_GRID * OBJGL_BENCH_GRID && (numFaces < 2 * cells || numVertices == OBJGL_BENCH_GRID * OBJGL_BENCH_GRID);
+
+	printf("{\"case\":\"huge\",\"loader\":\"objgl2_bufferstream\",\"bytes\":%lld,\"indices\":%llu,\"vertices\":%llu,\"bytes_read\":%llu,"
+		"\"ok\":%d,\"write_s\":%.3f,\"seconds\":%.3f,\"mb_per_s\":%.2f}\n",
+		(long long)size, numIndices, numVertices, (unsigned long long)stats.bytesRead,
+		ok, written - start, loaded - written, size / (loaded - written) / (1024.0 * 1024.0));
+
+	objgl2_deleteobj(&obj);
+	munmap(data, size);
+	close(fd);
+	remove(tmpfile);
+
+	return !ok;
+}
+
+int main(int argc, char **argv){
+	unsigned int scale = 1;
+	unsigned int repeat = 5;
+	const char *onlycase = NULL;
+	const char *tmpfile = "objgl_bench_corpus.obj";
+	unsigned long long huge = 0;
+	unsigned int pad = 0;
+
+	for(int i = 1; i < argc; ++i){
+		if(!strcmp(argv[i], "--scale") && i + 1 < argc){
+			scale = (unsigned int)atoi(argv[++i]);
+		} else if(!strcmp(argv[i], "--repeat") && i + 1 < argc){
+			repeat = (unsigned int)atoi(argv[++i]);
+		} else if(!strcmp(argv[i], "--case") && i + 1 < argc){
+			onlycase = argv[++i];
+		} else if(!strcmp(argv[i], "--tmp") && i + 1 < argc){
+			tmpfile = argv[++i];
+		} else if(!strcmp(argv[i], "--emit") && i + 2 < argc){
+			onlycase = argv[++i];
+			tmpfile = argv[++i];
+			repeat = 0;
+		} else if(!strcmp(argv[i], "--huge")){
+			//1432M triangles are the first million past 4G indices
+			huge = i + 1 < argc && argv[i + 1][0] != '-' ? strtoull(argv[++i], NULL, 10) : 1432;
+		} else if(!strcmp(argv[i], "--pad") && i + 1 < argc){
+			pad = (unsigned int)atoi(argv[++i]);
+		} else{
+			fprintf(stderr, "usage: %s [--scale N] [--repeat N] [--case name] [--tmp path] [--emit name path] [--huge [N] [--pad N]]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(huge){
+		return objgl_bench_huge(tmpfile, huge * 1000000ULL, pad);
+	}
+
+	scale += !scale;
+
+	for(unsigned int c = 0; c < sizeof(benchcases) / sizeof(benchcases[0]); ++c){
+		const objgl_benchcase *bc = &benchcases[c];
+
+		if(onlycase && strcmp(onlycase, bc->name)){
+			continue;
+		}
+
+		objgl_benchbuffer buf = objgl_bench_generate(bc, scale);
+		FILE *f = fopen(tmpfile, "wb");
+
+		if(!f || fwrite(buf.data, 1, buf.len, f) != buf.len){
+			fprintf(stderr, "can't write %s\n", tmpfile);
+			return 1;
+		}
+
+		fclose(f);
+
+		if(!repeat){
+			free(buf.data);
+			return 0;
+		}
+
+		for(int loader = 0; loader < 3; ++loader){
+			double *times = (double*)malloc(sizeof(double) * repeat);
+			objgl_benchresult result = {0};
+
+			for(unsigned int r = 0; r < repeat; ++r){
+				double start = objgl_bench_now();
+				result = objgl_bench_load(loader, &buf, tmpfile);
+				times[r] = objgl_bench_now() - start;
+			}
+
+			qsort(times, repeat, sizeof(double), objgl_bench_cmp);
+
+			long maxrss;
+			objgl_benchresult measured = objgl_bench_measure(loader, &buf, tmpfile, &maxrss);
+
+			printf("{\"case\":\"%s\",\"loader\":\"%s\",\"scale\":%u,\"bytes\":%zu,\"indices\":%u,\"vertices\":%u,"
+				"\"seconds_best\":%.6f,\"seconds_median\":%.6f,\"mb_per_s\":%.2f,\"ns_per_index\":%.2f,"
+				"\"peak_rss_kb\":%ld,\"allocs\":%lld,\"peak_heap_bytes\":%lld,"
+				"\"io_s\":%.6f,\"parse_s\":%.6f,\"dedup_s\":%.6f,\"assembly_s\":%.6f}\n",
+				bc->name, loadernames[loader], scale, buf.len, result.numIndices, result.numVertices,
+				times[0], times[repeat / 2], buf.len / times[0] / (1024.0 * 1024.0), times[0] * 1e9 / (result.numIndices + !result.numIndices),
+				maxrss, OBJGL_BENCH_ALLOCS ? (long long)measured.allocs : -1LL, OBJGL_BENCH_ALLOCS ? measured.peakHeap : -1LL,
+				result.stats.ioSeconds, result.stats.parseSeconds, result.stats.dedupSeconds, result.stats.assemblySeconds);
+			fflush(stdout);
+
+			free(times);
+		}
+
+		free(buf.data);
+	}
+
+	remove(tmpfile);
+
+	return 0;
+}
@@ -0,0 +1,450 @@
+/*
+ * Microbenchmarks of the hot kernels of objgl2.c (objgl_atof, objgl_atoi, objgl_parseindices,
+ * objgl2_hashfunc64, objgl_insert and the final assembly) over fixed, deterministic corpora.
+ *
+ * cc -O2 source/bench/objgl_kbench.c -o objgl_kbench
+ *
+ * ./objgl_kbench [--size N] [--repeat N] [--kernel name]
+ *
+ * objgl2.c is included directly, so the kernels are the very same code (and the same compiler
+ * flags) the loader uses. Build it twice with different flags to compare the variants.
+ * Cycles, instructions, branch misses and cache misses come from perf_event_open; if it's not
+ * available (not Linux, perf_event_paranoid, containers) only the time is reported and the
+ * counters are null. Every kernel is printed as one JSON object per line, best of --repeat.
+ */
+#define _GNU_SOURCE
+#include "../objgl2/objgl2.c"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define OBJGL_KBENCH_PERF 1
+#else
+#define OBJGL_KBENCH_PERF 0
+#endif
+
+enum{
+	OBJGL_KBENCH_CYCLES,
+	OBJGL_KBENCH_INSTRUCTIONS,
+	OBJGL_KBENCH_BRANCHMISSES,
+	OBJGL_KBENCH_CACHEMISSES,
+	OBJGL_KBENCH_COUNTERS
+};
+
+typedef struct{
+	int fds[OBJGL_KBENCH_COUNTERS]; //-1 if the counter couldn't be opened, fds[0] is the group leader
+	long long values[OBJGL_KBENCH_COUNTERS]; //-1 if not available
+} objgl_kcounters;
+
+typedef struct{
+	char *floats, *ints, *faces; //text corpora, each one ends with "\n\0"
+	size_t floatsLen, intsLen, facesLen;
+	uint_fast32_t numFloats, numInts, numFaces;
+
+	objfacevert *verts; //every face vertex of the faces corpus, as the parser would cache it
+	uint_fast32_t numVerts;
+
+	objhashentry *table; //dedup table, numVerts entries
+	objgl2Size uniques;
+	objfacevert *keys; //of the unique vertices in the vertex order, as the dedup leaves them
+
+	objgl_vec3 *positions, *normals;
+	objgl_vec2 *texcoords;
+	uint_fast32_t numAttributes;
+	float *data; //assembled vertices
+
+	objcache_internal cache;
+	objinfo_internal info;
+} objgl_kcorpus;
+
+typedef struct{
+	const char *name;
+	void (*prepare)(objgl_kcorpus*); //not measured, NULL if not needed
+	uint_least64_t (*run)(objgl_kcorpus*); //returns a checksum, so the compiler can't drop the work
+	size_t (*bytes)(const objgl_kcorpus*);
+	uint_fast32_t (*items)(const objgl_kcorpus*);
+} objgl_kernel;
+
+static unsigned long long benchseed;
+
+//splitmix64, the corpus must be identical on every machine
+static unsigned long long objgl_kbench_rand(void){
+	unsigned long long z = (benchseed += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static float objgl_kbench_float(float min, float max){
+	return min + (max - min) * (float)((objgl_kbench_rand() >> 40) / (double)(1ULL << 24));
+}
+
+static double objgl_kbench_now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#if OBJGL_KBENCH_PERF
+static int objgl_kbench_perfopen(unsigned long long config, int group){
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = group == -1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+static void objgl_kbench_counters_open(objgl_kcounters *c){
+	for(int i = 0; i < OBJGL_KBENCH_COUNTERS; ++i){
+		c->fds[i] = -1;
+	}
+
+#if OBJGL_KBENCH_PERF
+	static const unsigned long long configs[OBJGL_KBENCH_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+	};
+
+	c->fds[0] = objgl_kbench_perfopen(configs[0], -1);
+
+	for(int i = 1; i < OBJGL_KBENCH_COUNTERS && c->fds[0] != -1; ++i){
+		c->fds[i] = objgl_kbench_perfopen(configs[i], c->fds[0]);
+	}
+#endif
+}
+
+static void objgl_kbench_counters_close(objgl_kcounters *c){
+#if OBJGL_KBENCH_PERF
+	for(int i = OBJGL_KBENCH_COUNTERS - 1; i >= 0; --i){
+		if(c->fds[i] != -1){
+			close(c->fds[i]);
+		}
+	}
+#endif
+}
+
+static void objgl_kbench_counters_start(objgl_kcounters *c){
+#if OBJGL_KBENCH_PERF
+	if(c->fds[0] != -1){
+		ioctl(c->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(c->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+#else
+	(void)c;
+#endif
+}
+
+static void objgl_kbench_counters_stop(objgl_kcounters *c){
+#if OBJGL_KBENCH_PERF
+	if(c->fds[0] != -1){
+		ioctl(c->fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	}
+#endif
+
+	for(int i = 0; i < OBJGL_KBENCH_COUNTERS; ++i){
+		c->values[i] = -1;
+#if OBJGL_KBENCH_PERF
+		unsigned long long value;
+
+		if(c->fds[i] != -1 && read(c->fds[i], &value, sizeof(value)) == sizeof(value)){
+			c->values[i] = (long long)value;
+		}
+#endif
+	}
+}
+
+static char* objgl_kbench_text(size_t *len, size_t res){
+	char *text = (char*)malloc(res);
+	*len = 0;
+	return text;
+}
+
+static void objgl_kbench_corpus(objgl_kcorpus *c, uint_fast32_t size){
+	*c = (objgl_kcorpus){0};
+	benchseed = 42;
+
+	//floats like the exporters write them, "v" lines without the "v"
+	c->numFloats = size;
+	c->floats = objgl_kbench_text(&c->floatsLen, size * 16 + 2);
+	for(uint_fast32_t i = 0; i < c->numFloats; ++i){
+		c->floatsLen += sprintf(c->floats + c->floatsLen, " %.6f", objgl_kbench_float(-100, 100));
+	}
+	c->floatsLen += sprintf(c->floats + c->floatsLen, "\n");
+
+	//indices, one in eight relative
+	c->numInts = size;
+	c->ints = objgl_kbench_text(&c->intsLen, size * 12 + 2);
+	for(uint_fast32_t i = 0; i < c->numInts; ++i){
+		long value = 1 + (long)(objgl_kbench_rand() % 1000000);
+		c->intsLen += sprintf(c->ints + c->intsLen, " %ld", objgl_kbench_rand() & 7 ? value : -value);
+	}
+	c->intsLen += sprintf(c->ints + c->intsLen, "\n");
+
+	//triangles with all three attributes, every vertex is shared by about six of them like in a closed mesh
+	c->numFaces = size / 3 + 1;
+	c->numAttributes = c->numFaces / 2 + 1;
+	c->faces = objgl_kbench_text(&c->facesLen, c->numFaces * 64 + 2);
+	for(uint_fast32_t i = 0; i < c->numFaces; ++i){
+		c->facesLen += sprintf(c->faces + c->facesLen, "f");
+		for(int j = 0; j < 3; ++j){
+			unsigned long index = 1 + (unsigned long)(objgl_kbench_rand() % c->numAttributes);
+			c->facesLen += sprintf(c->faces + c->facesLen, " %lu/%lu/%lu", index, index, index);
+		}
+		c->facesLen += sprintf(c->faces + c->facesLen, "\n");
+	}
+
+	c->info.numPositions = c->info.numTexcoords = c->info.numNormals = c->numAttributes;
+
+	c->numVerts = c->numFaces * 3;
+	c->verts = (objfacevert*)malloc(sizeof(objfacevert) * c->numVerts);
+	uint_fast32_t pos = 0;
+	for(uint_fast32_t i = 0; i < c->numFaces; ++i){
+		++pos;
+		uint_least32_t n = objgl_parseindices(c->faces, &pos, &c->cache, &c->info, NULL);
+		memcpy(&c->verts[i * 3], c->cache.cache, sizeof(objfacevert) * (n < 3 ? n : 3));
+		++pos;
+	}
+
+	c->table = (objhashentry*)calloc(c->numVerts, sizeof(objhashentry));
+
+	c->positions = (objgl_vec3*)malloc(sizeof(objgl_vec3) * c->numAttributes);
+	c->normals = (objgl_vec3*)malloc(sizeof(objgl_vec3) * c->numAttributes);
+	c->texcoords = (objgl_vec2*)malloc(sizeof(objgl_vec2) * c->numAttributes);
+	for(uint_fast32_t i = 0; i < c->numAttributes; ++i){
+		for(int j = 0; j < 3; ++j){
+			c->positions[i].a[j] = objgl_kbench_float(-100, 100);
+			c->normals[i].a[j] = objgl_kbench_float(-1, 1);
+		}
+		c->texcoords[i].a[0] = objgl_kbench_float(0, 1);
+		c->texcoords[i].a[1] = objgl_kbench_float(0, 1);
+	}
+}
+
+static void objgl_kbench_corpus_delete(objgl_kcorpus *c){
+	free(c->floats);
+	free(c->ints);
+	free(c->faces);
+	free(c->verts);
+	free(c->table);
+	free(c->keys);
+	free(c->positions);
+	free(c->normals);
+	free(c->texcoords);
+	free(c->data);
+	free(c->cache.cache);
+}
+
+static uint_least64_t objgl_kbench_atof(objgl_kcorpus *c){
+	uint_fast32_t pos = 0;
+	float sum = 0;
+
+	while(c->floats[pos] != '\n'){
+		sum += objgl_atof(c->floats, &pos);
+	}
+
+	return (uint_least64_t)(int_least64_t)sum;
+}
+
+static uint_least64_t objgl_kbench_atoi(objgl_kcorpus *c){
+	uint_fast32_t pos = 0;
+	uint_least64_t sum = 0;
+
+	while(c->ints[pos] != '\n'){
+		sum += objgl_atoi(c->ints, &pos);
+	}
+
+	return sum;
+}
+
+static uint_least64_t objgl_kbench_parseindices(objgl_kcorpus *c){
+	uint_fast32_t pos = 0;
+	uint_least64_t sum = 0;
+
+	while(c->faces[pos]){
+		++pos; //the "f", just like the parser's switch
+		sum += objgl_parseindices(c->faces, &pos, &c->cache, &c->info, NULL);
+		sum += c->cache.cache[0].a[0];
+		++pos;
+	}
+
+	return sum;
+}
+
+static uint_least64_t objgl_kbench_hashfunc64(objgl_kcorpus *c){
+	uint_least64_t sum = 0;
+
+	for(uint_fast32_t i = 0; i < c->numVerts; ++i){
+		sum ^= objgl2_hashfunc64(c->verts[i]);
+	}
+
+	return sum;
+}
+
+static void objgl_kbench_insert_prepare(objgl_kcorpus *c){
+	memset(c->table, 0, sizeof(objhashentry) * c->numVerts);
+	c->uniques = 0;
+}
+
+static uint_least64_t objgl_kbench_insert(objgl_kcorpus *c){
+	uint_least64_t sum = 0;
+
+	for(uint_fast32_t i = 0; i < c->numVerts; ++i){
+		char fresh;
+		sum += objgl_insert(&c->verts[i], 0, c->table, c->numVerts, &c->uniques, &fresh, NULL);
+	}
+
+	return sum;
+}
+
+static void objgl_kbench_assemble_prepare(objgl_kcorpus *c){
+	if(!c->data){
+		objgl_kbench_insert_prepare(c);
+		objgl_kbench_insert(c);
+		c->data = (float*)malloc(sizeof(float) * 8 * c->uniques);
+		c->keys = (objfacevert*)malloc(sizeof(objfacevert) * c->uniques);
+
+		for(uint_fast32_t i = 0; i < c->numVerts; ++i){
+			if(c->table[i].hash){
+				c->keys[c->table[i].index] = c->table[i].vert;
+			}
+		}
+	}
+}
+
+static uint_least64_t objgl_kbench_assemble(objgl_kcorpus *c){
+	objgl_assemble_keys(c->data, sizeof(float) * 8, c->keys, 0, c->uniques, c->positions, c->texcoords, c->normals, 1, 1);
+
+	return (uint_least64_t)(int_least64_t)c->data[c->uniques * 4];
+}
+
+static uint_least64_t objgl_kbench_assemble_stream(objgl_kcorpus *c){
+	objgl_assemble_keys_stream(c->data, sizeof(float) * 8, c->keys, 0, c->uniques, c->positions, c->texcoords, c->normals, 1, 1);
+
+	return (uint_least64_t)(int_least64_t)c->data[c->uniques * 4];
+}
+
+static size_t objgl_kbench_floatbytes(const objgl_kcorpus *c){return c->floatsLen;}
+static size_t objgl_kbench_intbytes(const objgl_kcorpus *c){return c->intsLen;}
+static size_t objgl_kbench_facebytes(const objgl_kcorpus *c){return c->facesLen;}
+static size_t objgl_kbench_vertbytes(const objgl_kcorpus *c){return c->numVerts * sizeof(objfacevert);}
+static size_t objgl_kbench_databytes(const objgl_kcorpus *c){return c->uniques * sizeof(float) * 8;}
+
+static uint_fast32_t objgl_kbench_floatitems(const objgl_kcorpus *c){return c->numFloats;}
+static uint_fast32_t objgl_kbench_intitems(const objgl_kcorpus *c){return c->numInts;}
+static uint_fast32_t objgl_kbench_faceitems(const objgl_kcorpus *c){return c->numFaces;}
+static uint_fast32_t objgl_kbench_vertitems(const objgl_kcorpus *c){return c->numVerts;}
+static uint_fast32_t objgl_kbench_uniqueitems(const objgl_kcorpus *c){return c->uniques;}
+
+static const objgl_kernel kernels[] = {
+	{"objgl_atof", NULL, objgl_kbench_atof, objgl_kbench_floatbytes, objgl_kbench_floatitems},
+	{"objgl_atoi", NULL, objgl_kbench_atoi, objgl_kbench_intbytes, objgl_kbench_intitems},
+	{"objgl_parseindices", NULL, objgl_kbench_parseindices, objgl_kbench_facebytes, objgl_kbench_faceitems},
+	{"objgl2_hashfunc64", NULL, objgl_kbench_hashfunc64, objgl_kbench_vertbytes, objgl_kbench_vertitems},
+	{"objgl_insert", objgl_kbench_insert_prepare, objgl_kbench_insert, objgl_kbench_vertbytes, objgl_kbench_vertitems},
+	{"objgl_assemble_keys", objgl_kbench_assemble_prepare, objgl_kbench_assemble, objgl_kbench_databytes, objgl_kbench_uniqueitems},
+	{"objgl_assemble_keys_stream", objgl_kbench_assemble_prepare, objgl_kbench_assemble_stream, objgl_kbench_databytes, objgl_kbench_uniqueitems}
+};
+
+static void objgl_kbench_printcounter(const char *name, long long value){
+	if(value < 0){
+		printf(",\"%s\":null", name);
+	} else{
+		printf(",\"%s\":%lld", name, value);
+	}
+}
+
+int main(int argc, char **argv){
+	uint_fast32_t size = 1 << 20;
+	unsigned int repeat = 10;
+	const char *onlykernel = NULL;
+
+	for(int i = 1; i < argc; ++i){
+		if(!strcmp(argv[i], "--size") && i + 1 < argc){
+			size = (uint_fast32_t)atol(argv[++i]);
+		} else if(!strcmp(argv[i], "--repeat") && i + 1 < argc){
+			repeat = (unsigned int)atoi(argv[++i]);
+		} else if(!strcmp(argv[i], "--kernel") && i + 1 < argc){
+			onlykernel = argv[++i];
+		} else{
+			fprintf(stderr, "usage: %s [--size N] [--repeat N] [--kernel name]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	size += !size;
+	repeat += !repeat;
+
+	objgl_kcorpus corpus;
+	objgl_kbench_corpus(&corpus, size);
+
+	objgl_kcounters counters;
+	objgl_kbench_counters_open(&counters);
+
+	for(unsigned int k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k){
+		const objgl_kernel *kernel = &kernels[k];
+
+		if(onlykernel && strcmp(onlykernel, kernel->name)){
+			continue;
+		}
+
+		double best = 0;
+		long long bestValues[OBJGL_KBENCH_COUNTERS] = {0};
+		uint_least64_t checksum = 0;
+
+		//the first run only warms up the caches and the branch predictors
+		for(unsigned int r = 0; r <= repeat; ++r){
+			if(kernel->prepare){
+				kernel->prepare(&corpus);
+			}
+
+			objgl_kbench_counters_start(&counters);
+			double start = objgl_kbench_now();
+			checksum = kernel->run(&corpus);
+			double seconds = objgl_kbench_now() - start;
+			objgl_kbench_counters_stop(&counters);
+
+			if(r && (r == 1 || seconds < best)){
+				best = seconds;
+				memcpy(bestValues, counters.values, sizeof(bestValues));
+			}
+		}
+
+		size_t bytes = kernel->bytes(&corpus);
+		uint_fast32_t items = kernel->items(&corpus);
+		long long cycles = bestValues[OBJGL_KBENCH_CYCLES];
+		long long instructions = bestValues[OBJGL_KBENCH_INSTRUCTIONS];
+
+		printf("{\"kernel\":\"%s\",\"counters\":\"%s\",\"bytes\":%zu,\"items\":%lu,\"seconds\":%.9f,\"mb_per_s\":%.2f,\"ns_per_item\":%.3f",
+			kernel->name, cycles < 0 ? "clock_gettime" : "perf_event", bytes, (unsigned long)items,
+			best, bytes / best / (1024.0 * 1024.0), best * 1e9 / (items + !items));
+		objgl_kbench_printcounter("cycles", cycles);
+		objgl_kbench_printcounter("instructions", instructions);
+		objgl_kbench_printcounter("branch_misses", bestValues[OBJGL_KBENCH_BRANCHMISSES]);
+		objgl_kbench_printcounter("cache_misses", bestValues[OBJGL_KBENCH_CACHEMISSES]);
+
+		if(cycles > 0){
+			printf(",\"cycles_per_byte\":%.3f,\"ipc\":%.3f", (double)cycles / (bytes + !bytes), instructions < 0 ? 0.0 : (double)instructions / cycles);
+		} else{
+			printf(",\"cycles_per_byte\":null,\"ipc\":null");
+		}
+
+		printf(",\"checksum\":%llu}\n", (unsigned long long)checksum);
+		fflush(stdout);
+	}
+
+	objgl_kbench_counters_close(&counters);
+	objgl_kbench_corpus_delete(&corpus);
+
+	return 0;
+}
@@ -39,8 +39,8 @@ typedef struct{
 } ObjGLData;
 
 /*
- * in *buffer - OBJ file contents as a C-string
- * returns the OBJData
+ * in *buffer - OBJ file contents as a C-string, every o block goes into the one mesh
+ * returns the OBJData, zeroed if the file couldn't be loaded
  */
 ObjGLData objgl_loadObj(const char* buffer);
 
@@ -1,19 +1,93 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "objgl2.h"
 #include <stdlib.h>
+#include <string.h>
+#include <float.h>
 
-#define OBJGL_DEBUG 0
+//non-temporal stores for assembling big outputs
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OBJGL_STREAMSTORES 1
+#else
+#define OBJGL_STREAMSTORES 0
+#endif
 
-#if OBJGL_DEBUG
-static uint_fast32_t _debugmemory;
-static uint_fast32_t _debugallocs;
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
-#define objgl_free(ptr) free((void*)ptr)
-#define objgl_alloc(size) malloc(size); _debugmemory += size; ++_debugallocs
-#define objgl_realloc(ptr, size, oldsize) realloc((void*)ptr, size); _debugmemory += size - oldsize; ++_debugallocs
+#if OBJGL_THREADS_IMPL
+#ifdef _WIN32
+typedef CRITICAL_SECTION objgl_mutex;
+typedef HANDLE objgl_thread;
+#define objgl_mutex_init(m) InitializeCriticalSection(m)
+#define objgl_mutex_destroy(m) DeleteCriticalSection(m)
+#define objgl_mutex_lock(m) EnterCriticalSection(m)
+#define objgl_mutex_unlock(m) LeaveCriticalSection(m)
+typedef CONDITION_VARIABLE objgl_cond;
+#define objgl_cond_init(c) InitializeConditionVariable(c)
+#define objgl_cond_destroy(c) ((void)(c))
+#define objgl_cond_wait(c, m) SleepConditionVariableCS(c, m, INFINITE)
+#define objgl_cond_broadcast(c) WakeAllConditionVariable(c)
+#else
+#include <pthread.h>
+#include <unistd.h>
+typedef pthread_mutex_t objgl_mutex;
+typedef pthread_t objgl_thread;
+#define objgl_mutex_init(m) pthread_mutex_init(m, NULL)
+#define objgl_mutex_destroy(m) pthread_mutex_destroy(m)
+#define objgl_mutex_lock(m) pthread_mutex_lock(m)
+#define objgl_mutex_unlock(m) pthread_mutex_unlock(m)
+typedef pthread_cond_t objgl_cond;
+#define objgl_cond_init(c) pthread_cond_init(c, NULL)
+#define objgl_cond_destroy(c) pthread_cond_destroy(c)
+#define objgl_cond_wait(c, m) pthread_cond_wait(c, m)
+#define objgl_cond_broadcast(c) pthread_cond_broadcast(c)
+#endif
 #else
+typedef char objgl_mutex;
+#define objgl_mutex_init(m) ((void)(m))
+#define objgl_mutex_destroy(m) ((void)(m))
+#define objgl_mutex_lock(m) ((void)(m))
+#define objgl_mutex_unlock(m) ((void)(m))
+typedef char objgl_cond;
+#define objgl_cond_init(c) ((void)(c))
+#define objgl_cond_destroy(c) ((void)(c))
+#define objgl_cond_wait(c, m) ((void)(c))
+#define objgl_cond_broadcast(c) ((void)(c))
+#endif
+
 #define objgl_free(ptr) free((void*)ptr)
 #define objgl_alloc(size) malloc(size)
-#define objgl_realloc(ptr, size, oldsize) realloc((void*)ptr, size)
+#define objgl_calloc(num, size) calloc(num, size)
+#define objgl_realloc(ptr, size) realloc((void*)ptr, size)
+
+//allocations counted in the per-load objgl2Stats, stats may be NULL
+#define objgl_tfree(stats, ptr, size) (objgl_untrack(stats, size), free((void*)ptr))
+#define objgl_talloc(stats, size) objgl_track(stats, malloc(size), size, 0)
+#define objgl_tcalloc(stats, num, size) objgl_track(stats, calloc(num, size), (num) * (size), 0)
+#define objgl_trealloc(stats, ptr, size, oldsize) objgl_track(stats, realloc((void*)ptr, size), size, oldsize)
+
+//index and vertex counts and offsets into a stream's buffer, uint_fast32_t is what the 32-bit build always used for them
+#if OBJGL_64BIT_IMPL || OBJGL_INDEX64_IMPL
+typedef uint_least64_t objgl_count;
+typedef uint_least64_t objgl_pos;
+#else
+typedef uint_fast32_t objgl_count;
+typedef uint_fast32_t objgl_pos;
+#endif
+
+//a face index as it's read, negative ones count back from the end
+#if OBJGL_INDEX64_IMPL
+typedef int_least64_t objgl_sindex;
+#else
+typedef int_least32_t objgl_sindex;
 #endif
 
 typedef struct{
@@ -29,7 +103,7 @@ typedef struct{
 } objgl_vec2;
 
 typedef struct{
-	uint_least32_t a[3];
+	objgl2Index a[3];
 } objfacevert;
 
 typedef struct{
@@ -38,32 +112,164 @@ typedef struct{
 
 typedef struct{
 	objfacevert vert;
+	uint_least32_t material; //the last one that used the vertex, it fits into the padding
 	uint_least64_t hash;
-	uint_fast32_t index;
+	objgl_count index;
 } objhashentry;
 
+#define OBJGL_NONAME 0xFFFFFFFF
+#define OBJGL_NOTFOUND 0xFFFFFFFF
+
 typedef struct{
 	objfacevert* indices;
-	char* name;
+	uint_least32_t name; //offset into the name pool, OBJGL_NONAME if unnamed
+	uint_least32_t nameLen;
 	uint_least32_t hash;
-	uint_least32_t resIndices;
-	uint_least32_t numIndices;
+	objgl2Size resIndices;
+	objgl2Size numIndices;
 } objmaterial_internal;
 
+typedef struct{
+	char *data;
+	uint_fast32_t len, res;
+} objstrpool_internal;
+
+typedef struct{
+	uint_least32_t hash;
+	uint_least32_t value; //stored index + 1, 0 means an empty slot
+} objstrslot_internal;
+
+typedef struct{
+	objstrslot_internal *slots;
+	uint_fast32_t mask, count;
+} objstrtable_internal;
+
+//compares the string stored under the index with str, returns non-zero if equal
+typedef char (*objgl_streq_ptr)(const void *ctx, uint_least32_t index, const char *str, uint_fast32_t len);
+
+typedef struct{
+	const objmaterial_internal *materials;
+	const char *pool;
+} objmatlookup_internal;
+
+typedef struct{
+	char *path;
+	uint_least32_t pathLen;
+	objgl2MtlMaterial *materials;
+	uint_least32_t numMaterials;
+	char *names;
+	objstrtable_internal table;
+} objmtllib_internal;
+
+struct __ObjGL2MtlDB{
+	objmtllib_internal *libraries;
+	uint_fast32_t numLibraries, resLibraries;
+	objstrtable_internal libTable;
+	char **textures;
+	uint_fast32_t numTextures, resTextures;
+	objstrtable_internal texTable;
+	objgl_mutex lock; //the batch loader shares one database between the workers
+};
+
+typedef struct{
+	uint_least32_t *libraries;
+	uint_fast32_t numLibraries, resLibraries;
+} objmtlrefs_internal;
+
 typedef struct{
 	objfacevert *cache;
 	uint_least32_t cacheSize;
 } objcache_internal;
 
 typedef struct{
-	uint_fast32_t numPositions, numNormals, numTexcoords;
-	uint_fast32_t resPositions, resNormals, resTexcoords;
+	objgl_count numPositions, numNormals, numTexcoords;
+	objgl_count resPositions, resNormals, resTexcoords;
 } objinfo_internal;
 
+//the material faces go to, shared by the parser and the reloader's replay of usemtl lines
+typedef struct{
+	objmaterial_internal cur; //written back to list[index] on a switch
+	objmaterial_internal *list;
+	uint_fast32_t num, res, index;
+	objstrpool_internal names;
+	objstrtable_internal table;
+} objmatstate_internal;
+
+//everything the parser hands over to dedup and assembly
+typedef struct{
+	objmatstate_internal mat; //list[index] is up to date and the table is freed
+	objgl_vec3 *positions, *normals;
+	objgl_vec2 *texcoords;
+	objinfo_internal info;
+	objgl_count numIndices;
+	char *name;
+	objmtlrefs_internal mtlRefs;
+	char hasNormals, hasTextures;
+} objparse_internal;
+
+//a run of one object's faces in one material, a new one starts at every o line and usemtl switch
+typedef struct{
+	uint_least32_t object, material;
+	objgl2Size start; //in the material's face vertices, the run ends where the material's next one starts
+} objsegment_internal;
+
+//the o blocks of a load that reads past the first one, for the instancing
+typedef struct{
+	objsegment_internal *segments;
+	uint_fast32_t numSegments, resSegments;
+	uint_least32_t *names; //offsets into the material name pool, OBJGL_NONAME for the faces before the first o line
+	uint_fast32_t numObjects, resObjects;
+} objobjects_internal;
+
+//buffers of a load that a batch worker keeps from one file to the next
+typedef struct{
+	objgl_vec3 *positions, *normals;
+	objgl_vec2 *texcoords;
+	objinfo_internal info; //only the res* fields are kept
+	objcache_internal vertCache;
+	objmaterial_internal *materials;
+	uint_fast32_t resMaterials;
+	objhashentry *hashtable;
+	objgl_count hashtableSize;
+	objfacevert *keys; //of the unique vertices in the vertex order, filled by the dedup
+	objgl_count resKeys;
+} objscratch_internal;
+
 #ifdef __cplusplus
 extern "C"{
 #endif
 
+void* objgl_track(objgl2Stats *stats, void *ptr, uint_least64_t size, uint_least64_t oldsize){
+	if(stats){
+		++stats->allocations;
+		stats->bytes += size - oldsize;
+		stats->peakBytes = stats->bytes > stats->peakBytes ? stats->bytes : stats->peakBytes;
+	}
+
+	return ptr;
+}
+
+void objgl_untrack(objgl2Stats *stats, uint_least64_t size){
+	if(stats){
+		stats->bytes -= size;
+	}
+}
+
+double objgl_now(void){
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
 uint_least64_t objgl2_hashfunc64(objfacevert vert){
 	unsigned char *aschar = (unsigned char*)&vert;
 	const uint_least64_t prime = 1099511628211;
@@ -89,39 +295,368 @@ uint_least32_t objgl2_hashfunc32_string(const char* str, uint_fast32_t len){
 	return ++hash;
 }
 
-uint_least32_t objgl_insert(objfacevert *vert, objhashentry *table, uint_least32_t size, uint_least32_t *unique){
+char objgl_strneq(const char *a, const char *b, uint_fast32_t len){
+	for(uint_fast32_t i = 0; i < len; ++i){
+		if(a[i] != b[i]){
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+uint_least32_t objgl_strpool_add(objstrpool_internal *pool, const char *str, uint_fast32_t len, objgl2Stats *stats){
+	if(pool->len + len + 1 > pool->res){
+		uint_fast32_t oldsize = pool->res;
+		pool->res += pool->res + len + 1;
+		pool->data = (char*)objgl_trealloc(stats, pool->data, pool->res, oldsize);
+	}
+
+	uint_least32_t offset = pool->len;
+
+	for(uint_fast32_t i = 0; i < len; ++i){
+		pool->data[offset + i] = str[i];
+	}
+
+	pool->data[offset + len] = '\0';
+	pool->len += len + 1;
+
+	return offset;
+}
+
+uint_least32_t objgl_strtable_find(const objstrtable_internal *table, uint_least32_t hash, const char *str, uint_fast32_t len, objgl_streq_ptr eq, const void *ctx){
+	if(!table->slots){
+		return OBJGL_NOTFOUND;
+	}
+
+	for(uint_fast32_t index = hash & table->mask; table->slots[index].value; index = (index + 1) & table->mask){
+		objstrslot_internal slot = table->slots[index];
+
+		if(slot.hash == hash && eq(ctx, slot.value - 1, str, len)){
+			return slot.value - 1;
+		}
+	}
+
+	return OBJGL_NOTFOUND;
+}
+
+void objgl_strtable_insert(objstrtable_internal *table, uint_least32_t hash, uint_least32_t value, objgl2Stats *stats){
+	if((table->count + 1) * 2 > table->mask + 1 || !table->slots){
+		uint_fast32_t oldsize = table->slots ? table->mask + 1 : 0;
+		uint_fast32_t size = oldsize ? oldsize * 2 : 64;
+		objstrslot_internal *slots = (objstrslot_internal*)objgl_talloc(stats, sizeof(objstrslot_internal) * size);
+
+		for(uint_fast32_t i = 0; i < size; ++i){
+			slots[i] = (const objstrslot_internal){0};
+		}
+
+		for(uint_fast32_t i = 0; i < oldsize; ++i){
+			objstrslot_internal slot = table->slots[i];
+
+			if(slot.value){
+				uint_fast32_t index = slot.hash & (size - 1);
+				while(slots[index].value){index = (index + 1) & (size - 1);}
+				slots[index] = slot;
+			}
+		}
+
+		objgl_tfree(stats, table->slots, sizeof(objstrslot_internal) * oldsize);
+		table->slots = slots;
+		table->mask = size - 1;
+	}
+
+	uint_fast32_t index = hash & table->mask;
+	while(table->slots[index].value){index = (index + 1) & table->mask;}
+
+	table->slots[index].hash = hash;
+	table->slots[index].value = value + 1;
+	++table->count;
+}
+
+char objgl_material_eq(const void *ctx, uint_least32_t index, const char *str, uint_fast32_t len){
+	const objmatlookup_internal *lookup = (const objmatlookup_internal*)ctx;
+	objmaterial_internal mat = lookup->materials[index];
+
+	return mat.nameLen == len && objgl_strneq(&lookup->pool[mat.name], str, len);
+}
+
+void objgl_matstate_init(objmatstate_internal *mat, objmaterial_internal *list, uint_fast32_t res, objgl2Stats *stats){
+	*mat = (const objmatstate_internal){{0}};
+	mat->cur.name = OBJGL_NONAME;
+	mat->cur.resIndices = 256;
+	mat->cur.indices = (objfacevert*)objgl_talloc(stats, sizeof(objfacevert) * mat->cur.resIndices);
+
+	mat->list = list;
+	mat->res = res;
+	mat->num = 1;
+	mat->list[0] = mat->cur;
+}
+
+//the list is grown with listStats, the indices and names with stats
+void objgl_usemtl(objmatstate_internal *mat, const char *matname, uint_least32_t matnamelen, objgl2Stats *stats, objgl2Stats *listStats){
+	uint_least32_t hash = objgl2_hashfunc32_string(matname, matnamelen);
+
+	if(mat->cur.name == OBJGL_NONAME){
+		mat->cur.hash = hash;
+		mat->cur.name = objgl_strpool_add(&mat->names, matname, matnamelen, stats);
+		mat->cur.nameLen = matnamelen;
+		objgl_strtable_insert(&mat->table, hash, mat->index, stats);
+	} else if(hash != mat->cur.hash || matnamelen != mat->cur.nameLen || !objgl_strneq(&mat->names.data[mat->cur.name], matname, matnamelen)){
+		mat->list[mat->index] = mat->cur;
+
+		objmatlookup_internal lookup = {mat->list, mat->names.data};
+		uint_least32_t found = objgl_strtable_find(&mat->table, hash, matname, matnamelen, objgl_material_eq, &lookup);
+
+		if(found == OBJGL_NOTFOUND){
+			if(mat->num >= mat->res){
+				uint_fast32_t oldsize = mat->res;
+				mat->res += mat->res;
+				mat->list = (objmaterial_internal*)objgl_trealloc(listStats, mat->list, sizeof(objmaterial_internal) * mat->res, sizeof(objmaterial_internal) * oldsize);
+			}
+
+			mat->cur.hash = hash;
+			mat->cur.resIndices = 256;
+			mat->cur.numIndices = 0;
+			mat->cur.indices = (objfacevert*)objgl_talloc(stats, sizeof(objfacevert) * mat->cur.resIndices);
+			mat->cur.name = objgl_strpool_add(&mat->names, matname, matnamelen, stats);
+			mat->cur.nameLen = matnamelen;
+
+			mat->index = mat->num;
+			++mat->num;
+			objgl_strtable_insert(&mat->table, hash, mat->index, stats);
+		} else{
+			mat->index = found;
+			mat->cur = mat->list[mat->index];
+		}
+	}
+}
+
+void objgl_objects_segment(objobjects_internal *objects, uint_least32_t material, objgl2Size start, objgl2Stats *stats){
+	if(objects->numSegments >= objects->resSegments){
+		uint_fast32_t oldsize = objects->resSegments;
+		objects->resSegments += objects->resSegments + 64;
+		objects->segments = (objsegment_internal*)objgl_trealloc(stats, objects->segments, sizeof(objsegment_internal) * objects->resSegments, sizeof(objsegment_internal) * oldsize);
+	}
+
+	objects->segments[objects->numSegments++] = (const objsegment_internal){(uint_least32_t)objects->numObjects - 1, material, start};
+}
+
+//the new object starts in the material that's current at its o line
+void objgl_objects_add(objobjects_internal *objects, uint_least32_t name, uint_least32_t material, objgl2Size start, objgl2Stats *stats){
+	if(objects->numObjects >= objects->resObjects){
+		uint_fast32_t oldsize = objects->resObjects;
+		objects->resObjects += objects->resObjects + 64;
+		objects->names = (uint_least32_t*)objgl_trealloc(stats, objects->names, sizeof(uint_least32_t) * objects->resObjects, sizeof(uint_least32_t) * oldsize);
+	}
+
+	objects->names[objects->numObjects++] = name;
+	objgl_objects_segment(objects, material, start, stats);
+}
+
+//probes is the probe-length histogram, NULL if nobody asked for it. fresh is set if the material didn't use the vertex right before
+objgl2Index objgl_insert(objfacevert *vert, uint_least32_t material, objhashentry *table, objgl2Size size, objgl2Size *unique, char *fresh, uint_least64_t *probes){
 	uint_least64_t hash = objgl2_hashfunc64(*vert);
-	uint_least32_t index = hash % (uint_least64_t)size;
+	objgl2Size index = hash % (uint_least64_t)size;
 
 	unsigned int i = 0;
 	while(table[index].hash != 0){
 		if(table[index].hash == hash){
-			return table[index].index;
+			break;
 		}
 		index = (index + i*i) % size;
 		++i;
 	}
 
+	if(probes){
+		++probes[i < OBJGL2_PROBE_BUCKETS - 1 ? i : OBJGL2_PROBE_BUCKETS - 1];
+	}
+
+	if(table[index].hash){
+		*fresh = table[index].material != material;
+		table[index].material = material;
+
+		return table[index].index;
+	}
+
+	*fresh = 1;
 	table[index].hash = hash;
 	table[index].vert = *vert;
+	table[index].material = material;
 	table[index].index = *unique;
 
 	++*unique;
 
-	return *unique - 1;
+	return (objgl2Index)(*unique - 1);
+}
+
+//Newton's, so the loader doesn't need libm for the rare growth of a sphere
+double objgl_sqrt(double x){
+	if(!(x > 0)){
+		return 0;
+	}
+
+	uint_least64_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	bits = (bits >> 1) + ((uint_least64_t)1023 << 51);
+
+	double r;
+	memcpy(&r, &bits, sizeof(r));
+
+	for(unsigned int i = 0; i < 5; ++i){
+		r = 0.5 * (r + x / r);
+	}
+
+	return r;
+}
+
+//empty until the first point, a negative radius
+void objgl_bounds_init(objgl2Bounds *b){
+	for(uint_fast32_t c = 0; c < 3; ++c){
+		b->min[c] = FLT_MAX;
+		b->max[c] = -FLT_MAX;
+		b->center[c] = 0;
+	}
+
+	b->radius = -1;
 }
 
+//the sphere grows over a point outside of it (Ritter's), stored a bit bigger so the float rounding can't leave a point out
+void objgl_bounds_grow(objgl2Bounds *b, const double *center, double radius){
+	double pad = radius;
+
+	for(uint_fast32_t c = 0; c < 3; ++c){
+		b->center[c] = (float)center[c];
+		pad += center[c] < 0 ? -center[c] : center[c];
+	}
+
+	b->radius = (float)(radius + pad * 1e-6);
+}
+
+void objgl_bounds_add(objgl2Bounds *b, const float *p){
+	for(uint_fast32_t c = 0; c < 3; ++c){
+		b->min[c] = p[c] < b->min[c] ? p[c] : b->min[c];
+		b->max[c] = p[c] > b->max[c] ? p[c] : b->max[c];
+	}
+
+	float d[3] = {p[0] - b->center[0], p[1] - b->center[1], p[2] - b->center[2]};
+	float d2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+
+	if(d2 <= b->radius * b->radius && b->radius >= 0){
+		return;
+	}
+
+	if(b->radius < 0){
+		const double center[3] = {p[0], p[1], p[2]};
+		objgl_bounds_grow(b, center, 0);
+		return;
+	}
+
+	//the new sphere touches the far side of the old one and the point
+	double dist = objgl_sqrt((double)d[0] * d[0] + (double)d[1] * d[1] + (double)d[2] * d[2]);
+	double radius = (b->radius + dist) * 0.5;
+	double shift = (radius - b->radius) / dist;
+	const double center[3] = {b->center[0] + d[0] * shift, b->center[1] + d[1] * shift, b->center[2] + d[2] * shift};
+
+	objgl_bounds_grow(b, center, radius);
+}
+
+void objgl_bounds_merge(objgl2Bounds *b, const objgl2Bounds *other){
+	if(other->radius < 0){
+		return;
+	}
+
+	if(b->radius < 0){
+		*b = *other;
+		return;
+	}
+
+	for(uint_fast32_t c = 0; c < 3; ++c){
+		b->min[c] = other->min[c] < b->min[c] ? other->min[c] : b->min[c];
+		b->max[c] = other->max[c] > b->max[c] ? other->max[c] : b->max[c];
+	}
+
+	const double d[3] = {(double)other->center[0] - b->center[0], (double)other->center[1] - b->center[1], (double)other->center[2] - b->center[2]};
+	double dist = objgl_sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+	if(dist + other->radius <= b->radius){
+		return;
+	}
+
+	if(dist + b->radius <= other->radius){
+		b->center[0] = other->center[0];
+		b->center[1] = other->center[1];
+		b->center[2] = other->center[2];
+		b->radius = other->radius;
+		return;
+	}
+
+	double radius = (dist + b->radius + other->radius) * 0.5;
+	double shift = (radius - b->radius) / dist;
+	const double center[3] = {b->center[0] + d[0] * shift, b->center[1] + d[1] * shift, b->center[2] + d[2] * shift};
+
+	objgl_bounds_grow(b, center, radius);
+}
+
+//empty bounds come out as zeros
+void objgl_bounds_finish(objgl2Bounds *b){
+	if(b->radius < 0){
+		*b = (const objgl2Bounds){{0}};
+	}
+}
+
+//bounds of the materials and of the whole object from the assembled vertices, for when the positions changed after dedup
+void objgl_bounds_compute(objgl2Data *obj){
+	objgl_bounds_init(&obj->bounds);
+
+	for(uint_fast32_t i = 0; i < obj->numMaterials; ++i){
+		objgl2Material *mat = &obj->materials[i];
+		objgl_bounds_init(&mat->bounds);
+
+		for(objgl_count j = 0; j < mat->len; ++j){
+			objgl_bounds_add(&mat->bounds, (const float*)((const char*)obj->data + (size_t)mat->indices[j] * obj->vertSize));
+		}
+
+		objgl_bounds_merge(&obj->bounds, &mat->bounds);
+		objgl_bounds_finish(&mat->bounds);
+	}
+
+	objgl_bounds_finish(&obj->bounds);
+}
+
+#ifdef OBJGL_FSTREAM_IMPL
+#if OBJGL_FSTREAM_IMPL
+void objgl_fstream_delete(void *handle);
+#endif
+#endif
+
+#if OBJGL_FSTREAM_IMPL && (OBJGL_ZLIB_IMPL || OBJGL_ZSTD_IMPL)
+void objgl_zstream_delete(void *handle);
+#endif
+
 void objgl2_deletestream(objgl2StreamInfo* info){
+#ifdef OBJGL_FSTREAM_IMPL
+#if OBJGL_FSTREAM_IMPL
 	if(info->type == OBJGL_FSTREAM){
+		objgl_fstream_delete(info->handle);
 		objgl_free(info->buffer);
 		objgl_free(info->filename);
 	}
+#endif
+#endif
+
+#if OBJGL_FSTREAM_IMPL && (OBJGL_ZLIB_IMPL || OBJGL_ZSTD_IMPL)
+	//the buffer belongs to the stream's ring
+	if(info->type == OBJGL_ZSTREAM){
+		objgl_zstream_delete(info->handle);
+		objgl_free(info->filename);
+	}
+#endif
 
 	*info = (const objgl2StreamInfo){0};
 }
 
-uint_least32_t objgl2_bufferstreamreader(objgl2StreamInfo* info){
-	return 0xFFFFFFFF;
+objgl2Size objgl2_bufferstreamreader(objgl2StreamInfo* info){
+	return (objgl2Size)-1;
 }
 
 objgl2StreamInfo objgl2_init_bufferstream(char* buffer){
@@ -129,10 +664,13 @@ objgl2StreamInfo objgl2_init_bufferstream(char* buffer){
 	s.buffOffset = 0;
 	s.fOffset = 0;
 	s.eof = 1;
+	s.failed = 0;
 	s.function = objgl2_bufferstreamreader;
 	s.buffer = buffer;
-	s.bufferLen = 0xFFFFFFFF;
+	s.bufferLen = (objgl2Size)-1; //the parser stops at the terminator
 	s.type = OBJGL_BSTREAM;
+	s.filename = NULL;
+	s.handle = NULL;
 
 	return s;
 }
@@ -141,121 +679,608 @@ void objgl2_deleteobj(objgl2Data* obj){
 	objgl_free(obj->data);
 	objgl_free(obj->indices);
 	objgl_free(obj->name);
+	objgl_free(obj->materials);
+	objgl_free(obj->strings);
 
-	for(uint_fast32_t i = 0; i < obj->numMaterials; ++i){
-		objgl_free(obj->materials[i].name);
+	if(obj->bvh){
+		objgl_free(obj->bvh->nodes);
+		objgl_free(obj->bvh->triangles);
+		objgl_free(obj->bvh);
 	}
 
-	objgl_free(obj->materials);
-
 	*obj = (const objgl2Data){0};
 }
 
 #ifdef OBJGL_FSTREAM_IMPL
 #if OBJGL_FSTREAM_IMPL
 #include <stdio.h>
+#include <sys/stat.h>
+#if OBJGL_ZLIB_IMPL
+#include <zlib.h>
+#endif
+#if OBJGL_ZSTD_IMPL
+#include <zstd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+typedef struct{
+	FILE *f; //opened by the first read, closed at the end of the file
+	objgl2Size filled; //bytes in the buffer
+	objgl2Size next; //start of the partial line left by the last read
+} objfstream_internal;
+
 objgl2StreamInfo objgl2_init_filestream(char *filename, unsigned int bufferSize){
+	objfstream_internal *fs = (objfstream_internal*)objgl_alloc(sizeof(objfstream_internal));
+	*fs = (const objfstream_internal){0};
+
 	objgl2StreamInfo s;
 	s.buffOffset = 0;
 	s.fOffset = 0;
 	s.eof = 0;
+	s.failed = 0;
 	s.function = objgl2_filestreamreader;
-	s.buffer = (char*)objgl_alloc(bufferSize);
-	s.bufferLen = bufferSize;
+	s.bufferLen = bufferSize > 16 ? bufferSize : 16;
+	s.buffer = (char*)objgl_alloc(s.bufferLen);
 	s.type = OBJGL_FSTREAM;
+	s.handle = fs;
 
 	uint_fast32_t len = 0;
 	while(filename[len]){++len;}
 
 	s.filename = (char*)objgl_alloc(++len);
 
-	for(; len + 1; --len){
-		s.filename[len] = filename[len];
+	for(; len; --len){
+		s.filename[len - 1] = filename[len - 1];
 	}
 
 	return s;
 }
 
-uint_least32_t objgl2_filestreamreader(objgl2StreamInfo* info){
-	FILE *f = fopen(info->filename, "rb");
+objgl2Size objgl2_filestreamreader(objgl2StreamInfo* info){
+	objfstream_internal *fs = (objfstream_internal*)info->handle;
 
 	info->buffOffset = 0;
 
-	fseek(f, info->fOffset, SEEK_SET);
-	fread(info->buffer, sizeof(char), info->bufferLen, f);
+	if(!fs->f && !info->eof){
+		fs->f = fopen(info->filename, "rb");
 
-	uint_least64_t len = ftell(f) - info->fOffset;
+		if(fs->f){
+			//the reads are large, stdio's buffer would only add a copy
+			setvbuf(fs->f, NULL, _IONBF, 0);
+		} else{
+			info->failed = 1;
+		}
+	}
 
-	info->eof = feof(f);
+	if(!fs->f){
+		info->eof = 1;
+		info->buffer[0] = '\0';
 
-	fclose(f);
+		return 0;
+	}
 
-	while(info->buffer[--len] != '\n' && len + 1 > 0); //read fragment must end with new line!!!
+	//the partial line goes to the front instead of being read again
+	objgl2Size len = fs->filled - fs->next;
+	objgl2Size newline = (objgl2Size)-1;
 
-	info->fOffset += len + 1;
+	info->fOffset += fs->next;
+	memmove(info->buffer, info->buffer + fs->next, len);
 
-	return len;
-}
-#endif
-#endif
+	while(1){
+		if(len == info->bufferLen){
+			if(newline != (objgl2Size)-1){
+				break;
+			}
 
-char objgl_isnumber(char c){
-	return (c > 47 && c < 58) || c == '-' || c == '.' || c == '+';
-}
+			//a single line doesn't fit
+			info->bufferLen += info->bufferLen;
+			info->buffer = (char*)objgl_realloc(info->buffer, info->bufferLen);
+		}
 
-char objgl_isletter(char c){
-	return (c > 64 && c < 91) || (c > 96 && c < 123) || c == '_';
-}
+		objgl2Size n = (objgl2Size)fread(info->buffer + len, sizeof(char), info->bufferLen - len, fs->f);
 
-char objgl_strcmp(char *a, char *b){
-	uint_fast32_t ptr = 0;
+		for(objgl2Size i = len + n; i > len; --i){
+			if(info->buffer[i - 1] == '\n'){
+				newline = i - 1;
+				break;
+			}
+		}
 
-	while(a[ptr] && b[ptr]){
-		if(a[ptr] != b[ptr]){
-			return 0;
+		len += n;
+
+		if(len < info->bufferLen){
+			info->eof = 1;
+			info->failed = ferror(fs->f) != 0;
+			break;
 		}
-		++ptr;
 	}
 
-	return 1;
-}
+	if(info->eof){
+		fclose(fs->f);
+		fs->f = NULL;
 
-uint_least32_t objgl_strlen(char *a){
-	uint_least32_t len = 0;
+		//the last line doesn't have to end with a newline
+		if(len && info->buffer[len - 1] != '\n'){
+			info->buffer[len] = '\n';
+			newline = len++;
+		}
 
-	while(a[len] != ' ' && a[len] != '\n' && a[len] != '\0'){
-		++len;
+		if(!len){
+			info->buffer[0] = '\0';
+			newline = 0;
+		}
 	}
 
-	return len;
-}
+	fs->filled = len;
+	fs->next = newline + 1;
 
-float objgl_atof(char* data, uint_fast32_t *pos){
-	static double fractLookup[16] = {
-		0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001, 0.00000001, 0.000000001, 0.0000000001,
-		0.00000000001, 0.000000000001, 0.0000000000001, 0.00000000000001, 0.000000000000001, 0.0000000000000001
-	};
-	char sign = 1;
-	uint_least32_t a = 0;
-	float b = 0;
+	return newline;
+}
 
-	while(data[*pos] == ' ' && data[*pos] != '\n' && data[*pos] != '\0'){++*pos;} //skip to number
+void objgl_fstream_delete(void *handle){
+	objfstream_internal *fs = (objfstream_internal*)handle;
 
-	if(!objgl_isnumber(data[*pos])){
-		return 0;
+	if(fs && fs->f){
+		fclose(fs->f);
 	}
 
-	switch(data[*pos]){
-	case '-':
-		sign = -1;
-	case '+':
-		++*pos;
-	default:
-		break;
+	objgl_free(fs);
+}
+
+//the buffer has a spare byte after the terminator, size is NULL if not needed
+char* objgl_readfile(const char *filename, uint_least64_t *size){
+	//a directory opens and seeks fine, its end is just not a size
+	struct stat st;
+
+	if(stat(filename, &st) || !S_ISREG(st.st_mode)){
+		return NULL;
 	}
 
-	for(; objgl_isnumber(data[*pos]) && data[*pos] != '.'; ++*pos){
-		a = a * 10 + data[*pos] - '0';
+	FILE *f = fopen(filename, "rb");
+
+	if(!f){
+		return NULL;
+	}
+
+	long len = fseek(f, 0, SEEK_END) ? -1 : ftell(f);
+
+	if(len < 0 || fseek(f, 0, SEEK_SET)){
+		fclose(f);
+		return NULL;
+	}
+
+	char *buffer = (char*)objgl_alloc(len + 2);
+	len = fread(buffer, sizeof(char), len, f);
+	buffer[len] = '\0';
+
+	fclose(f);
+
+	if(size){
+		*size = len;
+	}
+
+	return buffer;
+}
+#endif
+#endif
+
+#if OBJGL_FSTREAM_IMPL && (OBJGL_ZLIB_IMPL || OBJGL_ZSTD_IMPL)
+//decompresses up to len bytes into dst, 0 at the end of the data (or on a broken file, the load then ends there)
+typedef size_t (*objgl_decode_ptr)(void *decoder, char *dst, size_t len);
+
+#define OBJGL_ZSTREAM_SLOTS 4
+
+typedef struct{
+	char *data;
+	objgl2Size res;
+	objgl2Size end; //the last newline, what the stream reader returns
+	char last;
+} objzslot_internal;
+
+//the decompressor runs ahead on its own thread and fills a ring of buffers that hold whole lines
+typedef struct{
+	void *decoder;
+	objgl_decode_ptr decode;
+	void (*close)(void *decoder);
+	objzslot_internal slots[OBJGL_ZSTREAM_SLOTS];
+	uint_fast32_t head, count; //the filled slots, the parser reads slots[head]
+	char held; //the parser is still reading slots[head], it's released by the next refill
+	char *carry; //the partial line at the end of the last filled slot
+	objgl2Size carryLen, carryRes;
+	char done, quit, threaded;
+	objgl_mutex lock;
+	objgl_cond cond;
+#if OBJGL_THREADS_IMPL
+	objgl_thread thread;
+#endif
+} objzstream_internal;
+
+//returns non-zero if it was the last slot, a slot grows if a single line doesn't fit into it
+char objgl_zstream_fill(objzstream_internal *z, objzslot_internal *slot){
+	objgl2Size len = z->carryLen;
+	objgl2Size newline = (objgl2Size)-1;
+	char eof = 0;
+
+	while(slot->res < len + 1){
+		slot->res += slot->res;
+		slot->data = (char*)objgl_realloc(slot->data, slot->res);
+	}
+
+	if(len){
+		memcpy(slot->data, z->carry, len);
+	}
+
+	z->carryLen = 0;
+
+	while(1){
+		if(len == slot->res){
+			if(newline != (objgl2Size)-1){
+				break;
+			}
+
+			slot->res += slot->res;
+			slot->data = (char*)objgl_realloc(slot->data, slot->res);
+		}
+
+		size_t n = z->decoder ? z->decode(z->decoder, slot->data + len, slot->res - len) : 0;
+
+		if(!n){
+			eof = 1;
+			break;
+		}
+
+		for(objgl2Size i = len + n; i > len; --i){
+			if(slot->data[i - 1] == '\n'){
+				newline = i - 1;
+				break;
+			}
+		}
+
+		len += n;
+	}
+
+	if(eof){
+		//the last line doesn't have to end with a newline
+		if(len && slot->data[len - 1] != '\n'){
+			if(len == slot->res){
+				slot->res += slot->res;
+				slot->data = (char*)objgl_realloc(slot->data, slot->res);
+			}
+
+			slot->data[len++] = '\n';
+		}
+
+		if(!len){
+			slot->data[0] = '\0';
+		}
+
+		slot->end = len ? len - 1 : 0;
+		slot->last = 1;
+
+		return 1;
+	}
+
+	z->carryLen = len - newline - 1;
+
+	if(z->carryLen > z->carryRes){
+		z->carryRes = z->carryLen;
+		z->carry = (char*)objgl_realloc(z->carry, z->carryRes);
+	}
+
+	memcpy(z->carry, slot->data + newline + 1, z->carryLen);
+	slot->end = newline;
+	slot->last = 0;
+
+	return 0;
+}
+
+#if OBJGL_THREADS_IMPL
+#ifdef _WIN32
+DWORD WINAPI objgl_zstream_thread(LPVOID ctx){
+#else
+void* objgl_zstream_thread(void *ctx){
+#endif
+	objzstream_internal *z = (objzstream_internal*)ctx;
+
+	objgl_mutex_lock(&z->lock);
+
+	while(1){
+		while(z->count == OBJGL_ZSTREAM_SLOTS && !z->quit){
+			objgl_cond_wait(&z->cond, &z->lock);
+		}
+
+		if(z->quit){
+			break;
+		}
+
+		//the parser only moves the head past the slots it's done with, so this one stays free
+		objzslot_internal *slot = &z->slots[(z->head + z->count) % OBJGL_ZSTREAM_SLOTS];
+		objgl_mutex_unlock(&z->lock);
+
+		char last = objgl_zstream_fill(z, slot);
+
+		objgl_mutex_lock(&z->lock);
+		++z->count;
+		z->done = last;
+		objgl_cond_broadcast(&z->cond);
+
+		if(last){
+			break;
+		}
+	}
+
+	objgl_mutex_unlock(&z->lock);
+
+	return 0;
+}
+#endif
+
+objgl2StreamInfo objgl_init_zstream(const char *filename, unsigned int bufferSize, void *decoder, objgl_decode_ptr decode, void (*close)(void*)){
+	objzstream_internal *z = (objzstream_internal*)objgl_alloc(sizeof(objzstream_internal));
+	*z = (const objzstream_internal){0};
+	z->decoder = decoder;
+	z->decode = decode;
+	z->close = close;
+
+	for(uint_fast32_t i = 0; i < OBJGL_ZSTREAM_SLOTS; ++i){
+		z->slots[i].res = bufferSize > 16 ? bufferSize : 16;
+		z->slots[i].data = (char*)objgl_alloc(z->slots[i].res);
+	}
+
+	objgl_mutex_init(&z->lock);
+	objgl_cond_init(&z->cond);
+
+	//without a thread the slots are filled by the stream reader itself
+#if OBJGL_THREADS_IMPL
+#ifdef _WIN32
+	z->thread = CreateThread(NULL, 0, objgl_zstream_thread, z, 0, NULL);
+	z->threaded = z->thread != NULL;
+#else
+	z->threaded = !pthread_create(&z->thread, NULL, objgl_zstream_thread, z);
+#endif
+#endif
+
+	objgl2StreamInfo s;
+	s.buffOffset = 0;
+	s.fOffset = 0;
+	s.eof = 0;
+	s.failed = decoder == NULL;
+	s.function = objgl2_zstreamreader;
+	s.buffer = NULL;
+	s.bufferLen = bufferSize;
+	s.type = OBJGL_ZSTREAM;
+	s.handle = z;
+
+	uint_fast32_t len = 0;
+	while(filename[len]){++len;}
+
+	s.filename = (char*)objgl_alloc(len + 1);
+	memcpy(s.filename, filename, len + 1);
+
+	return s;
+}
+
+objgl2Size objgl2_zstreamreader(objgl2StreamInfo *info){
+	objzstream_internal *z = (objzstream_internal*)info->handle;
+
+	objgl_mutex_lock(&z->lock);
+
+	if(z->held){
+		z->held = 0;
+		z->head = (z->head + 1) % OBJGL_ZSTREAM_SLOTS;
+		--z->count;
+		objgl_cond_broadcast(&z->cond);
+	}
+
+	if(!z->threaded && !z->count && !z->done){
+		z->done = objgl_zstream_fill(z, &z->slots[z->head]);
+		++z->count;
+	}
+
+	while(!z->count && !z->done){
+		objgl_cond_wait(&z->cond, &z->lock);
+	}
+
+	objgl2Size end = 0;
+	info->buffOffset = 0;
+	info->eof = 1;
+
+	if(z->count){
+		objzslot_internal *slot = &z->slots[z->head];
+		z->held = 1;
+		info->buffer = slot->data;
+		info->eof = slot->last;
+		end = slot->end;
+	}
+
+	objgl_mutex_unlock(&z->lock);
+
+	return end;
+}
+
+void objgl_zstream_delete(void *handle){
+	objzstream_internal *z = (objzstream_internal*)handle;
+
+	objgl_mutex_lock(&z->lock);
+	z->quit = 1;
+	objgl_cond_broadcast(&z->cond);
+	objgl_mutex_unlock(&z->lock);
+
+#if OBJGL_THREADS_IMPL
+	if(z->threaded){
+#ifdef _WIN32
+		WaitForSingleObject(z->thread, INFINITE);
+		CloseHandle(z->thread);
+#else
+		pthread_join(z->thread, NULL);
+#endif
+	}
+#endif
+
+	if(z->decoder){
+		z->close(z->decoder);
+	}
+
+	for(uint_fast32_t i = 0; i < OBJGL_ZSTREAM_SLOTS; ++i){
+		objgl_free(z->slots[i].data);
+	}
+
+	objgl_cond_destroy(&z->cond);
+	objgl_mutex_destroy(&z->lock);
+	objgl_free(z->carry);
+	objgl_free(z);
+}
+#endif
+
+#if OBJGL_FSTREAM_IMPL && OBJGL_ZLIB_IMPL
+size_t objgl_gz_decode(void *decoder, char *dst, size_t len){
+	int n = gzread((gzFile)decoder, dst, len < 0x40000000 ? (unsigned int)len : 0x40000000);
+
+	return n > 0 ? (size_t)n : 0;
+}
+
+void objgl_gz_close(void *decoder){
+	gzclose((gzFile)decoder);
+}
+
+objgl2StreamInfo objgl2_init_gzstream(const char *filename, unsigned int bufferSize){
+	gzFile f = gzopen(filename, "rb");
+
+	if(f){
+		gzbuffer(f, 1 << 17);
+	}
+
+	return objgl_init_zstream(filename, bufferSize, f, objgl_gz_decode, objgl_gz_close);
+}
+#endif
+
+#if OBJGL_FSTREAM_IMPL && OBJGL_ZSTD_IMPL
+typedef struct{
+	FILE *f;
+	ZSTD_DStream *stream;
+	ZSTD_inBuffer in;
+	char *input;
+	size_t inputRes;
+	char flush; //the last call filled the output, the decoder may still hold some
+} objzstd_internal;
+
+size_t objgl_zstd_decode(void *decoder, char *dst, size_t len){
+	objzstd_internal *z = (objzstd_internal*)decoder;
+	ZSTD_outBuffer out = {dst, len, 0};
+
+	while(!out.pos){
+		if(z->in.pos == z->in.size && !z->flush){
+			z->in.size = fread(z->input, 1, z->inputRes, z->f);
+			z->in.pos = 0;
+
+			if(!z->in.size){
+				return 0;
+			}
+		}
+
+		if(ZSTD_isError(ZSTD_decompressStream(z->stream, &out, &z->in))){
+			return out.pos;
+		}
+
+		z->flush = out.pos == out.size;
+	}
+
+	return out.pos;
+}
+
+void objgl_zstd_close(void *decoder){
+	objzstd_internal *z = (objzstd_internal*)decoder;
+
+	fclose(z->f);
+	ZSTD_freeDStream(z->stream);
+	objgl_free(z->input);
+	objgl_free(z);
+}
+
+objgl2StreamInfo objgl2_init_zstdstream(const char *filename, unsigned int bufferSize){
+	objzstd_internal *z = NULL;
+	FILE *f = fopen(filename, "rb");
+
+	if(f){
+		z = (objzstd_internal*)objgl_alloc(sizeof(objzstd_internal));
+		*z = (const objzstd_internal){0};
+		z->f = f;
+		z->stream = ZSTD_createDStream();
+		ZSTD_initDStream(z->stream);
+		z->inputRes = ZSTD_DStreamInSize();
+		z->input = (char*)objgl_alloc(z->inputRes);
+		z->in.src = z->input;
+	}
+
+	return objgl_init_zstream(filename, bufferSize, z, objgl_zstd_decode, objgl_zstd_close);
+}
+#endif
+
+char objgl_isnumber(char c){
+	return (c > 47 && c < 58) || c == '-' || c == '.' || c == '+';
+}
+
+//the separators within a line, '\r' is the end of a CRLF one
+char objgl_isblank(char c){
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+char objgl_isletter(char c){
+	return (c > 64 && c < 91) || (c > 96 && c < 123) || c == '_';
+}
+
+char objgl_strcmp(char *a, char *b){
+	uint_fast32_t ptr = 0;
+
+	while(a[ptr] && b[ptr]){
+		if(a[ptr] != b[ptr]){
+			return 0;
+		}
+		++ptr;
+	}
+
+	return 1;
+}
+
+uint_least32_t objgl_strlen(const char *a){
+	uint_least32_t len = 0;
+
+	while(a[len] != ' ' && a[len] != '\n' && a[len] != '\0' && a[len] != '\r' && a[len] != '\t'){
+		++len;
+	}
+
+	return len;
+}
+
+float objgl_atof(char* data, objgl_pos *pos){
+	static const double fractLookup[16] = { //read-only, so the parser stays reentrant
+		0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001, 0.00000001, 0.000000001, 0.0000000001,
+		0.00000000001, 0.000000000001, 0.0000000000001, 0.00000000000001, 0.000000000000001, 0.0000000000000001
+	};
+	char sign = 1;
+	uint_least32_t a = 0;
+	float b = 0;
+
+	while(objgl_isblank(data[*pos])){++*pos;} //skip to number
+
+	if(!objgl_isnumber(data[*pos])){
+		return 0;
+	}
+
+	switch(data[*pos]){
+	case '-':
+		sign = -1;
+	case '+':
+		++*pos;
+	default:
+		break;
+	}
+
+	for(; objgl_isnumber(data[*pos]) && data[*pos] != '.'; ++*pos){
+		a = a * 10 + data[*pos] - '0';
 	}
 
 	if(data[*pos]== '.'){
@@ -269,11 +1294,11 @@ float objgl_atof(char* data, uint_fast32_t *pos){
 	return ((float)a + b) * sign;
 }
 
-uint_least32_t objgl_atoi(char* data, uint_fast32_t *pos){
-	int_least32_t sign = 1;
-	uint_least32_t a = 0;
+objgl_sindex objgl_atoi(char* data, objgl_pos *pos){
+	objgl_sindex sign = 1;
+	objgl2Index a = 0;
 
-	while(data[*pos] == ' ' && data[*pos] != '\n' && data[*pos] != '\0'){++*pos;} //skip to number
+	while(objgl_isblank(data[*pos])){++*pos;} //skip to number
 
 	if(!objgl_isnumber(data[*pos])){
 		return 0;
@@ -300,10 +1325,10 @@ uint_least32_t objgl_atoi(char* data, uint_fast32_t *pos){
 		}
 	}
 
-	return (int_least32_t)a * sign;
+	return (objgl_sindex)a * sign;
 }
 
-objgl_vec4 objgl_parsevector(char* data, uint_fast32_t *pos){
+objgl_vec4 objgl_parsevector(char* data, objgl_pos *pos){
 	objgl_vec4 vector = {{1}};
 	uint_least32_t component = 0;
 
@@ -313,37 +1338,43 @@ objgl_vec4 objgl_parsevector(char* data, uint_fast32_t *pos){
 	}
 
 	while(data[*pos] != '\n' && data[*pos] != '\0'){++*pos;}
-	++*pos;
+	*pos += data[*pos] == '\n';
 
 	return vector;
 }
 
-uint_least32_t objgl_parseindices(char* data, uint_fast32_t *pos, objcache_internal *cache, objinfo_internal *info){
+//returns 0 for a line that isn't only indices ('\0' ends it too, a comment after them is fine), *pos is then at its end
+uint_least32_t objgl_parseindices(char* data, objgl_pos *pos, objcache_internal *cache, objinfo_internal *info, objgl2Stats *stats){
 	uint_fast32_t numVerts = 0;
 	uint_fast32_t component = 0;
 
 	uint_fast32_t cacheSize = cache->cacheSize;
 	char wasSpace = 0;
 
-	while(data[*pos] == ' '){++*pos;}
+	while(objgl_isblank(data[*pos])){++*pos;}
+
+	while(data[*pos] != '\n' && data[*pos] != '\0' && data[*pos] != '#'){
+		if(wasSpace){
+			wasSpace = 0;
+			component = 0;
+			++numVerts;
+		}
 
-	while(data[*pos] != '\n'){
 		if(numVerts >= cacheSize){
 			uint_fast32_t oldsize = cacheSize;
 			cacheSize += 32;
 			cache->cacheSize = cacheSize;
-			cache->cache = (objfacevert*)objgl_realloc(cache->cache, cacheSize * sizeof(objfacevert), oldsize * sizeof(objfacevert));
+			cache->cache = (objfacevert*)objgl_trealloc(stats, cache->cache, cacheSize * sizeof(objfacevert), oldsize * sizeof(objfacevert));
 		}
 
-		if(wasSpace){
-			wasSpace = 0;
-			component = 0;
-			++numVerts;
+		if(!component){
+			cache->cache[numVerts] = (const objfacevert){{0}};
 		}
 
-		int_least32_t ind = objgl_atoi(data, pos);
+		objgl_sindex ind = objgl_atoi(data, pos);
 
-		if(ind < 0){
+		//without info the negative indices are left for the caller (the reloader makes them chunk-relative)
+		if(ind < 0 && info){
 			switch(component){
 			case 0:
 				ind = info->numPositions + ind + 1;
@@ -363,339 +1394,4877 @@ uint_least32_t objgl_parseindices(char* data, uint_fast32_t *pos, objcache_inter
 
 		switch(data[*pos]){
 		case ' ':
+		case '\t':
+		case '\r':
 			wasSpace = 1;
-			while(data[*pos] == ' '){++*pos;}
+			while(objgl_isblank(data[*pos])){++*pos;}
 			break;
 		case '/':
-			++component;
-			++*pos;
-			break;
+			if(++component < 3){
+				++*pos;
+				break;
+			}
+			//fall through, a fourth component is as broken as a stray character
+		default:
+			if(data[*pos] == '\n' || data[*pos] == '\0' || data[*pos] == '#'){
+				break;
+			}
+
+			while(data[*pos] != '\n' && data[*pos] != '\0'){++*pos;}
+			return 0;
 		}
 	}
 
+	while(data[*pos] != '\n' && data[*pos] != '\0'){++*pos;}
+
 	return ++numVerts;
 }
 
-objgl2Data objgl2_readobj(objgl2StreamInfo *strinfoptr){
-#if OBJGL_DEBUG
-	_debugmemory = 0;
-	_debugallocs = 0;
-#endif
-	objgl2_streamreader_ptr streamreader = strinfoptr->function;
-	objgl2StreamInfo strinfo = *strinfoptr;
-	uint_least32_t bufferLen = streamreader(&strinfo);
-	uint_fast32_t buffPos = strinfo.buffOffset;
+//why OBJGL2_VALIDATE rejects an index, per component
+const char* const objgl_badindex[3] = {
+	"a position index that's 0 or past the positions read before the face",
+	"a texcoord index that's 0 or past the texcoords read before the face",
+	"a normal index that's 0 or past the normals read before the face"
+};
+
+//why OBJGL2_VALIDATE rejects a face, NULL if it can be assembled. The indices must point at the attributes read before the face,
+//the texcoords and normals only if the first vertex has them, without them on the first one the object has none
+const char* objgl_checkface(const objfacevert *verts, uint_fast32_t num, const objinfo_internal *info){
+	if(num < 3){
+		return "a face with less than 3 vertices";
+	}
 
-	objinfo_internal info = (const objinfo_internal){0, 0, 0, 256, 256, 256};
+	objgl2Index checkTexcoords = verts[0].a[1] ? 1 : 0, checkNormals = verts[0].a[2] ? 1 : 0;
+	objgl2Index badPositions = 0, badTexcoords = 0, badNormals = 0;
 
-	objgl_vec3 *positions = (objgl_vec3*)objgl_alloc(sizeof(objgl_vec3) * info.resPositions);
-	objgl_vec3 *normals = (objgl_vec3*)objgl_alloc(sizeof(objgl_vec3) * info.resNormals);
-	objgl_vec2 *texcoords = (objgl_vec2*)objgl_alloc(sizeof(objgl_vec2) * info.resTexcoords);
+	//0 wraps around, so one unsigned compare catches both ends
+	for(uint_fast32_t i = 0; i < num; ++i){
+		badPositions |= (objgl2Index)(verts[i].a[0] - 1) >= (objgl2Index)info->numPositions;
+		badTexcoords |= (objgl2Index)(verts[i].a[1] - 1) >= (objgl2Index)info->numTexcoords;
+		badNormals |= (objgl2Index)(verts[i].a[2] - 1) >= (objgl2Index)info->numNormals;
+	}
 
-	objmaterial_internal curMaterial = (const objmaterial_internal){0};
-	curMaterial.resIndices = 256;
-	curMaterial.numIndices = 0;
-	curMaterial.indices = (objfacevert*)objgl_alloc(sizeof(objfacevert) * curMaterial.resIndices);
+	if(badPositions){
+		return objgl_badindex[0];
+	} else if(badTexcoords & checkTexcoords){
+		return objgl_badindex[1];
+	} else if(badNormals & checkNormals){
+		return objgl_badindex[2];
+	}
 
-	uint_fast32_t resMaterials = 64;
-	uint_fast32_t numMaterials = 1;
-	objmaterial_internal *materials = (objmaterial_internal*)objgl_alloc(sizeof(objmaterial_internal) * resMaterials);
-	materials[0] = curMaterial;
+	return NULL;
+}
 
-	uint_fast32_t matIndex = 0;
+//drops the texcoord and normal indices the load skips, keep* is 0 to drop the component and all ones to keep it
+void objgl_keepcomponents(objfacevert *verts, uint_fast32_t num, objgl2Index keepTexcoords, objgl2Index keepNormals){
+	for(uint_fast32_t i = 0; i < num; ++i){
+		verts[i].a[1] &= keepTexcoords;
+		verts[i].a[2] &= keepNormals;
+	}
+}
 
-	void *xyz = objgl_alloc(sizeof(objfacevert) * 32);
-	objcache_internal vertCache = (objcache_internal){(objfacevert*)xyz, 32};
+char objgl_iskeyword(const char *data, const char *keyword){
+	uint_fast32_t i = 0;
 
-	uint_fast32_t numIndices = 0;
-	char* name = NULL;
-	char hasTextures = 1;
-	char hasNormals = 1;
+	for(; keyword[i]; ++i){
+		if(data[i] != keyword[i]){
+			return 0;
+		}
+	}
 
-	while(1){
-		while(buffPos < bufferLen){
-			switch(strinfo.buffer[buffPos]){
-			case 'v':{
-				++buffPos;
-				unsigned int mode = 0;
-
-				switch(strinfo.buffer[buffPos]){
-				case 'n':
-					++buffPos;
-					mode = 1;
-					break;
-				case 't':
-					++buffPos;
-					mode = 2;
-					break;
-				default:
-					break;
-				}
+	return data[i] == ' ' || data[i] == '\t';
+}
 
-				objgl_vec4 vec = objgl_parsevector(strinfo.buffer, &buffPos);
+uint_fast32_t objgl_dirlen(const char *path){
+	uint_fast32_t len = 0;
 
-				switch(mode){
-				case 0:
-					if(info.numPositions >= info.resPositions){
-						uint_fast32_t oldsize = info.resPositions;
-						info.resPositions += info.resPositions;
-						positions = (objgl_vec3*)objgl_realloc(positions, sizeof(objgl_vec3) * info.resPositions, sizeof(objgl_vec3) * oldsize);
-					}
+	for(uint_fast32_t i = 0; path[i]; ++i){
+		if(path[i] == '/' || path[i] == '\\'){
+			len = i + 1;
+		}
+	}
 
-					positions[info.numPositions++] = *((objgl_vec3*)&vec);
-					break;
-				case 1:
-					if(info.numNormals >= info.resNormals){
-						uint_fast32_t oldsize = info.resNormals;
-						info.resNormals += info.resNormals;
-						normals = (objgl_vec3*)objgl_realloc(normals, sizeof(objgl_vec3) * info.resNormals, sizeof(objgl_vec3) * oldsize);
-					}
+	return len;
+}
+
+//joins the directory (dirlen bytes of dir) with the relative path, absolute paths are copied as they are
+char* objgl_joinpath(const char *dir, uint_fast32_t dirlen, const char *path, uint_fast32_t len, uint_fast32_t *joinedlen){
+	if(path[0] == '/' || path[0] == '\\' || (len > 1 && path[1] == ':')){
+		dirlen = 0;
+	}
+
+	*joinedlen = dirlen + len;
+	char *joined = (char*)objgl_alloc(dirlen + len + 1);
+
+	for(uint_fast32_t i = 0; i < dirlen; ++i){
+		joined[i] = dir[i];
+	}
+
+	for(uint_fast32_t i = 0; i < len; ++i){
+		joined[dirlen + i] = path[i];
+	}
+
+	joined[dirlen + len] = '\0';
+
+	return joined;
+}
+
+char objgl_mtllib_eq(const void *ctx, uint_least32_t index, const char *str, uint_fast32_t len){
+	const objgl2MtlDB *db = (const objgl2MtlDB*)ctx;
+	objmtllib_internal lib = db->libraries[index];
+
+	return lib.pathLen == len && objgl_strneq(lib.path, str, len);
+}
+
+char objgl_texture_eq(const void *ctx, uint_least32_t index, const char *str, uint_fast32_t len){
+	const char *texture = ((const objgl2MtlDB*)ctx)->textures[index];
+
+	return objgl_strneq(texture, str, len) && texture[len] == '\0';
+}
+
+char objgl_mtlmaterial_eq(const void *ctx, uint_least32_t index, const char *str, uint_fast32_t len){
+	const char *name = ((const objmtllib_internal*)ctx)->materials[index].name;
+
+	return objgl_strneq(name, str, len) && name[len] == '\0';
+}
+
+objgl2MtlDB* objgl2_mtldb_create(void){
+	objgl2MtlDB *db = (objgl2MtlDB*)objgl_alloc(sizeof(objgl2MtlDB));
+	*db = (const objgl2MtlDB){0};
+	objgl_mutex_init(&db->lock);
+
+	return db;
+}
+
+void objgl2_mtldb_delete(objgl2MtlDB *db){
+	if(!db){
+		return;
+	}
+
+	for(uint_fast32_t i = 0; i < db->numLibraries; ++i){
+		objgl_free(db->libraries[i].path);
+		objgl_free(db->libraries[i].materials);
+		objgl_free(db->libraries[i].names);
+		objgl_free(db->libraries[i].table.slots);
+	}
+
+	for(uint_fast32_t i = 0; i < db->numTextures; ++i){
+		objgl_free(db->textures[i]);
+	}
+
+	objgl_free(db->libraries);
+	objgl_free(db->libTable.slots);
+	objgl_free(db->textures);
+	objgl_free(db->texTable.slots);
+	objgl_mutex_destroy(&db->lock);
+	objgl_free(db);
+}
+
+uint_least32_t objgl2_mtldb_numtextures(const objgl2MtlDB *db){
+	objgl_mutex_lock((objgl_mutex*)&db->lock);
+	uint_least32_t numTextures = db->numTextures;
+	objgl_mutex_unlock((objgl_mutex*)&db->lock);
+
+	return numTextures;
+}
+
+const char* objgl2_mtldb_texture(const objgl2MtlDB *db, uint_least32_t texture){
+	objgl_mutex_lock((objgl_mutex*)&db->lock);
+	const char *path = texture < db->numTextures ? db->textures[texture] : NULL;
+	objgl_mutex_unlock((objgl_mutex*)&db->lock);
+
+	return path;
+}
+
+//takes the ownership of the path
+uint_least32_t objgl_mtldb_addtexture(objgl2MtlDB *db, char *path, uint_fast32_t len){
+	uint_least32_t hash = objgl2_hashfunc32_string(path, len);
+	uint_least32_t texture = objgl_strtable_find(&db->texTable, hash, path, len, objgl_texture_eq, db);
+
+	if(texture != OBJGL_NOTFOUND){
+		objgl_free(path);
+		return texture;
+	}
+
+	if(db->numTextures >= db->resTextures){
+		db->resTextures += db->resTextures + 16;
+		db->textures = (char**)objgl_realloc(db->textures, sizeof(char*) * db->resTextures);
+	}
+
+	texture = db->numTextures++;
+	db->textures[texture] = path;
+	objgl_strtable_insert(&db->texTable, hash, texture, NULL);
+
+	return texture;
+}
+
+//texture statements may start with options such as -s 1 1 1 or -clamp on, the path is whatever follows them
+uint_least32_t objgl_mtl_parsemap(objgl2MtlDB *db, const char *dir, uint_fast32_t dirlen, const char *data, objgl_pos *pos){
+	while(1){
+		while(data[*pos] == ' ' || data[*pos] == '\t'){++*pos;}
+
+		if(data[*pos] != '-' || !objgl_isletter(data[*pos + 1])){
+			break;
+		}
+
+		char oneArg = objgl_iskeyword(&data[*pos], "-imfchan") || objgl_iskeyword(&data[*pos], "-type");
+
+		*pos += objgl_strlen(&data[*pos]);
+
+		for(uint_fast32_t args = 0; ; ++args){
+			while(data[*pos] == ' ' || data[*pos] == '\t'){++*pos;}
+
+			const char *arg = &data[*pos];
+			char isArg = oneArg ? args < 1 : (objgl_isnumber(arg[0]) && !(arg[0] == '-' && objgl_isletter(arg[1]))) || objgl_iskeyword(arg, "on") || objgl_iskeyword(arg, "off");
+
+			if(!isArg || arg[0] == '\n' || arg[0] == '\r' || arg[0] == '\0'){
+				break;
+			}
+
+			*pos += objgl_strlen(arg);
+		}
+	}
+
+	const char *path = &data[*pos];
+	uint_fast32_t len = 0;
+
+	for(uint_fast32_t i = 0; path[i] != '\n' && path[i] != '\0'; ++i){
+		if(path[i] != ' ' && path[i] != '\t' && path[i] != '\r'){
+			len = i + 1;
+		}
+	}
+
+	if(!len){
+		return OBJGL2_NOTEXTURE;
+	}
+
+	char *joined = objgl_joinpath(dir, dirlen, path, len, &len);
+
+	return objgl_mtldb_addtexture(db, joined, len);
+}
+
+void objgl_mtl_parsecolor(float *color, const char *data, objgl_pos *pos){
+	color[0] = objgl_atof((char*)data, pos);
+
+	while(objgl_isblank(data[*pos])){++*pos;}
+
+	//a line with only r is a grey, a 0 g and b are just a 0 g and b
+	if(data[*pos] == '\n' || data[*pos] == '\0'){
+		color[1] = color[2] = color[0];
+		return;
+	}
+
+	color[1] = objgl_atof((char*)data, pos);
+	color[2] = objgl_atof((char*)data, pos);
+}
+
+void objgl_mtl_parse(objgl2MtlDB *db, objmtllib_internal *lib, const char *data){
+	static const struct{
+		const char *keyword;
+		uint_least32_t map;
+	} maps[] = {
+		{"map_Ka", OBJGL2_MAP_AMBIENT}, {"map_Kd", OBJGL2_MAP_DIFFUSE}, {"map_Ks", OBJGL2_MAP_SPECULAR},
+		{"map_Ke", OBJGL2_MAP_EMISSIVE}, {"map_Ns", OBJGL2_MAP_SHININESS}, {"map_d", OBJGL2_MAP_OPACITY},
+		{"map_bump", OBJGL2_MAP_BUMP}, {"map_Bump", OBJGL2_MAP_BUMP}, {"bump", OBJGL2_MAP_BUMP}
+	};
+
+	uint_fast32_t dirlen = objgl_dirlen(lib->path);
+	uint_fast32_t resMaterials = 0;
+	objstrpool_internal names = (const objstrpool_internal){0};
+	objgl2MtlMaterial *mat = NULL;
+	objgl_pos pos = 0;
+
+	while(data[pos]){
+		while(data[pos] == ' ' || data[pos] == '\t'){++pos;}
+
+		const char *line = &data[pos];
+
+		if(objgl_iskeyword(line, "newmtl")){
+			pos += 6;
+			while(data[pos] == ' ' || data[pos] == '\t'){++pos;}
+
+			if(lib->numMaterials >= resMaterials){
+				resMaterials += resMaterials + 16;
+				lib->materials = (objgl2MtlMaterial*)objgl_realloc(lib->materials, sizeof(objgl2MtlMaterial) * resMaterials);
+			}
+
+			mat = &lib->materials[lib->numMaterials++];
+			*mat = (const objgl2MtlMaterial){{0}};
+			mat->diffuse[0] = mat->diffuse[1] = mat->diffuse[2] = 1;
+			mat->opacity = 1;
+			mat->ior = 1;
+
+			for(uint_fast32_t i = 0; i < OBJGL2_MAP_COUNT; ++i){
+				mat->maps[i] = OBJGL2_NOTEXTURE;
+			}
+
+			//the name is an offset into the pool until the pool stops growing
+			mat->name = (const char*)(uintptr_t)objgl_strpool_add(&names, &data[pos], objgl_strlen(&data[pos]), NULL);
+		} else if(mat){
+			char isMap = 0;
+
+			for(uint_fast32_t i = 0; i < sizeof(maps) / sizeof(maps[0]) && !isMap; ++i){
+				if(objgl_iskeyword(line, maps[i].keyword)){
+					isMap = 1;
+					while(data[pos] != ' ' && data[pos] != '\t'){++pos;}
+					mat->maps[maps[i].map] = objgl_mtl_parsemap(db, lib->path, dirlen, data, &pos);
+				}
+			}
+
+			if(isMap){
+			} else if(objgl_iskeyword(line, "Ka")){
+				pos += 2;
+				objgl_mtl_parsecolor(mat->ambient, data, &pos);
+			} else if(objgl_iskeyword(line, "Kd")){
+				pos += 2;
+				objgl_mtl_parsecolor(mat->diffuse, data, &pos);
+			} else if(objgl_iskeyword(line, "Ks")){
+				pos += 2;
+				objgl_mtl_parsecolor(mat->specular, data, &pos);
+			} else if(objgl_iskeyword(line, "Ke")){
+				pos += 2;
+				objgl_mtl_parsecolor(mat->emissive, data, &pos);
+			} else if(objgl_iskeyword(line, "Ns")){
+				pos += 2;
+				mat->shininess = objgl_atof((char*)data, &pos);
+			} else if(objgl_iskeyword(line, "Ni")){
+				pos += 2;
+				mat->ior = objgl_atof((char*)data, &pos);
+			} else if(objgl_iskeyword(line, "d")){
+				pos += 1;
+				mat->opacity = objgl_atof((char*)data, &pos);
+			} else if(objgl_iskeyword(line, "Tr")){
+				pos += 2;
+				mat->opacity = 1 - objgl_atof((char*)data, &pos);
+			} else if(objgl_iskeyword(line, "illum")){
+				pos += 5;
+				mat->illum = (int_least32_t)objgl_atoi((char*)data, &pos);
+			}
+		}
+
+		while(data[pos] != '\n' && data[pos] != '\0'){++pos;}
+		pos += data[pos] == '\n';
+	}
+
+	lib->names = names.data;
+
+	for(uint_fast32_t i = 0; i < lib->numMaterials; ++i){
+		objgl2MtlMaterial *m = &lib->materials[i];
+		m->name = &names.data[(uintptr_t)m->name];
+
+		uint_fast32_t len = 0;
+		while(m->name[len]){++len;}
+
+		uint_least32_t hash = objgl2_hashfunc32_string(m->name, len);
+
+		//the first definition wins, just like in most of the other loaders
+		if(objgl_strtable_find(&lib->table, hash, m->name, len, objgl_mtlmaterial_eq, lib) == OBJGL_NOTFOUND){
+			objgl_strtable_insert(&lib->table, hash, i, NULL);
+		}
+	}
+}
+
+//finds the library in the cache or parses it (from the buffer, or from the file if buffer is NULL), takes the ownership of the path
+uint_least32_t objgl_mtldb_library(objgl2MtlDB *db, char *path, uint_fast32_t len, const char *buffer){
+	uint_least32_t hash = objgl2_hashfunc32_string(path, len);
+	uint_least32_t index = objgl_strtable_find(&db->libTable, hash, path, len, objgl_mtllib_eq, db);
+
+	if(index != OBJGL_NOTFOUND){
+		objgl_free(path);
+		return index;
+	}
+
+	if(db->numLibraries >= db->resLibraries){
+		db->resLibraries += db->resLibraries + 8;
+		db->libraries = (objmtllib_internal*)objgl_realloc(db->libraries, sizeof(objmtllib_internal) * db->resLibraries);
+	}
+
+	index = db->numLibraries++;
+	objmtllib_internal *lib = &db->libraries[index];
+	*lib = (const objmtllib_internal){0};
+	lib->path = path;
+	lib->pathLen = len;
+
+	char *file = NULL;
+
+#ifdef OBJGL_FSTREAM_IMPL
+#if OBJGL_FSTREAM_IMPL
+	if(!buffer){
+		buffer = file = objgl_readfile(path, NULL);
+	}
+#endif
+#endif
+
+	//a missing file is cached as an empty library, so it's not looked up again
+	if(buffer){
+		objgl_mtl_parse(db, lib, buffer);
+	}
+
+	objgl_free(file);
+	objgl_strtable_insert(&db->libTable, hash, index, NULL);
+
+	return index;
+}
+
+uint_least32_t objgl2_mtldb_addbuffer(objgl2MtlDB *db, const char *path, const char *buffer){
+	uint_fast32_t len = 0;
+	while(path[len]){++len;}
+
+	char *joined = objgl_joinpath(NULL, 0, path, len, &len);
+
+	objgl_mutex_lock(&db->lock);
+	uint_least32_t index = objgl_mtldb_library(db, joined, len, buffer);
+	uint_least32_t numMaterials = db->libraries[index].numMaterials;
+	objgl_mutex_unlock(&db->lock);
+
+	return numMaterials;
+}
+
+const objgl2MtlMaterial* objgl_mtllib_find(const objmtllib_internal *lib, uint_least32_t hash, const char *name, uint_fast32_t len){
+	uint_least32_t index = objgl_strtable_find(&lib->table, hash, name, len, objgl_mtlmaterial_eq, lib);
+
+	return index == OBJGL_NOTFOUND ? NULL : &lib->materials[index];
+}
+
+const objgl2MtlMaterial* objgl2_mtldb_find(const objgl2MtlDB *db, const char *name){
+	uint_fast32_t len = 0;
+	while(name[len]){++len;}
+
+	uint_least32_t hash = objgl2_hashfunc32_string(name, len);
+	const objgl2MtlMaterial *mat = NULL;
+
+	objgl_mutex_lock((objgl_mutex*)&db->lock);
+
+	for(uint_fast32_t i = 0; i < db->numLibraries && !mat; ++i){
+		mat = objgl_mtllib_find(&db->libraries[i], hash, name, len);
+	}
+
+	objgl_mutex_unlock((objgl_mutex*)&db->lock);
+
+	return mat;
+}
+
+typedef struct __ObjGLJob objjob_internal;
+
+struct __ObjGLJob{
+	objgl2_task_ptr fn;
+	void *ctx;
+	uint_least32_t count, next, done; //next - the first call nobody took yet
+	objjob_internal *nextJob; //queue link, the job leaves the queue once next reaches count
+};
+
+typedef struct{
+	objgl2Scheduler scheduler; //first, so objgl2_threadpool_delete gets the pool back
+	objgl_mutex lock;
+	objgl_cond wake, finished;
+	objjob_internal *head, *tail;
+#if OBJGL_THREADS_IMPL
+	objgl_thread *threads;
+#endif
+	unsigned int numThreads;
+	char quit;
+} objpool_internal;
+
+unsigned int objgl_numcores(void){
+#if OBJGL_THREADS_IMPL
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	return info.dwNumberOfProcessors;
+#else
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return cores > 0 ? (unsigned int)cores : 1;
+#endif
+#else
+	return 1;
+#endif
+}
+
+//takes one call of the job and runs it, the lock is held on entry and on return
+void objgl_pool_runone(objpool_internal *pool, objjob_internal *job){
+	uint_least32_t index = job->next++;
+
+	if(job->next == job->count){
+		objjob_internal **link = &pool->head;
+		objjob_internal *prev = NULL;
+
+		while(*link != job){
+			prev = *link;
+			link = &prev->nextJob;
+		}
+
+		*link = job->nextJob;
+
+		if(pool->tail == job){
+			pool->tail = prev;
+		}
+	}
+
+	objgl_mutex_unlock(&pool->lock);
+	job->fn(job->ctx, index);
+	objgl_mutex_lock(&pool->lock);
+
+	if(++job->done == job->count){
+		objgl_cond_broadcast(&pool->finished);
+	}
+}
+
+void objgl_pool_work(objpool_internal *pool){
+	objgl_mutex_lock(&pool->lock);
+
+	while(1){
+		while(!pool->head && !pool->quit){
+			objgl_cond_wait(&pool->wake, &pool->lock);
+		}
+
+		if(!pool->head){
+			break;
+		}
+
+		objgl_pool_runone(pool, pool->head);
+	}
+
+	objgl_mutex_unlock(&pool->lock);
+}
+
+void* objgl_pool_submit(void *userdata, objgl2_task_ptr fn, void *ctx, uint_least32_t count){
+	objpool_internal *pool = (objpool_internal*)userdata;
+	objjob_internal *job = (objjob_internal*)objgl_alloc(sizeof(objjob_internal));
+	*job = (const objjob_internal){fn, ctx, count, 0, 0, NULL};
+
+	if(!count){
+		return job;
+	}
+
+	objgl_mutex_lock(&pool->lock);
+
+	if(pool->tail){
+		pool->tail->nextJob = job;
+	} else{
+		pool->head = job;
+	}
+
+	pool->tail = job;
+	objgl_cond_broadcast(&pool->wake);
+	objgl_mutex_unlock(&pool->lock);
+
+	return job;
+}
+
+//the waiting thread runs the calls of its own job nobody took yet, so waiting from inside of a task can't deadlock
+void objgl_pool_wait(void *userdata, void *handle){
+	objpool_internal *pool = (objpool_internal*)userdata;
+	objjob_internal *job = (objjob_internal*)handle;
+
+	objgl_mutex_lock(&pool->lock);
+
+	while(job->done < job->count){
+		if(job->next < job->count){
+			objgl_pool_runone(pool, job);
+		} else{
+			objgl_cond_wait(&pool->finished, &pool->lock);
+		}
+	}
+
+	objgl_mutex_unlock(&pool->lock);
+	objgl_free(job);
+}
+
+#if OBJGL_THREADS_IMPL
+#ifdef _WIN32
+DWORD WINAPI objgl_pool_thread(LPVOID ctx){
+	objgl_pool_work((objpool_internal*)ctx);
+	return 0;
+}
+#else
+void* objgl_pool_thread(void *ctx){
+	objgl_pool_work((objpool_internal*)ctx);
+	return NULL;
+}
+#endif
+#endif
+
+objgl2Scheduler* objgl2_threadpool_create(unsigned int numThreads){
+	objpool_internal *pool = (objpool_internal*)objgl_alloc(sizeof(objpool_internal));
+	*pool = (const objpool_internal){0};
+	pool->scheduler.userdata = pool;
+	pool->scheduler.submit = objgl_pool_submit;
+	pool->scheduler.wait = objgl_pool_wait;
+
+	objgl_mutex_init(&pool->lock);
+	objgl_cond_init(&pool->wake);
+	objgl_cond_init(&pool->finished);
+
+#if OBJGL_THREADS_IMPL
+	if(!numThreads){
+		numThreads = objgl_numcores() - 1;
+	}
+
+	pool->threads = (objgl_thread*)objgl_alloc(sizeof(objgl_thread) * (numThreads + !numThreads));
+
+	//the waiting thread helps, so a pool that couldn't start a single thread still works
+	for(unsigned int i = 0; i < numThreads; ++i){
+#ifdef _WIN32
+		pool->threads[pool->numThreads] = CreateThread(NULL, 0, objgl_pool_thread, pool, 0, NULL);
+		pool->numThreads += pool->threads[pool->numThreads] != NULL;
+#else
+		pool->numThreads += !pthread_create(&pool->threads[pool->numThreads], NULL, objgl_pool_thread, pool);
+#endif
+	}
+#endif
+
+	return &pool->scheduler;
+}
+
+void objgl2_threadpool_delete(objgl2Scheduler *scheduler){
+	if(!scheduler){
+		return;
+	}
+
+	objpool_internal *pool = (objpool_internal*)scheduler->userdata;
+
+	objgl_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	objgl_cond_broadcast(&pool->wake);
+	objgl_mutex_unlock(&pool->lock);
+
+#if OBJGL_THREADS_IMPL
+	for(unsigned int i = 0; i < pool->numThreads; ++i){
+#ifdef _WIN32
+		WaitForSingleObject(pool->threads[i], INFINITE);
+		CloseHandle(pool->threads[i]);
+#else
+		pthread_join(pool->threads[i], NULL);
+#endif
+	}
+
+	objgl_free(pool->threads);
+#endif
+
+	objgl_cond_destroy(&pool->wake);
+	objgl_cond_destroy(&pool->finished);
+	objgl_mutex_destroy(&pool->lock);
+	objgl_free(pool);
+}
+
+//bytes left in the stream, 0 if it can't be told
+uint_least64_t objgl_streamsize(const objgl2StreamInfo *strinfo){
+	if(strinfo->type == OBJGL_BSTREAM && strinfo->function == objgl2_bufferstreamreader && strinfo->buffer){
+		return strlen(strinfo->buffer + strinfo->buffOffset);
+	}
+
+#ifdef OBJGL_FSTREAM_IMPL
+#if OBJGL_FSTREAM_IMPL
+	struct stat st;
+
+	if(strinfo->type == OBJGL_FSTREAM && strinfo->filename && !stat(strinfo->filename, &st) && S_ISREG(st.st_mode)){
+		return (uint_least64_t)st.st_size > strinfo->fOffset ? (uint_least64_t)st.st_size - strinfo->fOffset : 0;
+	}
+#endif
+#endif
+
+	return 0;
+}
+
+//vertices per assembly task, every task writes its own range of data
+#define OBJGL_ASSEMBLY_CHUNK 65536
+//outputs at least this big are written with non-temporal stores, they wouldn't stay in the caches anyway
+#define OBJGL_STREAM_BYTES (8 << 20)
+
+//writes the vertices begin to end from their keys, stride bytes apart
+void objgl_assemble_keys(void *data, size_t stride, const objfacevert *keys, objgl_count begin, objgl_count end, const objgl_vec3 *positions, const objgl_vec2 *texcoords, const objgl_vec3 *normals, char hasTextures, char hasNormals){
+	for(objgl_count i = begin; i < end; ++i){
+		char *vert = (char*)data + (size_t)i * stride;
+		*((objgl_vec3*)vert) = positions[keys[i].a[0] - 1];
+
+		if(hasTextures){
+			*((objgl_vec2*)(vert + sizeof(float) * 3)) = texcoords[keys[i].a[1] - 1];
+		}
+
+		if(hasNormals){
+			*((objgl_vec3*)(vert + sizeof(float) * (3 + 2 * hasTextures))) = normals[keys[i].a[2] - 1];
+		}
+	}
+}
+
+#if OBJGL_STREAMSTORES
+//vertices assembled on the stack before they're streamed out, a multiple of 16 so the batches start as aligned as data
+#define OBJGL_STREAM_BATCH 128
+
+//copies with non-temporal stores, the unaligned ends go through the caches
+void objgl_stream_copy(char *dst, const char *src, size_t len){
+	for(; len && ((size_t)dst & 15); --len){
+		*dst++ = *src++;
+	}
+
+	for(; len >= 16; len -= 16, dst += 16, src += 16){
+		_mm_stream_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+	}
+
+	memcpy(dst, src, len);
+}
+
+//objgl_assemble_keys for a packed output (stride is the vertex size) that wouldn't stay in the caches anyway
+void objgl_assemble_keys_stream(void *data, size_t stride, const objfacevert *keys, objgl_count begin, objgl_count end, const objgl_vec3 *positions, const objgl_vec2 *texcoords, const objgl_vec3 *normals, char hasTextures, char hasNormals){
+	float batch[OBJGL_STREAM_BATCH * 8];
+
+	for(objgl_count i = begin; i < end; i += OBJGL_STREAM_BATCH){
+		objgl_count len = end - i < OBJGL_STREAM_BATCH ? end - i : OBJGL_STREAM_BATCH;
+
+		objgl_assemble_keys(batch, stride, keys + i, 0, len, positions, texcoords, normals, hasTextures, hasNormals);
+		objgl_stream_copy((char*)data + (size_t)i * stride, (const char*)batch, (size_t)len * stride);
+	}
+
+	//the stores are weakly ordered, they have to land before whoever waits for the task reads the data
+	_mm_sfence();
+}
+#else
+#define objgl_assemble_keys_stream objgl_assemble_keys
+#endif
+
+typedef struct{
+	void *data;
+	size_t stride;
+	const objfacevert *keys;
+	objgl_count numVertices;
+	const objgl_vec3 *positions;
+	const objgl_vec2 *texcoords;
+	const objgl_vec3 *normals;
+	char hasTextures, hasNormals;
+	char stream; //non-temporal stores, only for packed vertices
+} objkeyassembly_internal;
+
+void objgl_assemble_keys_task(void *ctx, uint_least32_t index){
+	const objkeyassembly_internal *a = (const objkeyassembly_internal*)ctx;
+	objgl_count begin = (objgl_count)index * OBJGL_ASSEMBLY_CHUNK;
+	objgl_count end = a->numVertices - begin < OBJGL_ASSEMBLY_CHUNK ? a->numVertices : begin + OBJGL_ASSEMBLY_CHUNK;
+
+	if(a->stream){
+		objgl_assemble_keys_stream(a->data, a->stride, a->keys, begin, end, a->positions, a->texcoords, a->normals, a->hasTextures, a->hasNormals);
+	} else{
+		objgl_assemble_keys(a->data, a->stride, a->keys, begin, end, a->positions, a->texcoords, a->normals, a->hasTextures, a->hasNormals);
+	}
+}
+
+//the vertices in chunks on the scheduler, or all of them here
+void objgl_assemble_run(objkeyassembly_internal *assembly, const objgl2Scheduler *scheduler){
+	size_t vertSize = sizeof(float) * (3 + 3 * assembly->hasNormals + 2 * assembly->hasTextures);
+	assembly->stream = assembly->stride == vertSize && (uint_least64_t)assembly->numVertices * vertSize >= OBJGL_STREAM_BYTES;
+
+	if(scheduler && assembly->numVertices > OBJGL_ASSEMBLY_CHUNK){
+		uint_least32_t chunks = (uint_least32_t)((assembly->numVertices + OBJGL_ASSEMBLY_CHUNK - 1) / OBJGL_ASSEMBLY_CHUNK);
+		scheduler->wait(scheduler->userdata, scheduler->submit(scheduler->userdata, objgl_assemble_keys_task, assembly, chunks));
+	} else if(assembly->stream){
+		objgl_assemble_keys_stream(assembly->data, assembly->stride, assembly->keys, 0, assembly->numVertices, assembly->positions, assembly->texcoords, assembly->normals, assembly->hasTextures, assembly->hasNormals);
+	} else{
+		objgl_assemble_keys(assembly->data, assembly->stride, assembly->keys, 0, assembly->numVertices, assembly->positions, assembly->texcoords, assembly->normals, assembly->hasTextures, assembly->hasNormals);
+	}
+}
+
+void objgl_scratch_delete(objscratch_internal *scratch, objgl2Stats *stats){
+	objgl_tfree(stats, scratch->positions, sizeof(objgl_vec3) * scratch->info.resPositions);
+	objgl_tfree(stats, scratch->normals, sizeof(objgl_vec3) * scratch->info.resNormals);
+	objgl_tfree(stats, scratch->texcoords, sizeof(objgl_vec2) * scratch->info.resTexcoords);
+	objgl_tfree(stats, scratch->vertCache.cache, sizeof(objfacevert) * scratch->vertCache.cacheSize);
+	objgl_tfree(stats, scratch->materials, sizeof(objmaterial_internal) * scratch->resMaterials);
+	objgl_tfree(stats, scratch->hashtable, sizeof(objhashentry) * scratch->hashtableSize);
+	objgl_tfree(stats, scratch->keys, sizeof(objfacevert) * scratch->resKeys);
+
+	*scratch = (const objscratch_internal){0};
+}
+
+struct __ObjGL2Parsed{
+	objgl2Data obj; //data is NULL
+	objgl_vec3 *positions, *normals;
+	objgl_vec2 *texcoords;
+	objgl2Index numPositions, numTexcoords, numNormals;
+	objgl2Index *keys; //objfacevert of every unique vertex, in the vertex order
+	objobjects_internal *objects; //set before the load to read every o block
+};
+
+//dedups the faces, resolves the materials and assembles the vertices, the hash table comes from scratch
+//looks the materials up in the mtllib files the object referenced and frees the references
+void objgl_resolvemtls(objgl2Material *mats, const objmaterial_internal *materials, uint_fast32_t numMaterials, objmtlrefs_internal *mtlRefs, const objgl2LoadOptions *options, objgl2Stats *stats){
+	if(mtlRefs->numLibraries){
+		objgl_mutex_lock(&options->mtldb->lock);
+
+		for(uint_fast32_t i = 0; i < numMaterials; ++i){
+			for(uint_fast32_t l = 0; l < mtlRefs->numLibraries && mats[i].name && !mats[i].mtl; ++l){
+				mats[i].mtl = objgl_mtllib_find(&options->mtldb->libraries[mtlRefs->libraries[l]], materials[i].hash, mats[i].name, materials[i].nameLen);
+			}
+		}
+
+		objgl_mutex_unlock(&options->mtldb->lock);
+	}
+
+	objgl_tfree(stats, mtlRefs->libraries, sizeof(uint_least32_t) * mtlRefs->resLibraries);
+}
+
+objgl2Data objgl_build(objparse_internal *parse, const objgl2LoadOptions *options, objscratch_internal *scratch, objgl2Stats *scratchStats, objgl2Parsed *parsed){
+	objgl2Stats *stats = options->stats;
+	double dedupStart = stats ? objgl_now() : 0;
+
+	objgl_count numIndices = parse->numIndices;
+	uint_fast32_t numMaterials = parse->mat.num;
+	objmaterial_internal *materials = parse->mat.list;
+	objmtlrefs_internal mtlRefs = parse->mtlRefs;
+	char hasNormals = parse->hasNormals;
+	char hasTextures = parse->hasTextures;
+
+	objgl2Size uniques = 0;
+	objgl2Index *uniqueIndices = (objgl2Index*)objgl_talloc(stats, sizeof(objgl2Index) * numIndices);
+
+	if(scratch->hashtableSize < numIndices){
+		objgl_tfree(scratchStats, scratch->hashtable, sizeof(objhashentry) * scratch->hashtableSize);
+		scratch->hashtableSize = numIndices;
+		scratch->hashtable = (objhashentry*)objgl_tcalloc(scratchStats, numIndices, sizeof(objhashentry));
+	} else if(numIndices){
+		memset(scratch->hashtable, 0, sizeof(objhashentry) * numIndices);
+	}
+
+	objhashentry *hashtable = scratch->hashtable;
+	objgl2Material *mats = (objgl2Material*)objgl_talloc(stats, sizeof(objgl2Material) * numMaterials);
+
+	objgl2Bounds bounds;
+	objgl_bounds_init(&bounds);
+
+	for(objgl_count i = 0, k = 0; i < numMaterials; ++i){
+		objmaterial_internal mat = materials[i];
+		mats[i].indices = &uniqueIndices[k];
+		objgl_bounds_init(&mats[i].bounds);
+
+		for(objgl_count j = 0; j < mat.numIndices; ++j, ++k){
+			char fresh;
+			objgl2Size before = uniques;
+			uniqueIndices[k] = objgl_insert(&mat.indices[j], (uint_least32_t)i, hashtable, numIndices, &uniques, &fresh, stats ? stats->probes : NULL);
+
+			//a vertex used again by the same material is already in its bounds
+			if(fresh){
+				//a new vertex gets the next index, so the keys are appended in the vertex order
+				if(uniques != before){
+					if(before == scratch->resKeys){
+						objgl_count oldsize = scratch->resKeys;
+						scratch->resKeys += scratch->resKeys + 4096;
+						scratch->keys = (objfacevert*)objgl_trealloc(scratchStats, scratch->keys, sizeof(objfacevert) * scratch->resKeys, sizeof(objfacevert) * oldsize);
+					}
+
+					scratch->keys[before] = mat.indices[j];
+				}
+
+				//an index past the positions is only caught by OBJGL2_VALIDATE, it isn't read here
+				if(mat.indices[j].a[0] && mat.indices[j].a[0] <= parse->info.numPositions){
+					objgl_bounds_add(&mats[i].bounds, parse->positions[mat.indices[j].a[0] - 1].a);
+				}
+			}
+		}
+
+		mats[i].len = mat.numIndices;
+		mats[i].name = mat.name == OBJGL_NONAME ? NULL : &parse->mat.names.data[mat.name];
+		mats[i].mtl = NULL;
+
+		objgl_bounds_merge(&bounds, &mats[i].bounds);
+		objgl_bounds_finish(&mats[i].bounds);
+		objgl_tfree(stats, mat.indices, sizeof(objfacevert) * mat.resIndices);
+	}
+
+	objgl_bounds_finish(&bounds);
+
+	objgl_resolvemtls(mats, materials, numMaterials, &mtlRefs, options, stats);
+
+	double assemblyStart = 0;
+
+	if(stats){
+		assemblyStart = objgl_now();
+		stats->dedupSeconds = assemblyStart - dedupStart;
+	}
+
+	unsigned int vertSize = sizeof(float) * (3 + 3 * hasNormals + 2 * hasTextures);
+	void *data = NULL;
+
+	if(parsed){
+		parsed->keys = (objgl2Index*)objgl_talloc(stats, sizeof(objfacevert) * uniques);
+
+		if(uniques){
+			memcpy(parsed->keys, scratch->keys, sizeof(objfacevert) * uniques);
+		}
+
+		//the handle owns them now, they stay counted in the stats
+		parsed->positions = parse->positions;
+		parsed->normals = parse->normals;
+		parsed->texcoords = parse->texcoords;
+		parsed->numPositions = parse->info.numPositions;
+		parsed->numNormals = parse->info.numNormals;
+		parsed->numTexcoords = parse->info.numTexcoords;
+
+		if(scratch->positions == parse->positions){
+			scratch->positions = scratch->normals = NULL;
+			scratch->texcoords = NULL;
+			scratch->info.resPositions = scratch->info.resNormals = scratch->info.resTexcoords = 0;
+		}
+	} else{
+		//sequential writes from the compact key list instead of scattered ones from the hash table
+		data = objgl_talloc(stats, (size_t)vertSize * uniques);
+		objkeyassembly_internal assembly = {data, vertSize, scratch->keys, uniques, parse->positions, parse->texcoords, parse->normals, hasTextures, hasNormals, 0};
+		objgl_assemble_run(&assembly, options->scheduler);
+	}
+
+	objgl2Data obj;
+	obj.data = (float*)data;
+	obj.hasNormals = hasNormals;
+	obj.hasTexCoords = hasTextures;
+	obj.indices = uniqueIndices;
+	obj.name = parse->name;
+	obj.numIndices = numIndices;
+	obj.numMaterials = numMaterials;
+	obj.numVertices = uniques;
+	obj.materials = mats;
+	obj.vertSize = vertSize;
+	obj.strings = parse->mat.names.data;
+	obj.bounds = bounds;
+	obj.bvh = NULL;
+
+	if(stats){
+		stats->assemblySeconds = objgl_now() - assemblyStart;
+	}
+
+	return obj;
+}
+
+//the progressive dedup behind the snapshots, the faces parsed since the last one are added to what's been published
+typedef struct{
+	objhashentry *table; //power of two, grown at half full
+	objgl_count mask;
+	char *data;
+	objgl_count numVertices, resVertices;
+	unsigned int vertSize;
+	char hasNormals, hasTextures;
+	objgl2Material *mats;
+	objgl_count *resIndices, *done; //done - the material's faces already published
+	objgl2Bounds *bounds; //of the published faces, mats[i].bounds is the finished copy
+	uint_fast32_t resMats;
+	char missing; //a face used an attribute before its line, those vertices and the bounds are redone at the end
+	uint_least64_t next; //bytes at which the next snapshot is due
+} objsnapshot_internal;
+
+void objgl_snapshot_delete(objsnapshot_internal *snap, objgl2Stats *stats){
+	for(uint_fast32_t i = 0; i < snap->resMats; ++i){
+		objgl_tfree(stats, snap->mats[i].indices, sizeof(objgl2Index) * snap->resIndices[i]);
+	}
+
+	objgl_tfree(stats, snap->table, snap->table ? sizeof(objhashentry) * (snap->mask + 1) : 0);
+	objgl_tfree(stats, snap->data, snap->vertSize * snap->resVertices);
+	objgl_tfree(stats, snap->mats, sizeof(objgl2Material) * snap->resMats);
+	objgl_tfree(stats, snap->resIndices, sizeof(objgl_count) * snap->resMats);
+	objgl_tfree(stats, snap->done, sizeof(objgl_count) * snap->resMats);
+	objgl_tfree(stats, snap->bounds, sizeof(objgl2Bounds) * snap->resMats);
+}
+
+//a component the faces don't have, or an index past the attributes read so far, reads as zeros. Returns non-zero for the latter
+char objgl_snapshot_vertex(char *vert, objfacevert key, const objparse_internal *parse, char hasTextures, char hasNormals){
+	const objgl_vec3 zero3 = {{0, 0, 0}};
+	const objgl_vec2 zero2 = {{0, 0}};
+	char missing = key.a[0] > parse->info.numPositions;
+
+	*((objgl_vec3*)vert) = key.a[0] && key.a[0] <= parse->info.numPositions ? parse->positions[key.a[0] - 1] : zero3;
+
+	if(hasTextures){
+		*((objgl_vec2*)(vert + sizeof(float) * 3)) = key.a[1] && key.a[1] <= parse->info.numTexcoords ? parse->texcoords[key.a[1] - 1] : zero2;
+		missing |= key.a[1] > parse->info.numTexcoords;
+	}
+
+	if(hasNormals){
+		*((objgl_vec3*)(vert + sizeof(float) * (3 + 2 * hasTextures))) = key.a[2] && key.a[2] <= parse->info.numNormals ? parse->normals[key.a[2] - 1] : zero3;
+		missing |= key.a[2] > parse->info.numNormals;
+	}
+
+	return missing;
+}
+
+objgl2Index objgl_snapshot_insert(objsnapshot_internal *snap, objfacevert key, uint_least32_t material, const objparse_internal *parse, objgl2Stats *stats){
+	if(!snap->table || snap->numVertices * 2 >= snap->mask + 1){
+		objgl_count oldsize = snap->table ? snap->mask + 1 : 0;
+		objgl_count size = oldsize ? oldsize * 2 : 4096;
+		objhashentry *table = (objhashentry*)objgl_tcalloc(stats, size, sizeof(objhashentry));
+
+		for(objgl_count i = 0; i < oldsize; ++i){
+			if(snap->table[i].hash){
+				objgl_count slot = (objgl_count)snap->table[i].hash & (size - 1);
+				for(objgl_count probe = 1; table[slot].hash; ++probe){slot = (slot + probe) & (size - 1);}
+				table[slot] = snap->table[i];
+			}
+		}
+
+		objgl_tfree(stats, snap->table, sizeof(objhashentry) * oldsize);
+		snap->table = table;
+		snap->mask = size - 1;
+	}
+
+	//the same hash as the final dedup
+	uint_least64_t hash = objgl2_hashfunc64(key);
+	objgl_count slot = (objgl_count)hash & snap->mask;
+	char found = 0;
+
+	for(objgl_count probe = 1; snap->table[slot].hash; ++probe){
+		if(snap->table[slot].hash == hash){
+			found = 1;
+			break;
+		}
+
+		slot = (slot + probe) & snap->mask;
+	}
+
+	if(!found || snap->table[slot].material != material){
+		snap->table[slot].material = material;
+
+		if(key.a[0] && key.a[0] <= parse->info.numPositions){
+			objgl_bounds_add(&snap->bounds[material], parse->positions[key.a[0] - 1].a);
+		}
+	}
+
+	if(found){
+		return (objgl2Index)snap->table[slot].index;
+	}
+
+	if(snap->numVertices >= snap->resVertices){
+		objgl_count oldsize = snap->resVertices;
+		snap->resVertices += snap->resVertices + 1024;
+		snap->data = (char*)objgl_trealloc(stats, snap->data, snap->vertSize * snap->resVertices, snap->vertSize * oldsize);
+	}
+
+	snap->missing |= objgl_snapshot_vertex(snap->data + snap->numVertices * snap->vertSize, key, parse, snap->hasTextures, snap->hasNormals);
+
+	snap->table[slot].hash = hash;
+	snap->table[slot].vert = key;
+	snap->table[slot].index = snap->numVertices;
+
+	return (objgl2Index)snap->numVertices++;
+}
+
+//dedups the faces parsed since the last call, returns non-zero if the vertices had to be repacked
+char objgl_snapshot_update(objsnapshot_internal *snap, const objparse_internal *parse, objgl2Stats *stats){
+	const objmatstate_internal *mat = &parse->mat;
+	char relayout = 0;
+
+	if(!snap->vertSize){
+		snap->hasNormals = parse->hasNormals;
+		snap->hasTextures = parse->hasTextures;
+		snap->vertSize = sizeof(float) * (3 + 3 * snap->hasNormals + 2 * snap->hasTextures);
+	} else if(snap->hasNormals != parse->hasNormals || snap->hasTextures != parse->hasTextures){
+		//components are only ever dropped, so the vertices shrink and can be repacked in place
+		char hasNormals = parse->hasNormals, hasTextures = parse->hasTextures;
+		unsigned int vertSize = sizeof(float) * (3 + 3 * hasNormals + 2 * hasTextures);
+
+		for(objgl_count i = 0; i < snap->numVertices; ++i){
+			char vert[sizeof(float) * 8];
+			memcpy(vert, snap->data + i * snap->vertSize, snap->vertSize);
+
+			char *dst = snap->data + i * vertSize;
+			memmove(dst, vert, sizeof(float) * 3);
+
+			if(hasTextures){
+				memmove(dst + sizeof(float) * 3, vert + sizeof(float) * 3, sizeof(float) * 2);
+			}
+
+			if(hasNormals){
+				memmove(dst + sizeof(float) * (3 + 2 * hasTextures), vert + sizeof(float) * (3 + 2 * snap->hasTextures), sizeof(float) * 3);
+			}
+		}
+
+		snap->data = (char*)objgl_trealloc(stats, snap->data, vertSize * snap->resVertices, snap->vertSize * snap->resVertices);
+		snap->vertSize = vertSize;
+		snap->hasNormals = hasNormals;
+		snap->hasTextures = hasTextures;
+		relayout = 1;
+	}
+
+	if(mat->num > snap->resMats){
+		uint_fast32_t oldsize = snap->resMats;
+		snap->resMats = mat->num + 8;
+		snap->mats = (objgl2Material*)objgl_trealloc(stats, snap->mats, sizeof(objgl2Material) * snap->resMats, sizeof(objgl2Material) * oldsize);
+		snap->resIndices = (objgl_count*)objgl_trealloc(stats, snap->resIndices, sizeof(objgl_count) * snap->resMats, sizeof(objgl_count) * oldsize);
+		snap->done = (objgl_count*)objgl_trealloc(stats, snap->done, sizeof(objgl_count) * snap->resMats, sizeof(objgl_count) * oldsize);
+		snap->bounds = (objgl2Bounds*)objgl_trealloc(stats, snap->bounds, sizeof(objgl2Bounds) * snap->resMats, sizeof(objgl2Bounds) * oldsize);
+
+		for(uint_fast32_t i = oldsize; i < snap->resMats; ++i){
+			snap->mats[i] = (const objgl2Material){0};
+			snap->resIndices[i] = snap->done[i] = 0;
+			objgl_bounds_init(&snap->bounds[i]);
+		}
+	}
+
+	for(uint_fast32_t i = 0; i < mat->num; ++i){
+		//the current material's list entry is only written back on a switch
+		const objmaterial_internal *m = i == mat->index ? &mat->cur : &mat->list[i];
+		objgl2Material *out = &snap->mats[i];
+
+		if(m->numIndices > snap->resIndices[i]){
+			objgl_count oldsize = snap->resIndices[i];
+			snap->resIndices[i] = m->numIndices + m->numIndices / 2;
+			out->indices = (objgl2Index*)objgl_trealloc(stats, out->indices, sizeof(objgl2Index) * snap->resIndices[i], sizeof(objgl2Index) * oldsize);
+		}
+
+		for(objgl_count j = snap->done[i]; j < m->numIndices; ++j){
+			out->indices[j] = objgl_snapshot_insert(snap, m->indices[j], (uint_least32_t)i, parse, stats);
+		}
+
+		snap->done[i] = m->numIndices;
+		out->len = m->numIndices;
+		out->name = m->name == OBJGL_NONAME ? NULL : &mat->names.data[m->name];
+		out->mtl = NULL;
+		out->bounds = snap->bounds[i];
+		objgl_bounds_finish(&out->bounds);
+	}
+
+	return relayout;
+}
+
+void objgl_snapshot(objsnapshot_internal *snap, const objparse_internal *parse, const objgl2LoadOptions *options, objgl2Stats *stats, uint_least64_t bytesRead){
+	char relayout = objgl_snapshot_update(snap, parse, stats);
+
+	objgl2Snapshot snapshot;
+	snapshot.data = (const float*)snap->data;
+	snapshot.numVertices = snap->numVertices;
+	snapshot.vertSize = snap->vertSize;
+	snapshot.hasNormals = snap->hasNormals;
+	snapshot.hasTexCoords = snap->hasTextures;
+	snapshot.relayout = relayout;
+	snapshot.materials = snap->mats;
+	snapshot.numMaterials = parse->mat.num;
+	snapshot.bytesRead = bytesRead;
+
+	options->snapshot(options->userdata, &snapshot);
+
+	snap->next = bytesRead + (options->snapshotBytes ? options->snapshotBytes : OBJGL2_SNAPSHOT_BYTES);
+}
+
+//the end of a load that published snapshots, the result continues them instead of deduplicating everything again
+objgl2Data objgl_snapshot_finish(objsnapshot_internal *snap, objparse_internal *parse, const objgl2LoadOptions *options){
+	objgl2Stats *stats = options->stats;
+	double dedupStart = stats ? objgl_now() : 0;
+
+	objgl_snapshot_update(snap, parse, stats);
+
+	//everything is parsed now, the vertices that were zeros get their attributes
+	if(snap->missing){
+		for(objgl_count i = 0; i <= snap->mask; ++i){
+			if(snap->table[i].hash){
+				objgl_snapshot_vertex(snap->data + snap->table[i].index * snap->vertSize, snap->table[i].vert, parse, snap->hasTextures, snap->hasNormals);
+			}
+		}
+	}
+
+	objmatstate_internal *mat = &parse->mat;
+	objgl2Bounds bounds;
+	objgl_bounds_init(&bounds);
+	objgl2Index *indices = (objgl2Index*)objgl_talloc(stats, sizeof(objgl2Index) * parse->numIndices);
+	objgl2Material *mats = (objgl2Material*)objgl_talloc(stats, sizeof(objgl2Material) * mat->num);
+
+	for(objgl_count i = 0, k = 0; i < mat->num; ++i){
+		mats[i] = snap->mats[i];
+		mats[i].indices = &indices[k];
+
+		if(mats[i].len){
+			memcpy(mats[i].indices, snap->mats[i].indices, sizeof(objgl2Index) * mats[i].len);
+		}
+
+		k += mats[i].len;
+		objgl_bounds_merge(&bounds, &snap->bounds[i]);
+		objgl_tfree(stats, mat->list[i].indices, sizeof(objfacevert) * mat->list[i].resIndices);
+	}
+
+	objgl_bounds_finish(&bounds);
+
+	objgl_resolvemtls(mats, mat->list, mat->num, &parse->mtlRefs, options, stats);
+
+	//the vertices are handed over as they are
+	if(snap->numVertices < snap->resVertices && snap->numVertices){
+		snap->data = (char*)objgl_trealloc(stats, snap->data, snap->vertSize * snap->numVertices, snap->vertSize * snap->resVertices);
+		snap->resVertices = snap->numVertices;
+	}
+
+	objgl2Data obj;
+	obj.data = (float*)snap->data;
+	obj.hasNormals = snap->hasNormals;
+	obj.hasTexCoords = snap->hasTextures;
+	obj.indices = indices;
+	obj.name = parse->name;
+	obj.numIndices = parse->numIndices;
+	obj.numMaterials = mat->num;
+	obj.numVertices = snap->numVertices;
+	obj.materials = mats;
+	obj.vertSize = snap->vertSize;
+	obj.strings = mat->names.data;
+	obj.bounds = bounds;
+	obj.bvh = NULL;
+
+	if(snap->missing){
+		objgl_bounds_compute(&obj);
+	}
+
+	snap->data = NULL;
+	snap->resVertices = 0;
+
+	if(stats){
+		stats->dedupSeconds = objgl_now() - dedupStart;
+	}
+
+	return obj;
+}
+
+#define OBJGL_WELD_NONE ((objgl2Index)-1)
+
+//position, texcoord and normal of a vertex, from the assembled data or from the keys of a parse
+void objgl_weld_vertex(const objgl2Data *obj, const objgl2Parsed *parsed, objgl_count index, float *v){
+	if(parsed){
+		objfacevert key = ((const objfacevert*)parsed->keys)[index];
+		memcpy(v, &parsed->positions[key.a[0] - 1], sizeof(objgl_vec3));
+
+		if(obj->hasTexCoords){
+			memcpy(v + 3, &parsed->texcoords[key.a[1] - 1], sizeof(objgl_vec2));
+		}
+
+		if(obj->hasNormals){
+			memcpy(v + 5, &parsed->normals[key.a[2] - 1], sizeof(objgl_vec3));
+		}
+	} else{
+		const float *src = (const float*)((const char*)obj->data + (size_t)index * obj->vertSize);
+		memcpy(v, src, sizeof(objgl_vec3));
+
+		if(obj->hasTexCoords){
+			memcpy(v + 3, src + 3, sizeof(objgl_vec2));
+		}
+
+		if(obj->hasNormals){
+			memcpy(v + 5, src + 3 + 2 * obj->hasTexCoords, sizeof(objgl_vec3));
+		}
+	}
+}
+
+//cells are twice the tolerance, so a match is in the cell or in the neighbour on the side the coordinate is closer to (side).
+//Without a tolerance the cell is the coordinate itself
+int_least64_t objgl_weld_cell(float x, double inv, int *side){
+	*side = 0;
+
+	if(!inv){
+		uint_least32_t bits;
+		x += 0.0f; //-0 and 0 are the same position
+		memcpy(&bits, &x, sizeof(bits));
+
+		return bits;
+	}
+
+	double v = (double)x * inv;
+	v = !(v > -4e18) ? -4e18 : v > 4e18 ? 4e18 : v;
+	int_least64_t cell = (int_least64_t)v;
+	cell -= v < (double)cell;
+	*side = v - (double)cell < 0.5 ? -1 : 1;
+
+	return cell;
+}
+
+objgl_count objgl_weld_bucket(const int_least64_t *cell, objgl_count mask){
+	uint_least64_t hash = (uint_least64_t)cell[0] * 0x9E3779B97F4A7C15UL ^ (uint_least64_t)cell[1] * 0xC2B2AE3D27D4EB4FUL ^ (uint_least64_t)cell[2] * 0x165667B19E3779F9UL;
+	hash ^= hash >> 29;
+
+	return (objgl_count)hash & mask;
+}
+
+float objgl_weld_dist2(const float *a, const float *b, unsigned int n){
+	float d = 0;
+
+	for(unsigned int i = 0; i < n; ++i){
+		d += (a[i] - b[i]) * (a[i] - b[i]);
+	}
+
+	return d;
+}
+
+typedef struct{
+	objgl2Index *indices;
+	const objgl2Index *remap;
+	objgl_count numIndices;
+} objweldremap_internal;
+
+void objgl_weld_task(void *ctx, uint_least32_t index){
+	const objweldremap_internal *w = (const objweldremap_internal*)ctx;
+	objgl_count begin = (objgl_count)index * OBJGL_ASSEMBLY_CHUNK;
+	objgl_count end = w->numIndices - begin < OBJGL_ASSEMBLY_CHUNK ? w->numIndices : begin + OBJGL_ASSEMBLY_CHUNK;
+
+	for(objgl_count i = begin; i < end; ++i){
+		w->indices[i] = w->remap[w->indices[i]];
+	}
+}
+
+//merges the vertices within the tolerances of options->weld into the first of them, the vertices keep their order
+void objgl_weld(objgl2Data *obj, objgl2Parsed *parsed, const objgl2LoadOptions *options){
+	const objgl2Weld *weld = options->weld;
+	objgl2Stats *stats = options->stats;
+	objgl_count numVertices = obj->numVertices;
+	double weldStart = stats ? objgl_now() : 0;
+
+	objgl_count size = 1024;
+	while(size < numVertices){size += size;}
+
+	//a bucket chains the kept vertices of its cells through next
+	objgl2Index *heads = (objgl2Index*)objgl_talloc(stats, sizeof(objgl2Index) * size);
+	objgl2Index *next = (objgl2Index*)objgl_talloc(stats, sizeof(objgl2Index) * numVertices);
+	objgl2Index *remap = (objgl2Index*)objgl_talloc(stats, sizeof(objgl2Index) * numVertices);
+	memset(heads, 0xFF, sizeof(objgl2Index) * size);
+
+	double inv = weld->position > 0 ? 0.5 / weld->position : 0;
+	unsigned int neighbours = inv ? 8 : 1;
+	float position2 = weld->position * weld->position;
+	float texcoord2 = weld->texcoord * weld->texcoord;
+	float normal2 = weld->normal * weld->normal;
+	objgl_count kept = 0;
+
+	for(objgl_count i = 0; i < numVertices; ++i){
+		float v[8] = {0};
+		objgl_weld_vertex(obj, parsed, i, v);
+
+		int side[3];
+		const int_least64_t cell[3] = {objgl_weld_cell(v[0], inv, &side[0]), objgl_weld_cell(v[1], inv, &side[1]), objgl_weld_cell(v[2], inv, &side[2])};
+		objgl2Index found = OBJGL_WELD_NONE;
+
+		for(unsigned int n = 0; n < neighbours && found == OBJGL_WELD_NONE; ++n){
+			const int_least64_t near[3] = {cell[0] + (n & 1 ? side[0] : 0), cell[1] + (n & 2 ? side[1] : 0), cell[2] + (n & 4 ? side[2] : 0)};
+
+			for(objgl2Index k = heads[objgl_weld_bucket(near, size - 1)]; k != OBJGL_WELD_NONE; k = next[k]){
+				float u[8] = {0};
+				objgl_weld_vertex(obj, parsed, k, u);
+
+				if(objgl_weld_dist2(v, u, 3) <= position2 && (!obj->hasTexCoords || objgl_weld_dist2(v + 3, u + 3, 2) <= texcoord2) &&
+					(!obj->hasNormals || objgl_weld_dist2(v + 5, u + 5, 3) <= normal2)){
+					found = k;
+					break;
+				}
+			}
+		}
+
+		if(found != OBJGL_WELD_NONE){
+			remap[i] = remap[found];
+		} else{
+			objgl_count bucket = objgl_weld_bucket(cell, size - 1);
+			next[i] = heads[bucket];
+			heads[bucket] = (objgl2Index)i;
+			remap[i] = (objgl2Index)kept++;
+		}
+	}
+
+	//the kept vertices only move towards the front
+	size_t recordSize = parsed ? sizeof(objfacevert) : obj->vertSize;
+	char *records = parsed ? (char*)parsed->keys : (char*)obj->data;
+
+	for(objgl_count i = 0, j = 0; i < numVertices; ++i){
+		if(remap[i] == j){
+			if(i != j){
+				memcpy(records + j * recordSize, records + i * recordSize, recordSize);
+			}
+
+			++j;
+		}
+	}
+
+	objweldremap_internal w = {obj->indices, remap, obj->numIndices};
+	uint_least32_t chunks = (uint_least32_t)((obj->numIndices + OBJGL_ASSEMBLY_CHUNK - 1) / OBJGL_ASSEMBLY_CHUNK);
+
+	if(options->scheduler && chunks > 1){
+		options->scheduler->wait(options->scheduler->userdata, options->scheduler->submit(options->scheduler->userdata, objgl_weld_task, &w, chunks));
+	} else{
+		for(uint_least32_t c = 0; c < chunks; ++c){
+			objgl_weld_task(&w, c);
+		}
+	}
+
+	if(kept < numVertices){
+		records = (char*)objgl_trealloc(stats, records, recordSize * kept, recordSize * numVertices);
+
+		if(parsed){
+			parsed->keys = (objgl2Index*)records;
+		} else{
+			obj->data = (float*)records;
+		}
+	}
+
+	obj->numVertices = kept;
+
+	//a material can now use a vertex of another material that's outside of its bounds
+	if(kept < numVertices){
+		float v[8];
+		objgl_bounds_init(&obj->bounds);
+
+		for(uint_fast32_t i = 0; i < obj->numMaterials; ++i){
+			objgl2Material *mat = &obj->materials[i];
+			objgl_bounds_init(&mat->bounds);
+
+			for(objgl_count j = 0; j < mat->len; ++j){
+				objgl_weld_vertex(obj, parsed, mat->indices[j], v);
+				objgl_bounds_add(&mat->bounds, v);
+			}
+
+			objgl_bounds_merge(&obj->bounds, &mat->bounds);
+			objgl_bounds_finish(&mat->bounds);
+		}
+
+		objgl_bounds_finish(&obj->bounds);
+	}
+
+	objgl_tfree(stats, heads, sizeof(objgl2Index) * size);
+	objgl_tfree(stats, next, sizeof(objgl2Index) * numVertices);
+	objgl_tfree(stats, remap, sizeof(objgl2Index) * numVertices);
+
+	if(stats){
+		stats->dedupSeconds += objgl_now() - weldStart;
+	}
+}
+
+#define OBJGL_BVH_BINS 16
+#define OBJGL_BVH_LEAF 4 //a node with more triangles is always split
+#define OBJGL_BVH_TASK 8192 //nodes with up to this many triangles are built whole by one task
+#define OBJGL_BVH_CHUNK 16384 //triangles per task when binning the nodes above that
+#define OBJGL_BVH_PACKET 8
+#define OBJGL_BVH_STACK 64
+
+typedef struct{
+	float min[3], max[3];
+	objgl2Index id;
+} objbvhtri_internal;
+
+//bounds of some triangles and of their centroids, a centroid is min + max
+typedef struct{
+	float min[3], max[3];
+	float cmin[3], cmax[3];
+	objgl_count count;
+} objbvhbox_internal;
+
+typedef struct{
+	objgl_count begin, end;
+	uint_least32_t material;
+	objbvhbox_internal box;
+} objbvhchunk_internal;
+
+//a node of the top of the tree: a group of materials, a big range of triangles, or a subtree built by a task
+typedef struct{
+	objbvhbox_internal box;
+	objgl_count begin;
+	uint_least32_t groupBegin, groupEnd; //materials still to be grouped, in ids
+	uint_least32_t child[2]; //OBJGL_NOTFOUND for a subtree
+	uint_least32_t subtree;
+} objbvhtop_internal;
+
+//nodes in depth-first order, the inner nodes' first is relative to the start of the array
+typedef struct{
+	objgl2BVHNode *nodes;
+	objgl_count num, res;
+	uint_least32_t depth;
+} objbvhnodes_internal;
+
+typedef struct{
+	objbvhbox_internal box;
+	objgl_count begin;
+	objgl_count parent; //the node whose first points here
+	uint_least32_t depth;
+} objbvhwork_internal;
+
+typedef struct{
+	const objgl2Data *obj;
+	objbvhtri_internal *tris;
+	objbvhchunk_internal *chunks;
+	//the node being binned by the chunk tasks
+	objgl_count begin, count;
+	unsigned int axis;
+	float cmin, scale;
+	objbvhbox_internal *bins;
+	//the subtrees
+	const objbvhtop_internal *top;
+	const uint_least32_t *tasks;
+	objbvhnodes_internal *subtrees;
+} objbvhbuild_internal;
+
+typedef struct{
+	float key;
+	uint_least32_t id;
+} objbvhkey_internal;
+
+const float* objgl_bvh_vertex(const objgl2Data *obj, objgl2Index tri, unsigned int k){
+	return (const float*)((const char*)obj->data + (size_t)obj->indices[(size_t)tri * 3 + k] * obj->vertSize);
+}
+
+void objgl_bvh_boxinit(objbvhbox_internal *b){
+	for(unsigned int c = 0; c < 3; ++c){
+		b->min[c] = b->cmin[c] = FLT_MAX;
+		b->max[c] = b->cmax[c] = -FLT_MAX;
+	}
+
+	b->count = 0;
+}
+
+void objgl_bvh_boxadd(objbvhbox_internal *b, const objbvhtri_internal *t){
+	for(unsigned int c = 0; c < 3; ++c){
+		float centroid = t->min[c] + t->max[c];
+		b->min[c] = t->min[c] < b->min[c] ? t->min[c] : b->min[c];
+		b->max[c] = t->max[c] > b->max[c] ? t->max[c] : b->max[c];
+		b->cmin[c] = centroid < b->cmin[c] ? centroid : b->cmin[c];
+		b->cmax[c] = centroid > b->cmax[c] ? centroid : b->cmax[c];
+	}
+
+	++b->count;
+}
+
+void objgl_bvh_boxmerge(objbvhbox_internal *b, const objbvhbox_internal *o){
+	for(unsigned int c = 0; c < 3; ++c){
+		b->min[c] = o->min[c] < b->min[c] ? o->min[c] : b->min[c];
+		b->max[c] = o->max[c] > b->max[c] ? o->max[c] : b->max[c];
+		b->cmin[c] = o->cmin[c] < b->cmin[c] ? o->cmin[c] : b->cmin[c];
+		b->cmax[c] = o->cmax[c] > b->cmax[c] ? o->cmax[c] : b->cmax[c];
+	}
+
+	b->count += o->count;
+}
+
+void objgl_bvh_boxgrow(objbvhbox_internal *b, const objbvhbox_internal *o){
+	for(unsigned int c = 0; c < 3; ++c){
+		b->min[c] = o->min[c] < b->min[c] ? o->min[c] : b->min[c];
+		b->max[c] = o->max[c] > b->max[c] ? o->max[c] : b->max[c];
+	}
+
+	b->count += o->count;
+}
+
+//half of the surface area, 0 for empty bounds
+float objgl_bvh_area(const objbvhbox_internal *b){
+	if(!(b->min[0] <= b->max[0] && b->min[1] <= b->max[1] && b->min[2] <= b->max[2])){
+		return 0;
+	}
+
+	float x = b->max[0] - b->min[0], y = b->max[1] - b->min[1], z = b->max[2] - b->min[2];
+
+	return x * y + y * z + z * x;
+}
+
+unsigned int objgl_bvh_bin(const objbvhtri_internal *t, unsigned int axis, float cmin, float scale, unsigned int numBins){
+	float f = (t->min[axis] + t->max[axis] - cmin) * scale;
+
+	//NaN goes into the first bin
+	return f > 0 ? (f < numBins - 1 ? (unsigned int)f : numBins - 1) : 0;
+}
+
+void objgl_bvh_prep_task(void *ctx, uint_least32_t index){
+	objbvhbuild_internal *b = (objbvhbuild_internal*)ctx;
+	objbvhchunk_internal *chunk = &b->chunks[index];
+	objgl_bvh_boxinit(&chunk->box);
+
+	for(objgl_count i = chunk->begin; i < chunk->end; ++i){
+		objbvhtri_internal *t = &b->tris[i];
+
+		for(unsigned int c = 0; c < 3; ++c){
+			t->min[c] = FLT_MAX;
+			t->max[c] = -FLT_MAX;
+		}
+
+		for(unsigned int k = 0; k < 3; ++k){
+			const float *p = objgl_bvh_vertex(b->obj, (objgl2Index)i, k);
+
+			for(unsigned int c = 0; c < 3; ++c){
+				t->min[c] = p[c] < t->min[c] ? p[c] : t->min[c];
+				t->max[c] = p[c] > t->max[c] ? p[c] : t->max[c];
+			}
+		}
+
+		t->id = (objgl2Index)i;
+		objgl_bvh_boxadd(&chunk->box, t);
+	}
+}
+
+//the hottest loop of the build, objgl_bvh_boxadd written out
+void objgl_bvh_binrange(const objbvhtri_internal *tris, objgl_count begin, objgl_count end, unsigned int axis, float cmin, float scale, unsigned int numBins, objbvhbox_internal *bins){
+	for(objgl_count i = begin; i < end; ++i){
+		const objbvhtri_internal *t = &tris[i];
+		objbvhbox_internal *bin = &bins[objgl_bvh_bin(t, axis, cmin, scale, numBins)];
+
+		for(unsigned int c = 0; c < 3; ++c){
+			float centroid = t->min[c] + t->max[c];
+			bin->min[c] = t->min[c] < bin->min[c] ? t->min[c] : bin->min[c];
+			bin->max[c] = t->max[c] > bin->max[c] ? t->max[c] : bin->max[c];
+			bin->cmin[c] = centroid < bin->cmin[c] ? centroid : bin->cmin[c];
+			bin->cmax[c] = centroid > bin->cmax[c] ? centroid : bin->cmax[c];
+		}
+
+		++bin->count;
+	}
+}
+
+void objgl_bvh_bin_task(void *ctx, uint_least32_t index){
+	objbvhbuild_internal *b = (objbvhbuild_internal*)ctx;
+	objbvhbox_internal *bins = b->bins + (size_t)index * OBJGL_BVH_BINS;
+	objgl_count begin = b->begin + (objgl_count)index * OBJGL_BVH_CHUNK;
+	objgl_count end = b->begin + b->count - begin > OBJGL_BVH_CHUNK ? begin + OBJGL_BVH_CHUNK : b->begin + b->count;
+
+	for(unsigned int i = 0; i < OBJGL_BVH_BINS; ++i){
+		objgl_bvh_boxinit(&bins[i]);
+	}
+
+	objgl_bvh_binrange(b->tris, begin, end, b->axis, b->cmin, b->scale, OBJGL_BVH_BINS, bins);
+}
+
+//splits the triangles of a node in place by the binned SAH, returns 0 if it should be a leaf. A scheduler bins the big nodes in parallel
+char objgl_bvh_split(objbvhbuild_internal *b, const objgl2Scheduler *scheduler, objgl2Stats *stats, objgl_count begin, const objbvhbox_internal *box, objbvhbox_internal *left, objbvhbox_internal *right){
+	objgl_count count = box->count;
+	objbvhtri_internal *tris = b->tris;
+
+	if(count <= 1){
+		return 0;
+	}
+
+	//along the longest extent of the centroids
+	unsigned int axis = 0;
+	float extent = box->cmax[0] - box->cmin[0];
+
+	for(unsigned int c = 1; c < 3; ++c){
+		if(box->cmax[c] - box->cmin[c] > extent){
+			extent = box->cmax[c] - box->cmin[c];
+			axis = c;
+		}
+	}
+
+	//the small nodes get fewer bins, the sweep would cost more than the triangles
+	objbvhbox_internal bins[OBJGL_BVH_BINS];
+	unsigned int numBins = count < OBJGL_BVH_BINS ? (unsigned int)count : OBJGL_BVH_BINS;
+	unsigned int best = numBins; //the left side gets the bins up to this one
+	float bestCost = FLT_MAX;
+	float scale = extent > 0 ? numBins / extent : 0;
+
+	if(scale > 0){
+		for(unsigned int i = 0; i < numBins; ++i){
+			objgl_bvh_boxinit(&bins[i]);
+		}
+
+		uint_least32_t chunks = (uint_least32_t)((count + OBJGL_BVH_CHUNK - 1) / OBJGL_BVH_CHUNK);
+
+		if(scheduler && chunks > 1){
+			b->bins = (objbvhbox_internal*)objgl_talloc(stats, sizeof(objbvhbox_internal) * OBJGL_BVH_BINS * chunks);
+			b->begin = begin;
+			b->count = count;
+			b->axis = axis;
+			b->cmin = box->cmin[axis];
+			b->scale = scale;
+			scheduler->wait(scheduler->userdata, scheduler->submit(scheduler->userdata, objgl_bvh_bin_task, b, chunks));
+
+			for(uint_least32_t i = 0; i < chunks * OBJGL_BVH_BINS; ++i){
+				objgl_bvh_boxmerge(&bins[i % OBJGL_BVH_BINS], &b->bins[i]);
+			}
+
+			objgl_tfree(stats, b->bins, sizeof(objbvhbox_internal) * OBJGL_BVH_BINS * chunks);
+		} else{
+			objgl_bvh_binrange(tris, begin, begin + count, axis, box->cmin[axis], scale, numBins, bins);
+		}
+
+		//only the bounds matter for the cost, the centroids are merged once the split is chosen
+		float rightCost[OBJGL_BVH_BINS];
+		objbvhbox_internal acc;
+		objgl_bvh_boxinit(&acc);
+
+		for(unsigned int i = numBins - 1; i > 0; --i){
+			objgl_bvh_boxgrow(&acc, &bins[i]);
+			rightCost[i] = acc.count ? objgl_bvh_area(&acc) * acc.count : -1;
+		}
+
+		objgl_bvh_boxinit(&acc);
+
+		for(unsigned int i = 0; i < numBins - 1; ++i){
+			objgl_bvh_boxgrow(&acc, &bins[i]);
+
+			if(acc.count && rightCost[i + 1] >= 0){
+				float cost = objgl_bvh_area(&acc) * acc.count + rightCost[i + 1];
+
+				if(cost < bestCost){
+					bestCost = cost;
+					best = i;
+				}
+			}
+		}
+	}
+
+	//a traversal step costs about as much as a triangle test
+	float area = objgl_bvh_area(box);
+
+	if(count <= OBJGL_BVH_LEAF && (best == numBins || area * count <= area + bestCost)){
+		return 0;
+	}
+
+	objgl_bvh_boxinit(left);
+	objgl_bvh_boxinit(right);
+
+	if(best == numBins){
+		//the centroids are all in one spot, halves in their order
+		for(objgl_count i = begin; i < begin + count; ++i){
+			objgl_bvh_boxadd(i < begin + count / 2 ? left : right, &tris[i]);
+		}
+
+		return 1;
+	}
+
+	objgl_count i = begin, j = begin + count;
+
+	while(i < j){
+		if(objgl_bvh_bin(&tris[i], axis, box->cmin[axis], scale, numBins) <= best){
+			++i;
+		} else{
+			objbvhtri_internal t = tris[--j];
+			tris[j] = tris[i];
+			tris[i] = t;
+		}
+	}
+
+	for(unsigned int k = 0; k < numBins; ++k){
+		objgl_bvh_boxmerge(k <= best ? left : right, &bins[k]);
+	}
+
+	return 1;
+}
+
+void objgl_bvh_setnode(objgl2BVHNode *node, const objbvhbox_internal *box){
+	for(unsigned int c = 0; c < 3; ++c){
+		node->min[c] = box->min[c];
+		node->max[c] = box->max[c];
+	}
+}
+
+//depth-first without recursion, very uneven splits would overflow the stack of a worker thread
+void objgl_bvh_subtree(objbvhbuild_internal *b, objgl_count begin, const objbvhbox_internal *box, objbvhnodes_internal *out){
+	uint_fast32_t numWork = 1, resWork = 64;
+	objbvhwork_internal *work = (objbvhwork_internal*)objgl_alloc(sizeof(objbvhwork_internal) * resWork);
+	work[0].box = *box;
+	work[0].begin = begin;
+	work[0].parent = (objgl_count)-1;
+	work[0].depth = 1;
+
+	while(numWork){
+		objbvhwork_internal w = work[--numWork];
+
+		if(w.parent != (objgl_count)-1){
+			out->nodes[w.parent].first = (objgl2Index)out->num;
+		}
+
+		while(1){
+			if(out->num == out->res){
+				out->res += out->res + 64;
+				out->nodes = (objgl2BVHNode*)objgl_realloc(out->nodes, sizeof(objgl2BVHNode) * out->res);
+			}
+
+			objgl_count node = out->num++;
+			objgl_bvh_setnode(&out->nodes[node], &w.box);
+			out->depth = w.depth > out->depth ? w.depth : out->depth;
+
+			objbvhbox_internal left, right;
+
+			if(!objgl_bvh_split(b, NULL, NULL, w.begin, &w.box, &left, &right)){
+				out->nodes[node].first = (objgl2Index)w.begin;
+				out->nodes[node].count = (objgl2Index)w.box.count;
+				break;
+			}
+
+			out->nodes[node].count = 0;
+
+			if(numWork == resWork){
+				resWork += resWork;
+				work = (objbvhwork_internal*)objgl_realloc(work, sizeof(objbvhwork_internal) * resWork);
+			}
+
+			work[numWork].box = right;
+			work[numWork].begin = w.begin + left.count;
+			work[numWork].parent = node;
+			work[numWork++].depth = w.depth + 1;
+
+			w.box = left;
+			++w.depth;
+		}
+	}
+
+	objgl_free(work);
+}
+
+void objgl_bvh_subtree_task(void *ctx, uint_least32_t index){
+	objbvhbuild_internal *b = (objbvhbuild_internal*)ctx;
+	const objbvhtop_internal *top = &b->top[b->tasks[index]];
+
+	objgl_bvh_subtree(b, top->begin, &top->box, &b->subtrees[top->subtree]);
+}
+
+int objgl_bvh_keycmp(const void *a, const void *b){
+	float x = ((const objbvhkey_internal*)a)->key, y = ((const objbvhkey_internal*)b)->key;
+
+	return x < y ? -1 : y < x;
+}
+
+void objgl_bvh_sortgroup(const objbvhbox_internal *boxes, const uint_least32_t *ids, uint_least32_t num, unsigned int axis, objbvhkey_internal *keys){
+	for(uint_least32_t i = 0; i < num; ++i){
+		keys[i].id = ids[i];
+		keys[i].key = boxes[ids[i]].min[axis] + boxes[ids[i]].max[axis];
+	}
+
+	qsort(keys, num, sizeof(objbvhkey_internal), objgl_bvh_keycmp);
+}
+
+//orders a group of materials along the axis with the best SAH split, returns how many go to the left
+uint_least32_t objgl_bvh_group(const objbvhbox_internal *boxes, uint_least32_t *ids, uint_least32_t num, objbvhkey_internal *keys, float *rightCost){
+	uint_least32_t best = num / 2;
+	unsigned int bestAxis = 0;
+	float bestCost = FLT_MAX;
+
+	for(unsigned int axis = 0; axis < 3; ++axis){
+		objgl_bvh_sortgroup(boxes, ids, num, axis, keys);
+
+		objbvhbox_internal acc;
+		objgl_bvh_boxinit(&acc);
+
+		for(uint_least32_t i = num - 1; i > 0; --i){
+			objgl_bvh_boxmerge(&acc, &boxes[keys[i].id]);
+			rightCost[i] = objgl_bvh_area(&acc) * acc.count;
+		}
+
+		objgl_bvh_boxinit(&acc);
+
+		for(uint_least32_t i = 0; i < num - 1; ++i){
+			objgl_bvh_boxmerge(&acc, &boxes[keys[i].id]);
+			float cost = objgl_bvh_area(&acc) * acc.count + rightCost[i + 1];
+
+			if(cost < bestCost){
+				bestCost = cost;
+				bestAxis = axis;
+				best = i + 1;
+			}
+		}
+	}
+
+	objgl_bvh_sortgroup(boxes, ids, num, bestAxis, keys);
+
+	for(uint_least32_t i = 0; i < num; ++i){
+		ids[i] = keys[i].id;
+	}
+
+	return best;
+}
+
+void objgl_bvh_build(objgl2Data *obj, const objgl2Scheduler *scheduler, objgl2Stats *stats){
+	double bvhStart = stats ? objgl_now() : 0;
+
+	if(obj->bvh){
+		objgl_tfree(stats, obj->bvh->nodes, sizeof(objgl2BVHNode) * obj->bvh->numNodes);
+		objgl_tfree(stats, obj->bvh->triangles, sizeof(objgl2Index) * obj->bvh->numTriangles);
+		objgl_tfree(stats, obj->bvh, sizeof(objgl2BVH));
+	}
+
+	objgl2BVH *bvh = (objgl2BVH*)objgl_talloc(stats, sizeof(objgl2BVH));
+	*bvh = (const objgl2BVH){0};
+	obj->bvh = bvh;
+
+	objgl_count numTris = obj->numIndices / 3;
+	uint_least32_t numMaterials = obj->numMaterials;
+
+	if(!numTris || !obj->data){
+		return;
+	}
+
+	objbvhbuild_internal b = (const objbvhbuild_internal){0};
+	b.obj = obj;
+	b.tris = (objbvhtri_internal*)objgl_talloc(stats, sizeof(objbvhtri_internal) * numTris);
+
+	//the bounds of the triangles, in chunks that don't cross the materials
+	uint_least32_t numChunks = 0;
+
+	for(uint_least32_t i = 0; i < numMaterials; ++i){
+		numChunks += (uint_least32_t)((obj->materials[i].len / 3 + OBJGL_BVH_CHUNK - 1) / OBJGL_BVH_CHUNK);
+	}
+
+	b.chunks = (objbvhchunk_internal*)objgl_talloc(stats, sizeof(objbvhchunk_internal) * numChunks);
+	numChunks = 0;
+
+	for(uint_least32_t i = 0; i < numMaterials; ++i){
+		if(obj->materials[i].len < 3){
+			continue;
+		}
+
+		objgl_count first = (objgl_count)(obj->materials[i].indices - obj->indices) / 3;
+		objgl_count end = first + obj->materials[i].len / 3;
+
+		for(objgl_count k = first; k < end; k += OBJGL_BVH_CHUNK){
+			b.chunks[numChunks].begin = k;
+			b.chunks[numChunks].end = end - k > OBJGL_BVH_CHUNK ? k + OBJGL_BVH_CHUNK : end;
+			b.chunks[numChunks++].material = i;
+		}
+	}
+
+	if(scheduler && numChunks > 1){
+		scheduler->wait(scheduler->userdata, scheduler->submit(scheduler->userdata, objgl_bvh_prep_task, &b, numChunks));
+	} else{
+		for(uint_least32_t i = 0; i < numChunks; ++i){
+			objgl_bvh_prep_task(&b, i);
+		}
+	}
+
+	objbvhbox_internal *boxes = (objbvhbox_internal*)objgl_talloc(stats, sizeof(objbvhbox_internal) * numMaterials);
+	uint_least32_t *ids = (uint_least32_t*)objgl_talloc(stats, sizeof(uint_least32_t) * numMaterials);
+	uint_least32_t numIds = 0;
+
+	for(uint_least32_t i = 0; i < numMaterials; ++i){
+		objgl_bvh_boxinit(&boxes[i]);
+	}
+
+	for(uint_least32_t i = 0; i < numChunks; ++i){
+		objgl_bvh_boxmerge(&boxes[b.chunks[i].material], &b.chunks[i].box);
+	}
+
+	objbvhtop_internal root = (const objbvhtop_internal){0};
+	objgl_bvh_boxinit(&root.box);
+
+	for(uint_least32_t i = 0; i < numMaterials; ++i){
+		if(boxes[i].count){
+			ids[numIds++] = i;
+			objgl_bvh_boxmerge(&root.box, &boxes[i]);
+		}
+	}
+
+	objgl_tfree(stats, b.chunks, sizeof(objbvhchunk_internal) * numChunks);
+
+	//the top of the tree, first the groups of materials then the big nodes of a single one, each appended child is expanded in turn
+	uint_least32_t numTop = 1, resTop = 64, numTasks = 0;
+	objbvhtop_internal *top = (objbvhtop_internal*)objgl_talloc(stats, sizeof(objbvhtop_internal) * resTop);
+	objbvhkey_internal *keys = (objbvhkey_internal*)objgl_talloc(stats, sizeof(objbvhkey_internal) * numIds);
+	float *rightCost = (float*)objgl_talloc(stats, sizeof(float) * numIds);
+	root.groupEnd = numIds;
+	top[0] = root;
+
+	for(uint_least32_t i = 0; i < numTop; ++i){
+		objbvhtop_internal node = top[i];
+		objbvhtop_internal children[2];
+
+		if(node.groupEnd - node.groupBegin == 1){
+			uint_least32_t m = ids[node.groupBegin];
+			node.begin = (objgl_count)(obj->materials[m].indices - obj->indices) / 3;
+			node.box = boxes[m];
+			node.groupBegin = node.groupEnd;
+		}
+
+		if(node.groupEnd - node.groupBegin > 1){
+			uint_least32_t left = objgl_bvh_group(boxes, ids + node.groupBegin, node.groupEnd - node.groupBegin, keys, rightCost);
+
+			for(unsigned int k = 0; k < 2; ++k){
+				children[k] = (const objbvhtop_internal){0};
+				children[k].groupBegin = k ? node.groupBegin + left : node.groupBegin;
+				children[k].groupEnd = k ? node.groupEnd : node.groupBegin + left;
+				objgl_bvh_boxinit(&children[k].box);
+
+				for(uint_least32_t g = children[k].groupBegin; g < children[k].groupEnd; ++g){
+					objgl_bvh_boxmerge(&children[k].box, &boxes[ids[g]]);
+				}
+			}
+		} else if(node.box.count > OBJGL_BVH_TASK){
+			for(unsigned int k = 0; k < 2; ++k){
+				children[k] = (const objbvhtop_internal){0};
+			}
+
+			objgl_bvh_split(&b, scheduler, stats, node.begin, &node.box, &children[0].box, &children[1].box);
+			children[0].begin = node.begin;
+			children[1].begin = node.begin + children[0].box.count;
+		} else{
+			node.child[0] = node.child[1] = OBJGL_NOTFOUND;
+			node.subtree = numTasks++;
+			top[i] = node;
+			continue;
+		}
+
+		if(numTop + 2 > resTop){
+			uint_least32_t oldsize = resTop;
+			resTop += resTop;
+			top = (objbvhtop_internal*)objgl_trealloc(stats, top, sizeof(objbvhtop_internal) * resTop, sizeof(objbvhtop_internal) * oldsize);
+		}
+
+		node.child[0] = numTop;
+		node.child[1] = numTop + 1;
+		top[numTop++] = children[0];
+		top[numTop++] = children[1];
+		top[i] = node;
+	}
+
+	objgl_tfree(stats, keys, sizeof(objbvhkey_internal) * numIds);
+	objgl_tfree(stats, rightCost, sizeof(float) * numIds);
+	objgl_tfree(stats, boxes, sizeof(objbvhbox_internal) * numMaterials);
+	objgl_tfree(stats, ids, sizeof(uint_least32_t) * numMaterials);
+
+	//the subtrees in parallel
+	uint_least32_t *tasks = (uint_least32_t*)objgl_talloc(stats, sizeof(uint_least32_t) * numTasks);
+	objbvhnodes_internal *subtrees = (objbvhnodes_internal*)objgl_tcalloc(stats, numTasks, sizeof(objbvhnodes_internal));
+
+	for(uint_least32_t i = 0, k = 0; i < numTop; ++i){
+		if(top[i].child[0] == OBJGL_NOTFOUND){
+			tasks[k++] = i;
+		}
+	}
+
+	b.top = top;
+	b.tasks = tasks;
+	b.subtrees = subtrees;
+
+	if(scheduler && numTasks > 1){
+		scheduler->wait(scheduler->userdata, scheduler->submit(scheduler->userdata, objgl_bvh_subtree_task, &b, numTasks));
+	} else{
+		for(uint_least32_t i = 0; i < numTasks; ++i){
+			objgl_bvh_subtree_task(&b, i);
+		}
+	}
+
+	objgl_count numNodes = numTop - numTasks;
+
+	for(uint_least32_t i = 0; i < numTasks; ++i){
+		numNodes += subtrees[i].num;
+	}
+
+	bvh->nodes = (objgl2BVHNode*)objgl_talloc(stats, sizeof(objgl2BVHNode) * numNodes);
+	bvh->triangles = (objgl2Index*)objgl_talloc(stats, sizeof(objgl2Index) * numTris);
+	bvh->numNodes = numNodes;
+	bvh->numTriangles = numTris;
+
+	for(objgl_count i = 0; i < numTris; ++i){
+		bvh->triangles[i] = b.tris[i].id;
+	}
+
+	objgl_tfree(stats, b.tris, sizeof(objbvhtri_internal) * numTris);
+
+	//the top nodes and the subtrees into one depth-first array, the stack holds the second children still to be written
+	uint_fast32_t numWork = 1, resWork = 64;
+	objbvhwork_internal *work = (objbvhwork_internal*)objgl_alloc(sizeof(objbvhwork_internal) * resWork);
+	work[0].begin = 0;
+	work[0].parent = (objgl_count)-1;
+	work[0].depth = 1;
+	objgl_count num = 0;
+
+	while(numWork){
+		objbvhwork_internal w = work[--numWork];
+		uint_least32_t i = (uint_least32_t)w.begin;
+
+		if(w.parent != (objgl_count)-1){
+			bvh->nodes[w.parent].first = (objgl2Index)num;
+		}
+
+		while(top[i].child[0] != OBJGL_NOTFOUND){
+			objgl_bvh_setnode(&bvh->nodes[num], &top[i].box);
+			bvh->nodes[num].count = 0;
+
+			if(numWork == resWork){
+				resWork += resWork;
+				work = (objbvhwork_internal*)objgl_realloc(work, sizeof(objbvhwork_internal) * resWork);
+			}
+
+			work[numWork].begin = top[i].child[1];
+			work[numWork].parent = num++;
+			work[numWork++].depth = w.depth + 1;
+
+			i = top[i].child[0];
+			++w.depth;
+		}
+
+		const objbvhnodes_internal *sub = &subtrees[top[i].subtree];
+
+		for(objgl_count k = 0; k < sub->num; ++k){
+			bvh->nodes[num + k] = sub->nodes[k];
+
+			if(!sub->nodes[k].count){
+				bvh->nodes[num + k].first += (objgl2Index)num;
+			}
+		}
+
+		num += sub->num;
+		bvh->depth = w.depth - 1 + sub->depth > bvh->depth ? w.depth - 1 + sub->depth : bvh->depth;
+	}
+
+	objgl_free(work);
+
+	for(uint_least32_t i = 0; i < numTasks; ++i){
+		objgl_free(subtrees[i].nodes);
+	}
+
+	objgl_tfree(stats, subtrees, sizeof(objbvhnodes_internal) * numTasks);
+	objgl_tfree(stats, tasks, sizeof(uint_least32_t) * numTasks);
+	objgl_tfree(stats, top, sizeof(objbvhtop_internal) * resTop);
+
+	if(stats){
+		stats->bvhSeconds += objgl_now() - bvhStart;
+	}
+}
+
+void objgl2_bvh_build(objgl2Data *obj, const objgl2Scheduler *scheduler){
+	objgl_bvh_build(obj, scheduler, NULL);
+}
+
+//the children come after their parents, so the bounds are rebuilt from the back
+void objgl2_bvh_refit(objgl2Data *obj){
+	objgl2BVH *bvh = obj->bvh;
+
+	for(objgl_count i = bvh ? bvh->numNodes : 0; i-- > 0;){
+		objgl2BVHNode *node = &bvh->nodes[i];
+
+		for(unsigned int c = 0; c < 3; ++c){
+			node->min[c] = FLT_MAX;
+			node->max[c] = -FLT_MAX;
+		}
+
+		if(node->count){
+			for(objgl_count t = node->first; t < node->first + node->count; ++t){
+				for(unsigned int k = 0; k < 3; ++k){
+					const float *p = objgl_bvh_vertex(obj, bvh->triangles[t], k);
+
+					for(unsigned int c = 0; c < 3; ++c){
+						node->min[c] = p[c] < node->min[c] ? p[c] : node->min[c];
+						node->max[c] = p[c] > node->max[c] ? p[c] : node->max[c];
+					}
+				}
+			}
+		} else{
+			const objgl2BVHNode *a = &bvh->nodes[i + 1], *b = &bvh->nodes[node->first];
+
+			for(unsigned int c = 0; c < 3; ++c){
+				node->min[c] = a->min[c] < b->min[c] ? a->min[c] : b->min[c];
+				node->max[c] = a->max[c] > b->max[c] ? a->max[c] : b->max[c];
+			}
+		}
+	}
+}
+
+//where the ray enters the node, non-zero if that's before tmax. 0 * inf is NaN and NaN doesn't move the interval
+char objgl_bvh_slab(const objgl2BVHNode *node, const float *origin, const float *inv, float tmax, float *entry){
+	float t0 = 0, t1 = tmax;
+
+	for(unsigned int c = 0; c < 3; ++c){
+		float a = (node->min[c] - origin[c]) * inv[c];
+		float b = (node->max[c] - origin[c]) * inv[c];
+
+		if(a > b){
+			float t = a;
+			a = b;
+			b = t;
+		}
+
+		t0 = a > t0 ? a : t0;
+		t1 = b < t1 ? b : t1;
+	}
+
+	*entry = t0;
+
+	return t0 <= t1;
+}
+
+//Moller-Trumbore, updates the hit if the triangle is nearer
+void objgl_bvh_triangle(const objgl2Data *obj, objgl2Index tri, const objgl2Ray *ray, objgl2Hit *hit){
+	const float *a = objgl_bvh_vertex(obj, tri, 0), *b = objgl_bvh_vertex(obj, tri, 1), *c = objgl_bvh_vertex(obj, tri, 2);
+	const float *d = ray->dir;
+	float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+	float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+	float p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+	float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+
+	if(!(det > 0 || det < 0)){
+		return;
+	}
+
+	float inv = 1.0f / det;
+	float s[3] = {ray->origin[0] - a[0], ray->origin[1] - a[1], ray->origin[2] - a[2]};
+	float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+
+	if(!(u >= 0 && u <= 1)){
+		return;
+	}
+
+	float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+	float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+
+	if(!(v >= 0 && u + v <= 1)){
+		return;
+	}
+
+	float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+
+	if(t >= 0 && t < hit->t){
+		hit->t = t;
+		hit->u = u;
+		hit->v = v;
+		hit->triangle = tri;
+	}
+}
+
+//the materials' indices follow each other in their order
+uint_least32_t objgl_bvh_material(const objgl2Data *obj, objgl2Index tri){
+	objgl_count index = (objgl_count)tri * 3;
+	uint_least32_t lo = 0, hi = obj->numMaterials;
+
+	while(hi - lo > 1){
+		uint_least32_t mid = lo + (hi - lo) / 2;
+
+		if((objgl_count)(obj->materials[mid].indices - obj->indices) <= index){
+			lo = mid;
+		} else{
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+void objgl_bvh_hitinit(const objgl2Ray *ray, objgl2Hit *hit, float *inv){
+	hit->t = ray->tmax;
+	hit->u = hit->v = 0;
+	hit->triangle = OBJGL2_NOHIT;
+	hit->material = 0;
+
+	for(unsigned int c = 0; c < 3; ++c){
+		inv[c] = 1.0f / ray->dir[c];
+	}
+}
+
+typedef struct{
+	objgl2Index node;
+	float entry;
+} objbvhstack_internal;
+
+char objgl2_bvh_raycast(const objgl2Data *obj, const objgl2Ray *ray, objgl2Hit *hit){
+	const objgl2BVH *bvh = obj->bvh;
+	float inv[3], entry;
+	objgl_bvh_hitinit(ray, hit, inv);
+
+	if(!bvh || !bvh->numNodes || !objgl_bvh_slab(&bvh->nodes[0], ray->origin, inv, hit->t, &entry)){
+		return 0;
+	}
+
+	objbvhstack_internal local[OBJGL_BVH_STACK];
+	objbvhstack_internal *stack = bvh->depth > OBJGL_BVH_STACK ? (objbvhstack_internal*)objgl_alloc(sizeof(objbvhstack_internal) * bvh->depth) : local;
+	uint_fast32_t n = 0;
+	objgl2Index i = 0;
+
+	while(1){
+		const objgl2BVHNode *node = &bvh->nodes[i];
+
+		if(node->count){
+			for(objgl2Index k = 0; k < node->count; ++k){
+				objgl_bvh_triangle(obj, bvh->triangles[node->first + k], ray, hit);
+			}
+		} else{
+			float e0, e1;
+			char h0 = objgl_bvh_slab(&bvh->nodes[i + 1], ray->origin, inv, hit->t, &e0);
+			char h1 = objgl_bvh_slab(&bvh->nodes[node->first], ray->origin, inv, hit->t, &e1);
+
+			if(h0 && h1){
+				//the nearer one first, the other one may be culled by its hit
+				char swap = e1 < e0;
+				stack[n].node = swap ? i + 1 : node->first;
+				stack[n++].entry = swap ? e0 : e1;
+				i = swap ? node->first : i + 1;
+				continue;
+			}
+
+			if(h0 || h1){
+				i = h0 ? i + 1 : node->first;
+				continue;
+			}
+		}
+
+		while(n && stack[n - 1].entry > hit->t){
+			--n;
+		}
+
+		if(!n){
+			break;
+		}
+
+		i = stack[--n].node;
+	}
+
+	if(stack != local){
+		objgl_free(stack);
+	}
+
+	if(hit->triangle != OBJGL2_NOHIT){
+		hit->material = objgl_bvh_material(obj, hit->triangle);
+		return 1;
+	}
+
+	return 0;
+}
+
+typedef struct{
+	objgl2Index node;
+	uint_fast32_t mask;
+} objbvhpacketstack_internal;
+
+//the rays of the packet that enter the node, and the nearest entry of them
+uint_fast32_t objgl_bvh_packet_slab(const objgl2BVHNode *node, const objgl2Ray *rays, float (*inv)[3], const objgl2Hit *hits, uint_fast32_t mask, float *entry){
+	uint_fast32_t hit = 0;
+	*entry = FLT_MAX;
+
+	for(unsigned int r = 0; r < OBJGL_BVH_PACKET; ++r){
+		float e;
+
+		if((mask >> r & 1) && objgl_bvh_slab(node, rays[r].origin, inv[r], hits[r].t, &e)){
+			hit |= (uint_fast32_t)1 << r;
+			*entry = e < *entry ? e : *entry;
+		}
+	}
+
+	return hit;
+}
+
+//up to OBJGL_BVH_PACKET rays go down the tree together, a node is visited if any of them enters it
+void objgl_bvh_packet(const objgl2Data *obj, const objgl2Ray *rays, uint_fast32_t count, objgl2Hit *hits){
+	const objgl2BVH *bvh = obj->bvh;
+	float inv[OBJGL_BVH_PACKET][3], entry;
+
+	for(uint_fast32_t r = 0; r < count; ++r){
+		objgl_bvh_hitinit(&rays[r], &hits[r], inv[r]);
+	}
+
+	if(!bvh || !bvh->numNodes){
+		return;
+	}
+
+	uint_fast32_t mask = objgl_bvh_packet_slab(&bvh->nodes[0], rays, inv, hits, ((uint_fast32_t)1 << count) - 1, &entry);
+
+	if(!mask){
+		return;
+	}
+
+	objbvhpacketstack_internal local[OBJGL_BVH_STACK];
+	objbvhpacketstack_internal *stack = bvh->depth > OBJGL_BVH_STACK ? (objbvhpacketstack_internal*)objgl_alloc(sizeof(objbvhpacketstack_internal) * bvh->depth) : local;
+	uint_fast32_t n = 0;
+	objgl2Index i = 0;
+
+	while(1){
+		const objgl2BVHNode *node = &bvh->nodes[i];
+
+		if(node->count){
+			for(objgl2Index k = 0; k < node->count; ++k){
+				for(unsigned int r = 0; r < count; ++r){
+					if(mask >> r & 1){
+						objgl_bvh_triangle(obj, bvh->triangles[node->first + k], &rays[r], &hits[r]);
+					}
+				}
+			}
+		} else{
+			float e0, e1;
+			uint_fast32_t m0 = objgl_bvh_packet_slab(&bvh->nodes[i + 1], rays, inv, hits, mask, &e0);
+			uint_fast32_t m1 = objgl_bvh_packet_slab(&bvh->nodes[node->first], rays, inv, hits, mask, &e1);
+
+			if(m0 && m1){
+				char swap = e1 < e0;
+				stack[n].node = swap ? i + 1 : node->first;
+				stack[n++].mask = swap ? m0 : m1;
+				i = swap ? node->first : i + 1;
+				mask = swap ? m1 : m0;
+				continue;
+			}
+
+			if(m0 || m1){
+				i = m0 ? i + 1 : node->first;
+				mask = m0 ? m0 : m1;
+				continue;
+			}
+		}
+
+		//the hits found meanwhile may have culled the rest for some of the rays
+		mask = 0;
+
+		while(n && !mask){
+			--n;
+			mask = objgl_bvh_packet_slab(&bvh->nodes[stack[n].node], rays, inv, hits, stack[n].mask, &entry);
+		}
+
+		if(!mask){
+			break;
+		}
+
+		i = stack[n].node;
+	}
+
+	if(stack != local){
+		objgl_free(stack);
+	}
+
+	for(uint_fast32_t r = 0; r < count; ++r){
+		if(hits[r].triangle != OBJGL2_NOHIT){
+			hits[r].material = objgl_bvh_material(obj, hits[r].triangle);
+		}
+	}
+}
+
+void objgl2_bvh_raycast_packet(const objgl2Data *obj, const objgl2Ray *rays, uint_least32_t count, objgl2Hit *hits){
+	for(uint_least32_t i = 0; i < count; i += OBJGL_BVH_PACKET){
+		objgl_bvh_packet(obj, rays + i, count - i < OBJGL_BVH_PACKET ? count - i : OBJGL_BVH_PACKET, hits + i);
+	}
+}
+
+//the parser between two pieces of the file, the data is either pulled from a stream or pushed by the caller
+typedef struct{
+	objparse_internal parse;
+	objcache_internal vertCache;
+	const objgl2LoadOptions *options;
+	objgl2Stats *stats, *scratchStats;
+	objscratch_internal *scratch, localScratch;
+	const char *filename; //mtllib paths are relative to it, NULL if there's no file
+	uint_fast32_t objDirLen;
+	uint_least64_t faceLines, materialLines, objectLines, mtllibLines, otherLines;
+	uint_least64_t skippedTexcoords, skippedNormals; //vt and vn lines not stored because of the flags
+	uint_least64_t lines; //parsed so far
+	objgl2Error invalid; //the first face OBJGL2_VALIDATE rejected, code is OBJGL2_OK if there's none
+	objsnapshot_internal snap;
+	objobjects_internal *objects; //NULL unless every o block is read
+	char stop; //'\0' or the next object ended the data
+} objparser_internal;
+
+//scratch is NULL for a standalone load, its buffers are then allocated and freed by the load itself
+void objgl_parser_begin(objparser_internal *p, const objgl2LoadOptions *options, objscratch_internal *scratch, const char *filename){
+	*p = (const objparser_internal){{{{0}}}};
+	p->options = options;
+	p->stats = options->stats;
+	p->filename = filename;
+	p->objDirLen = filename ? objgl_dirlen(filename) : 0;
+
+	if(p->stats){
+		*p->stats = (const objgl2Stats){0};
+	}
+
+	if(options->error){
+		*options->error = (const objgl2Error){OBJGL2_OK, NULL};
+	}
+
+	//a worker's scratch outlives the load, so its buffers are not counted
+	p->scratchStats = scratch ? NULL : p->stats;
+	p->scratch = scratch ? scratch : &p->localScratch;
+	scratch = p->scratch;
+
+	if(!scratch->positions){
+		scratch->info = (const objinfo_internal){0, 0, 0, 256, 256, 256};
+		scratch->positions = (objgl_vec3*)objgl_talloc(p->scratchStats, sizeof(objgl_vec3) * scratch->info.resPositions);
+		scratch->normals = (objgl_vec3*)objgl_talloc(p->scratchStats, sizeof(objgl_vec3) * scratch->info.resNormals);
+		scratch->texcoords = (objgl_vec2*)objgl_talloc(p->scratchStats, sizeof(objgl_vec2) * scratch->info.resTexcoords);
+		scratch->vertCache = (objcache_internal){(objfacevert*)objgl_talloc(p->scratchStats, sizeof(objfacevert) * 32), 32};
+		scratch->resMaterials = 64;
+		scratch->materials = (objmaterial_internal*)objgl_talloc(p->scratchStats, sizeof(objmaterial_internal) * scratch->resMaterials);
+	}
+
+	p->parse.info = scratch->info;
+	p->parse.info.numPositions = p->parse.info.numNormals = p->parse.info.numTexcoords = 0;
+	p->parse.positions = scratch->positions;
+	p->parse.normals = scratch->normals;
+	p->parse.texcoords = scratch->texcoords;
+	p->parse.hasNormals = !(options->flags & OBJGL2_SKIP_NORMALS);
+	p->parse.hasTextures = !(options->flags & OBJGL2_SKIP_TEXCOORDS);
+	p->vertCache = scratch->vertCache;
+
+	objgl_matstate_init(&p->parse.mat, scratch->materials, scratch->resMaterials, p->stats);
+	p->snap.next = options->snapshotBytes ? options->snapshotBytes : OBJGL2_SNAPSHOT_BYTES;
+}
+
+//parses the lines that start before end, the last one must end with a newline, returns where it stopped
+objgl_pos objgl_parser_lines(objparser_internal *p, char *buffer, objgl_pos pos, objgl_pos end){
+	//the state lives in locals while the lines are parsed
+	const objgl2LoadOptions *options = p->options;
+	objgl2Stats *stats = p->stats, *scratchStats = p->scratchStats;
+	objinfo_internal info = p->parse.info;
+	objgl_vec3 *positions = p->parse.positions;
+	objgl_vec3 *normals = p->parse.normals;
+	objgl_vec2 *texcoords = p->parse.texcoords;
+	objmatstate_internal mat = p->parse.mat;
+	objmtlrefs_internal mtlRefs = p->parse.mtlRefs;
+	objcache_internal vertCache = p->vertCache;
+	objgl_count numIndices = p->parse.numIndices;
+	char* name = p->parse.name;
+	char hasTextures = p->parse.hasTextures;
+	char hasNormals = p->parse.hasNormals;
+	uint_least64_t faceLines = p->faceLines, materialLines = p->materialLines, objectLines = p->objectLines, mtllibLines = p->mtllibLines, otherLines = p->otherLines;
+	uint_least64_t skippedTexcoords = p->skippedTexcoords, skippedNormals = p->skippedNormals;
+	char skipTexcoords = (options->flags & OBJGL2_SKIP_TEXCOORDS) != 0, skipNormals = (options->flags & OBJGL2_SKIP_NORMALS) != 0;
+	objgl2Index keepTexcoords = skipTexcoords ? 0 : (objgl2Index)-1, keepNormals = skipNormals ? 0 : (objgl2Index)-1;
+	char validate = (options->flags & OBJGL2_VALIDATE) != 0;
+	char allObjects = (options->flags & OBJGL2_ALL_OBJECTS) != 0;
+	uint_least64_t lines = p->lines;
+	char stop = 0;
+
+	//every case consumes one line, a last one without a newline is left at its '\0' for the case below
+	while(pos < end){
+		++lines;
+
+		switch(buffer[pos]){
+		case 'v':{
+			++pos;
+			unsigned int mode = 0;
+
+			switch(buffer[pos]){
+			case 'n':
+				++pos;
+				mode = 1;
+				break;
+			case 't':
+				++pos;
+				mode = 2;
+				break;
+			default:
+				break;
+			}
+
+			if((mode == 1 && skipNormals) || (mode == 2 && skipTexcoords)){
+				skippedNormals += mode == 1;
+				skippedTexcoords += mode == 2;
+
+				while(buffer[pos] != '\n' && buffer[pos] != '\0'){++pos;}
+				pos += buffer[pos] == '\n';
+				break;
+			}
+
+			objgl_vec4 vec = objgl_parsevector(buffer, &pos);
+
+			switch(mode){
+			case 0:
+				if(info.numPositions >= info.resPositions){
+					uint_fast32_t oldsize = info.resPositions;
+					info.resPositions += info.resPositions;
+					positions = (objgl_vec3*)objgl_trealloc(scratchStats, positions, sizeof(objgl_vec3) * info.resPositions, sizeof(objgl_vec3) * oldsize);
+				}
+
+				memcpy(&positions[info.numPositions++], vec.a, sizeof(objgl_vec3));
+				break;
+			case 1:
+				if(info.numNormals >= info.resNormals){
+					uint_fast32_t oldsize = info.resNormals;
+					info.resNormals += info.resNormals;
+					normals = (objgl_vec3*)objgl_trealloc(scratchStats, normals, sizeof(objgl_vec3) * info.resNormals, sizeof(objgl_vec3) * oldsize);
+				}
+
+				memcpy(&normals[info.numNormals++], vec.a, sizeof(objgl_vec3));
+				break;
+			case 2:
+				if(info.numTexcoords >= info.resTexcoords){
+					uint_fast32_t oldsize = info.resTexcoords;
+					info.resTexcoords += info.resTexcoords;
+					texcoords = (objgl_vec2*)objgl_trealloc(scratchStats, texcoords, sizeof(objgl_vec2) * info.resTexcoords, sizeof(objgl_vec2) * oldsize);
+				}
+
+				memcpy(&texcoords[info.numTexcoords++], vec.a, sizeof(objgl_vec2));
+				break;
+			}
+			break;
+		}
+		case 'o':{
+			++objectLines;
+			objgl_pos temp = pos;
+			++temp;
+
+			while(buffer[temp] == ' '){++temp;}
+			char* strstart = &buffer[temp];
+
+			if(p->objects){
+				objgl_objects_add(p->objects, objgl_strpool_add(&mat.names, strstart, objgl_strlen(strstart), stats), (uint_least32_t)mat.index, mat.cur.numIndices, stats);
+			} else if(name && !allObjects && !objgl_strcmp(strstart, name)){
+				stop = 1;
+				goto loopexit;
+			} else if(!name){
+				uint_least32_t strlen = objgl_strlen(strstart);
+				name = (char*)objgl_talloc(stats, strlen + 1);
+				name[strlen] = '\0';
+				for(; strlen; --strlen){
+					name[strlen - 1] = strstart[strlen - 1];
+				}
+
+			}
+
+			pos = temp;
+			while(buffer[pos] != '\n' && buffer[pos] != '\0'){++pos;}
+			pos += buffer[pos] == '\n';
+			break;
+		}
+		case 'u':{
+			++materialLines;
+			if(!objgl_iskeyword(&buffer[pos], "usemtl")){
+				while(buffer[pos] != '\n' && buffer[pos] != '\0'){++pos;}
+				pos += buffer[pos] == '\n';
+				break;
+			}
+
+			pos += 6;
+
+			while(buffer[pos] == ' '){++pos;}
+
+			char* matname = &buffer[pos];
+			objgl_usemtl(&mat, matname, objgl_strlen(matname), stats, scratchStats);
+
+			if(p->objects && p->objects->segments[p->objects->numSegments - 1].material != mat.index){
+				objgl_objects_segment(p->objects, (uint_least32_t)mat.index, mat.cur.numIndices, stats);
+			}
+
+			while(buffer[pos] != '\n' && buffer[pos] != '\0'){++pos;}
+			pos += buffer[pos] == '\n';
+			break;
+		}
+		case 'f':{
+			++faceLines;
+			++pos;
+
+			uint_fast32_t numindices = objgl_parseindices(buffer, &pos, &vertCache, &info, scratchStats);
+			pos += buffer[pos] == '\n';
+
+			//a stray character would be read as a 0 index, so the face can't be trusted in any mode
+			if(!numindices){
+				p->invalid = (const objgl2Error){OBJGL2_EINDEX, "a face line with something else than indices", lines};
+				stop = 1;
+				goto loopexit;
+			}
+
+			uint_fast32_t totalindices = (numindices - 2) * 3;
+
+			if(skipTexcoords || skipNormals){
+				objgl_keepcomponents(vertCache.cache, numindices, keepTexcoords, keepNormals);
+			}
+
+			if(validate){
+				const char *reason = objgl_checkface(vertCache.cache, numindices, &info);
+
+				if(reason){
+					p->invalid = (const objgl2Error){OBJGL2_EINDEX, reason, lines};
+					stop = 1;
+					goto loopexit;
+				}
+			} else if(numindices < 3){
+				break;
+			}
+
+			uint_fast32_t tris = (numindices - 2);
+
+			if(mat.cur.numIndices + totalindices >= mat.cur.resIndices){
+				uint_fast32_t oldsize = mat.cur.resIndices;
+				mat.cur.resIndices += mat.cur.resIndices + totalindices;
+				mat.cur.indices = (objfacevert*)objgl_trealloc(stats, mat.cur.indices, sizeof(objfacevert) * mat.cur.resIndices, sizeof(objfacevert) * oldsize);
+			}
+
+			if(numindices < 4){
+				mat.cur.indices[mat.cur.numIndices++] = vertCache.cache[0];
+				mat.cur.indices[mat.cur.numIndices++] = vertCache.cache[1];
+				mat.cur.indices[mat.cur.numIndices++] = vertCache.cache[2];
+
+				numIndices += 3;
+			} else{
+				for(uint_fast32_t i = 0, j = 1; i < tris; ++i){
+					mat.cur.indices[mat.cur.numIndices++] = vertCache.cache[0];
+					mat.cur.indices[mat.cur.numIndices++] = vertCache.cache[j];
+					mat.cur.indices[mat.cur.numIndices++] = vertCache.cache[++j];
+				}
+
+				numIndices += totalindices;
+			}
+
+			hasNormals = hasNormals && vertCache.cache[0].a[2];
+			hasTextures = hasTextures && vertCache.cache[0].a[1];
+
+			break;
+		}
+		case 'm':{
+			if(options->mtldb && objgl_iskeyword(&buffer[pos], "mtllib")){
+				++mtllibLines;
+				pos += 6;
+
+				while(1){
+					while(buffer[pos] == ' ' || buffer[pos] == '\t'){++pos;}
+
+					char *libname = &buffer[pos];
+					uint_least32_t libnamelen = objgl_strlen(libname);
+
+					if(!libnamelen){
+						break;
+					}
+
+					pos += libnamelen;
+
+					uint_fast32_t pathlen;
+					char *path = objgl_joinpath(p->filename, p->objDirLen, libname, libnamelen, &pathlen);
+					objgl_mutex_lock(&options->mtldb->lock);
+					uint_least32_t lib = objgl_mtldb_library(options->mtldb, path, pathlen, NULL);
+					objgl_mutex_unlock(&options->mtldb->lock);
+
+					if(mtlRefs.numLibraries >= mtlRefs.resLibraries){
+						uint_fast32_t oldsize = mtlRefs.resLibraries;
+						mtlRefs.resLibraries += mtlRefs.resLibraries + 4;
+						mtlRefs.libraries = (uint_least32_t*)objgl_trealloc(stats, mtlRefs.libraries, sizeof(uint_least32_t) * mtlRefs.resLibraries, sizeof(uint_least32_t) * oldsize);
+					}
+
+					mtlRefs.libraries[mtlRefs.numLibraries++] = lib;
+				}
+			}
+
+			while(buffer[pos] != '\n' && buffer[pos] != '\0'){++pos;}
+			pos += buffer[pos] == '\n';
+			break;
+		}
+		case '\0':
+			stop = 1;
+			goto loopexit;
+		default:
+			++otherLines;
+			while(buffer[pos] != '\n' && buffer[pos] != '\0'){++pos;}
+			pos += buffer[pos] == '\n';
+			break;
+		}
+	}
+
+	loopexit:
+	p->parse.info = info;
+	p->parse.positions = positions;
+	p->parse.normals = normals;
+	p->parse.texcoords = texcoords;
+	p->parse.mat = mat;
+	p->parse.mtlRefs = mtlRefs;
+	p->vertCache = vertCache;
+	p->parse.numIndices = numIndices;
+	p->parse.name = name;
+	p->parse.hasTextures = hasTextures;
+	p->parse.hasNormals = hasNormals;
+	p->faceLines = faceLines;
+	p->materialLines = materialLines;
+	p->objectLines = objectLines;
+	p->mtllibLines = mtllibLines;
+	p->otherLines = otherLines;
+	p->skippedTexcoords = skippedTexcoords;
+	p->skippedNormals = skippedNormals;
+	p->lines = lines;
+	p->stop = stop;
+
+	return pos;
+}
+
+//builds the object or, if code isn't OBJGL2_OK, frees what was parsed and returns a zeroed one
+//parsed is NULL for a regular load, otherwise the assembly is skipped and the attributes and the keys are handed over to it
+objgl2Data objgl_parser_result(objparser_internal *p, int code, objgl2Parsed *parsed){
+	const objgl2LoadOptions *options = p->options;
+	objgl2Stats *stats = p->stats;
+	objscratch_internal *scratch = p->scratch;
+	objmatstate_internal *mat = &p->parse.mat;
+
+	//a rejected face stopped the parser, what it read up to there is dropped
+	if(code == OBJGL2_OK && p->invalid.code != OBJGL2_OK){
+		code = p->invalid.code;
+	}
+
+	mat->list[mat->index] = mat->cur;
+	objgl_tfree(stats, mat->table.slots, sizeof(objstrslot_internal) * (mat->table.slots ? mat->table.mask + 1 : 0));
+	mat->table = (const objstrtable_internal){0};
+
+	scratch->vertCache = p->vertCache;
+	scratch->positions = p->parse.positions;
+	scratch->normals = p->parse.normals;
+	scratch->texcoords = p->parse.texcoords;
+	scratch->info = p->parse.info;
+	scratch->materials = mat->list;
+	scratch->resMaterials = mat->res;
+
+	objgl2Data obj = (const objgl2Data){0};
+
+	if(code != OBJGL2_OK){
+		for(uint_fast32_t i = 0; i < mat->num; ++i){
+			objgl_tfree(stats, mat->list[i].indices, sizeof(objfacevert) * mat->list[i].resIndices);
+		}
+
+		uint_fast32_t nameLen = 0;
+		char *name = p->parse.name;
+		while(name && name[nameLen]){++nameLen;}
+
+		objgl_tfree(stats, name, name ? nameLen + 1 : 0);
+		objgl_tfree(stats, mat->names.data, mat->names.res);
+		objgl_tfree(stats, p->parse.mtlRefs.libraries, sizeof(uint_least32_t) * p->parse.mtlRefs.resLibraries);
+
+		if(options->error){
+			*options->error = code == OBJGL2_EINDEX ? p->invalid : code == OBJGL2_ECANCELLED ? (const objgl2Error){code, "cancelled by the progress callback"} : (const objgl2Error){code, "can't read the file"};
+		}
+	} else{
+		if(stats){
+			stats->positionLines = p->parse.info.numPositions;
+			stats->texcoordLines = p->parse.info.numTexcoords + p->skippedTexcoords;
+			stats->normalLines = p->parse.info.numNormals + p->skippedNormals;
+			stats->faceLines = p->faceLines;
+			stats->materialLines = p->materialLines;
+			stats->objectLines = p->objectLines;
+			stats->mtllibLines = p->mtllibLines;
+			stats->otherLines = p->otherLines;
+		}
+
+		//a load that published snapshots finishes them, unless the keys are asked for
+		if(p->snap.vertSize && !parsed){
+			obj = objgl_snapshot_finish(&p->snap, &p->parse, options);
+		} else{
+			obj = objgl_build(&p->parse, options, scratch, p->scratchStats, parsed);
+		}
+
+		if(options->weld){
+			objgl_weld(&obj, parsed, options);
+		}
+
+		if(options->bvh && !parsed){
+			objgl_bvh_build(&obj, options->scheduler, stats);
+		}
+	}
+
+	objgl_snapshot_delete(&p->snap, stats);
+
+	if(scratch == &p->localScratch){
+		objgl_scratch_delete(scratch, stats);
+	}
+
+	return obj;
+}
+
+//size is what objgl_streamsize gave for the stream if the caller measured it already, NULL measures it when there's a progress callback
+objgl2Data objgl_readobj_scratch(objgl2StreamInfo *strinfoptr, const objgl2LoadOptions *options, objscratch_internal *scratch, objgl2Parsed *parsed, const uint_least64_t *size){
+	const objgl2LoadOptions defaults = (const objgl2LoadOptions){0};
+
+	if(!options){
+		options = &defaults;
+	}
+
+	objgl2Stats *stats = options->stats;
+	double startTime = stats ? objgl_now() : 0, ioTime = 0;
+
+	objparser_internal p;
+	objgl_parser_begin(&p, options, scratch, strinfoptr->type != OBJGL_BSTREAM ? strinfoptr->filename : NULL);
+	p.objects = parsed ? parsed->objects : NULL;
+
+	//the faces before the first o line are an object too
+	if(p.objects){
+		objgl_objects_add(p.objects, OBJGL_NONAME, 0, 0, stats);
+	}
+
+	uint_least64_t bytesTotal = !options->progress ? 0 : size ? *size : objgl_streamsize(strinfoptr);
+	char cancelled = 0;
+
+	objgl2_streamreader_ptr streamreader = strinfoptr->function;
+	objgl2StreamInfo strinfo = *strinfoptr;
+	double ioStart = stats ? objgl_now() : 0;
+	objgl2Size bufferLen = streamreader(&strinfo);
+	objgl_pos buffPos = strinfo.buffOffset;
+	uint_least64_t bytesRead = 0, refills = 1;
+
+	if(stats){
+		ioTime = objgl_now() - ioStart;
+	}
+
+	while(1){
+		//a buffer stream is a single refill, so with a progress callback it's parsed in chunks
+		objgl_pos chunkEnd = (options->progress || options->snapshot) && bufferLen - buffPos > OBJGL2_PROGRESS_CHUNK ? buffPos + OBJGL2_PROGRESS_CHUNK : bufferLen;
+
+		buffPos = objgl_parser_lines(&p, strinfo.buffer, buffPos, chunkEnd);
+
+		if(p.stop){
+			break;
+		}
+
+		if(options->snapshot && bytesRead + buffPos - strinfo.buffOffset >= p.snap.next){
+			objgl_snapshot(&p.snap, &p.parse, options, stats, bytesRead + buffPos - strinfo.buffOffset);
+		}
+
+		if(options->progress && options->progress(options->userdata, bytesRead + buffPos - strinfo.buffOffset, bytesTotal)){
+			cancelled = 1;
+			break;
+		}
+
+		if(buffPos < bufferLen){
+			continue;
+		}
+
+		if(strinfo.eof){
+			break;
+		}
+
+		ioStart = stats ? objgl_now() : 0;
+
+		bytesRead += buffPos - strinfo.buffOffset;
+		bufferLen = streamreader(&strinfo);
+		buffPos = strinfo.buffOffset;
+		++refills;
+
+		if(stats){
+			ioTime += objgl_now() - ioStart;
+		}
+	}
+
+	bytesRead += buffPos - strinfo.buffOffset;
+	strinfo.buffOffset = buffPos;
+	*strinfoptr = strinfo;
+
+	//the last chance to cancel, dedup and assembly are not interrupted
+	if(!cancelled && !strinfo.failed && options->progress){
+		cancelled = options->progress(options->userdata, bytesRead, bytesTotal);
+	}
+
+	if(stats){
+		stats->ioSeconds = ioTime;
+		stats->parseSeconds = objgl_now() - startTime - ioTime;
+		stats->bytesRead = bytesRead;
+		stats->refills = refills;
+	}
+
+	return objgl_parser_result(&p, cancelled ? OBJGL2_ECANCELLED : strinfo.failed ? OBJGL2_EIO : OBJGL2_OK, parsed);
+}
+
+objgl2Data objgl2_readobj(objgl2StreamInfo *strinfoptr){
+	return objgl_readobj_scratch(strinfoptr, NULL, NULL, NULL, NULL);
+}
+
+objgl2Data objgl2_readobj_ex(objgl2StreamInfo *strinfoptr, const objgl2LoadOptions *options){
+	return objgl_readobj_scratch(strinfoptr, options, NULL, NULL, NULL);
+}
+
+objgl2Parsed* objgl2_parseobj(objgl2StreamInfo *strinfoptr, const objgl2LoadOptions *options){
+	objgl2LoadOptions parseOptions = options ? *options : (const objgl2LoadOptions){0};
+	objgl2Error error;
+
+	if(!parseOptions.error){
+		parseOptions.error = &error;
+	}
+
+	objgl2Parsed *parsed = (objgl2Parsed*)objgl_alloc(sizeof(objgl2Parsed));
+	*parsed = (const objgl2Parsed){0};
+	parsed->obj = objgl_readobj_scratch(strinfoptr, &parseOptions, NULL, parsed, NULL);
+
+	if(parseOptions.error->code != OBJGL2_OK){
+		objgl_free(parsed);
+		return NULL;
+	}
+
+	return parsed;
+}
+
+objgl2ParsedInfo objgl2_parsed_info(const objgl2Parsed *parsed){
+	objgl2ParsedInfo info;
+	info.obj = &parsed->obj;
+	info.positions = (const float*)parsed->positions;
+	info.texcoords = (const float*)parsed->texcoords;
+	info.normals = (const float*)parsed->normals;
+	info.numPositions = parsed->numPositions;
+	info.numTexcoords = parsed->numTexcoords;
+	info.numNormals = parsed->numNormals;
+	info.keys = parsed->keys;
+
+	return info;
+}
+
+void objgl2_parsed_dropattributes(objgl2Parsed *parsed){
+	objgl_free(parsed->positions);
+	objgl_free(parsed->normals);
+	objgl_free(parsed->texcoords);
+	objgl_free(parsed->keys);
+
+	parsed->positions = parsed->normals = NULL;
+	parsed->texcoords = NULL;
+	parsed->keys = NULL;
+	parsed->numPositions = parsed->numTexcoords = parsed->numNormals = 0;
+}
+
+char objgl2_parsed_assemble(const objgl2Parsed *parsed, void *vertices, uint_least32_t stride, objgl2Index *indices, const objgl2Scheduler *scheduler){
+	const objgl2Data *obj = &parsed->obj;
+
+	if(!stride){
+		stride = obj->vertSize;
+	}
+
+	if(stride < obj->vertSize || (vertices && obj->numVertices && !parsed->keys)){
+		return 0;
+	}
+
+	if(vertices){
+		objkeyassembly_internal assembly = {vertices, stride, (const objfacevert*)parsed->keys, obj->numVertices, parsed->positions, parsed->texcoords, parsed->normals, (char)obj->hasTexCoords, (char)obj->hasNormals, 0};
+		objgl_assemble_run(&assembly, scheduler);
+	}
+
+	//the materials point into obj->indices, so the dedup output stays where it is
+	if(indices && obj->numIndices){
+		memcpy(indices, obj->indices, sizeof(objgl2Index) * obj->numIndices);
+	}
+
+	return 1;
+}
+
+void objgl2_parsed_delete(objgl2Parsed *parsed){
+	if(!parsed){
+		return;
+	}
+
+	objgl2_parsed_dropattributes(parsed);
+	objgl2_deleteobj(&parsed->obj);
+	objgl_free(parsed);
+}
+
+//an o block being matched, its vertices are numbered in the order they're first used
+typedef struct{
+	objfacevert *keys;
+	objgl2Index *indices; //grouped by material
+	uint_least32_t *materials; //in the order they're first used
+	objgl2Size *lens; //indices of each material
+	objgl_count numKeys, numIndices;
+	uint_fast32_t numMaterials;
+} objinstobject_internal;
+
+typedef struct{
+	uint_least64_t hash;
+	uint_least32_t next; //the next mesh in the bucket, OBJGL_NOTFOUND at the end
+	uint_least32_t materials; //offset of the material ids in the list of all meshes' ones
+} objinstmesh_internal;
+
+uint_least64_t objgl_instance_mix(uint_least64_t hash, uint_least64_t word){
+	hash = (hash ^ word) * 0x9E3779B97F4A7C15UL;
+	return hash ^ (hash >> 29);
+}
+
+//the positions aren't hashed, the tolerance would split the matches across buckets
+uint_least64_t objgl_instance_hash(const objinstobject_internal *o, const objgl2Parsed *parsed){
+	uint_least64_t hash = objgl_instance_mix(14695981039346656037UL, o->numKeys);
+
+	for(uint_fast32_t i = 0; i < o->numMaterials; ++i){
+		hash = objgl_instance_mix(objgl_instance_mix(hash, o->materials[i]), o->lens[i]);
+	}
+
+	for(objgl_count i = 0; i < o->numIndices; ++i){
+		hash = objgl_instance_mix(hash, o->indices[i]);
+	}
+
+	for(objgl_count i = 0; i < o->numKeys; ++i){
+		uint_least32_t bits[5];
+
+		if(parsed->obj.hasTexCoords){
+			memcpy(bits, &parsed->texcoords[o->keys[i].a[1] - 1], sizeof(objgl_vec2));
+			hash = objgl_instance_mix(hash, bits[0] | (uint_least64_t)bits[1] << 32);
+		}
+
+		if(parsed->obj.hasNormals){
+			memcpy(bits + 2, &parsed->normals[o->keys[i].a[2] - 1], sizeof(objgl_vec3));
+			hash = objgl_instance_mix(objgl_instance_mix(hash, bits[2] | (uint_least64_t)bits[3] << 32), bits[4]);
+		}
+	}
+
+	return hash;
+}
+
+//the same faces, materials, texcoords and normals as a mesh made before, and positions that differ by a translation within the tolerance
+char objgl_instance_match(const objgl2Data *mesh, const uint_least32_t *meshMaterials, const objinstobject_internal *o, const objgl2Parsed *parsed, float tolerance){
+	if(mesh->numVertices != o->numKeys || mesh->numIndices != o->numIndices || mesh->numMaterials != o->numMaterials){
+		return 0;
+	}
+
+	for(uint_fast32_t i = 0; i < o->numMaterials; ++i){
+		if(meshMaterials[i] != o->materials[i] || mesh->materials[i].len != o->lens[i]){
+			return 0;
+		}
+	}
+
+	if(memcmp(mesh->indices, o->indices, sizeof(objgl2Index) * o->numIndices)){
+		return 0;
+	}
+
+	const float *origin = parsed->positions[o->keys[0].a[0] - 1].a;
+	uint_fast32_t floats = mesh->vertSize / sizeof(float);
+
+	for(objgl_count k = 0; k < o->numKeys; ++k){
+		const float *v = mesh->data + (size_t)k * floats;
+		const float *p = parsed->positions[o->keys[k].a[0] - 1].a;
+
+		for(uint_fast32_t c = 0; c < 3; ++c){
+			double d = ((double)p[c] - origin[c]) - ((double)v[c] - mesh->data[c]);
+
+			if(d > tolerance || d < -tolerance){
+				return 0;
+			}
+		}
+
+		if(mesh->hasTexCoords && memcmp(v + 3, &parsed->texcoords[o->keys[k].a[1] - 1], sizeof(objgl_vec2))){
+			return 0;
+		}
+
+		if(mesh->hasNormals && memcmp(v + 3 + 2 * mesh->hasTexCoords, &parsed->normals[o->keys[k].a[2] - 1], sizeof(objgl_vec3))){
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+//splits the deduplicated faces into the o blocks and keeps one mesh per distinct block, the names stay in parsed->obj.strings
+objgl2Instances objgl_instance(const objgl2Parsed *parsed, const objobjects_internal *objects, float tolerance, const objgl2LoadOptions *options){
+	objgl2Stats *stats = options->stats;
+	const objgl2Data *obj = &parsed->obj;
+	const objfacevert *keys = (const objfacevert*)parsed->keys;
+	const objsegment_internal *segments = objects->segments;
+	uint_fast32_t numSegments = objects->numSegments, numObjects = objects->numObjects, numMaterials = obj->numMaterials;
+
+	//a segment ends where the next one of its material starts
+	objgl2Size *ends = (objgl2Size*)objgl_talloc(stats, sizeof(objgl2Size) * numSegments);
+	objgl2Size *next = (objgl2Size*)objgl_talloc(stats, sizeof(objgl2Size) * numMaterials);
+
+	for(uint_fast32_t m = 0; m < numMaterials; ++m){
+		next[m] = obj->materials[m].len;
+	}
+
+	for(uint_fast32_t s = numSegments; s--;){
+		ends[s] = next[segments[s].material];
+		next[segments[s].material] = segments[s].start;
+	}
+
+	//the segments of an object follow each other, the biggest object sizes the buffers
+	objgl_count maxIndices = 0;
+
+	for(uint_fast32_t s = 0; s < numSegments;){
+		objgl_count count = 0;
+
+		for(uint_fast32_t first = s; s < numSegments && segments[s].object == segments[first].object; ++s){
+			count += ends[s] - segments[s].start;
+		}
+
+		maxIndices = count > maxIndices ? count : maxIndices;
+	}
+
+	objinstobject_internal o;
+	o.keys = (objfacevert*)objgl_talloc(stats, sizeof(objfacevert) * maxIndices);
+	o.indices = (objgl2Index*)objgl_talloc(stats, sizeof(objgl2Index) * maxIndices);
+	o.materials = (uint_least32_t*)objgl_talloc(stats, sizeof(uint_least32_t) * numMaterials);
+	o.lens = (objgl2Size*)objgl_talloc(stats, sizeof(objgl2Size) * numMaterials);
+
+	//vertex of the object that a deduplicated one became, all ones if it's not used by the object
+	objgl2Index *local = (objgl2Index*)objgl_talloc(stats, sizeof(objgl2Index) * obj->numVertices);
+	memset(local, 0xFF, sizeof(objgl2Index) * obj->numVertices);
+
+	uint_least32_t *slots = (uint_least32_t*)objgl_talloc(stats, sizeof(uint_least32_t) * numMaterials);
+	memset(slots, 0xFF, sizeof(uint_least32_t) * numMaterials);
+
+	uint_fast32_t numBuckets = 1;
+	while(numBuckets < numObjects * 2){numBuckets += numBuckets;}
+
+	uint_least32_t *buckets = (uint_least32_t*)objgl_talloc(stats, sizeof(uint_least32_t) * numBuckets);
+	memset(buckets, 0xFF, sizeof(uint_least32_t) * numBuckets);
+
+	objinstmesh_internal *records = (objinstmesh_internal*)objgl_talloc(stats, sizeof(objinstmesh_internal) * numObjects);
+	uint_least32_t *meshMaterials = (uint_least32_t*)objgl_talloc(stats, sizeof(uint_least32_t) * numSegments);
+	uint_fast32_t numMeshMaterials = 0;
+
+	objgl2Instances result = (const objgl2Instances){0};
+	result.meshes = (objgl2Data*)objgl_talloc(stats, sizeof(objgl2Data) * numObjects);
+	result.instances = (objgl2Instance*)objgl_talloc(stats, sizeof(objgl2Instance) * numObjects);
+
+	for(uint_fast32_t s = 0; s < numSegments;){
+		uint_fast32_t first = s, object = segments[s].object;
+		while(s < numSegments && segments[s].object == object){++s;}
+
+		o.numKeys = o.numIndices = 0;
+		o.numMaterials = 0;
+
+		for(uint_fast32_t t = first; t < s; ++t){
+			if(ends[t] > segments[t].start && slots[segments[t].material] == OBJGL_NOTFOUND){
+				slots[segments[t].material] = (uint_least32_t)o.numMaterials;
+				o.materials[o.numMaterials++] = segments[t].material;
+			}
+		}
+
+		//the segments of a material are put together, like the materials of objgl2Data
+		for(uint_fast32_t i = 0; i < o.numMaterials; ++i){
+			const objgl2Index *src = obj->materials[o.materials[i]].indices;
+			objgl_count before = o.numIndices;
+
+			for(uint_fast32_t t = first; t < s; ++t){
+				if(segments[t].material != o.materials[i]){
+					continue;
+				}
+
+				for(objgl2Size j = segments[t].start; j < ends[t]; ++j){
+					objgl2Index v = src[j];
+
+					if(local[v] == (objgl2Index)-1){
+						local[v] = (objgl2Index)o.numKeys;
+						o.keys[o.numKeys++] = keys[v];
+					}
+
+					o.indices[o.numIndices++] = local[v];
+				}
+			}
+
+			o.lens[i] = (objgl2Size)(o.numIndices - before);
+			slots[o.materials[i]] = OBJGL_NOTFOUND;
+		}
+
+		for(uint_fast32_t t = first; t < s; ++t){
+			const objgl2Index *src = obj->materials[segments[t].material].indices;
+
+			for(objgl2Size j = segments[t].start; j < ends[t]; ++j){
+				local[src[j]] = (objgl2Index)-1;
+			}
+		}
+
+		//an o line without faces isn't an instance of anything
+		if(!o.numIndices){
+			continue;
+		}
+
+		uint_least64_t hash = objgl_instance_hash(&o, parsed);
+		uint_least32_t *bucket = &buckets[hash & (numBuckets - 1)];
+		uint_least32_t mesh = *bucket;
+
+		while(mesh != OBJGL_NOTFOUND && (records[mesh].hash != hash || !objgl_instance_match(&result.meshes[mesh], &meshMaterials[records[mesh].materials], &o, parsed, tolerance))){
+			mesh = records[mesh].next;
+		}
+
+		if(mesh == OBJGL_NOTFOUND){
+			mesh = result.numMeshes++;
+			records[mesh] = (const objinstmesh_internal){hash, *bucket, (uint_least32_t)numMeshMaterials};
+			*bucket = mesh;
+
+			objgl2Data *m = &result.meshes[mesh];
+			*m = (const objgl2Data){0};
+			m->vertSize = obj->vertSize;
+			m->hasNormals = obj->hasNormals;
+			m->hasTexCoords = obj->hasTexCoords;
+			m->numVertices = (objgl2Size)o.numKeys;
+			m->numIndices = (objgl2Size)o.numIndices;
+			m->numMaterials = (uint_least32_t)o.numMaterials;
+
+			m->data = (float*)objgl_talloc(stats, (size_t)obj->vertSize * o.numKeys);
+			objgl_assemble_keys(m->data, obj->vertSize, o.keys, 0, o.numKeys, parsed->positions, parsed->texcoords, parsed->normals, (char)obj->hasTexCoords, (char)obj->hasNormals);
+
+			m->indices = (objgl2Index*)objgl_talloc(stats, sizeof(objgl2Index) * o.numIndices);
+			memcpy(m->indices, o.indices, sizeof(objgl2Index) * o.numIndices);
+
+			m->materials = (objgl2Material*)objgl_talloc(stats, sizeof(objgl2Material) * o.numMaterials);
+
+			for(uint_fast32_t i = 0, k = 0; i < o.numMaterials; k += o.lens[i], ++i){
+				const objgl2Material *src = &obj->materials[o.materials[i]];
+				m->materials[i].indices = m->indices + k;
+				m->materials[i].len = o.lens[i];
+				m->materials[i].name = src->name;
+				m->materials[i].mtl = src->mtl;
+				meshMaterials[numMeshMaterials++] = o.materials[i];
+			}
+
+			objgl_bounds_compute(m);
+
+			if(options->bvh){
+				objgl_bvh_build(m, options->scheduler, stats);
+			}
+		}
+
+		objgl2Instance *instance = &result.instances[result.numInstances++];
+		const float *origin = parsed->positions[o.keys[0].a[0] - 1].a;
+
+		instance->mesh = mesh;
+		instance->name = objects->names[object] == OBJGL_NONAME ? NULL : &obj->strings[objects->names[object]];
+
+		for(uint_fast32_t c = 0; c < 3; ++c){
+			instance->translation[c] = (float)((double)origin[c] - result.meshes[mesh].data[c]);
+		}
+	}
+
+	objgl_tfree(stats, ends, sizeof(objgl2Size) * numSegments);
+	objgl_tfree(stats, next, sizeof(objgl2Size) * numMaterials);
+	objgl_tfree(stats, o.keys, sizeof(objfacevert) * maxIndices);
+	objgl_tfree(stats, o.indices, sizeof(objgl2Index) * maxIndices);
+	objgl_tfree(stats, o.materials, sizeof(uint_least32_t) * numMaterials);
+	objgl_tfree(stats, o.lens, sizeof(objgl2Size) * numMaterials);
+	objgl_tfree(stats, local, sizeof(objgl2Index) * obj->numVertices);
+	objgl_tfree(stats, slots, sizeof(uint_least32_t) * numMaterials);
+	objgl_tfree(stats, buckets, sizeof(uint_least32_t) * numBuckets);
+	objgl_tfree(stats, records, sizeof(objinstmesh_internal) * numObjects);
+	objgl_tfree(stats, meshMaterials, sizeof(uint_least32_t) * numSegments);
+
+	return result;
+}
+
+objgl2Instances objgl2_readobj_instanced(objgl2StreamInfo *strinfoptr, const objgl2LoadOptions *options, float tolerance){
+	objgl2LoadOptions parseOptions = options ? *options : (const objgl2LoadOptions){0};
+	objgl2Error error;
+
+	if(!parseOptions.error){
+		parseOptions.error = &error;
+	}
+
+	//the snapshots know nothing about the objects
+	parseOptions.snapshot = NULL;
+
+	objobjects_internal objects = (const objobjects_internal){0};
+	objgl2Parsed parsed = (const objgl2Parsed){{0}};
+	parsed.objects = &objects;
+	parsed.obj = objgl_readobj_scratch(strinfoptr, &parseOptions, NULL, &parsed, NULL);
+
+	objgl2Stats *stats = parseOptions.stats;
+	objgl2Instances instances = (const objgl2Instances){0};
+
+	if(parseOptions.error->code == OBJGL2_OK){
+		double start = stats ? objgl_now() : 0, bvhSeconds = stats ? stats->bvhSeconds : 0;
+
+		instances = objgl_instance(&parsed, &objects, tolerance, &parseOptions);
+		instances.strings = parsed.obj.strings;
+		parsed.obj.strings = NULL;
+
+		//the instancing assembles the meshes, their trees stay in bvhSeconds
+		if(stats){
+			stats->assemblySeconds = objgl_now() - start - (stats->bvhSeconds - bvhSeconds);
+		}
+	}
+
+	objgl_tfree(stats, objects.segments, sizeof(objsegment_internal) * objects.resSegments);
+	objgl_tfree(stats, objects.names, sizeof(uint_least32_t) * objects.resObjects);
+	objgl2_parsed_dropattributes(&parsed);
+	objgl2_deleteobj(&parsed.obj);
+
+	return instances;
+}
+
+void objgl2_deleteinstances(objgl2Instances *instances){
+	for(uint_fast32_t i = 0; i < instances->numMeshes; ++i){
+		objgl2_deleteobj(&instances->meshes[i]);
+	}
+
+	objgl_free(instances->meshes);
+	objgl_free(instances->instances);
+	objgl_free(instances->strings);
+
+	*instances = (const objgl2Instances){0};
+}
+
+struct __ObjGL2Parser{
+	objparser_internal state;
+	objgl2LoadOptions options;
+	char *path;
+	char *line; //the unfinished line at the end of the last feed
+	uint_fast32_t lineLen, lineRes;
+	uint_least64_t bytesFed, feeds;
+	double parseTime; //only the time spent in the feeds, not the waiting between them
+	char cancelled;
+};
+
+void objgl_parser_append(objgl2Parser *parser, const char *bytes, uint_fast32_t len){
+	if(parser->lineLen + len > parser->lineRes){
+		parser->lineRes += parser->lineRes + len + 64;
+		parser->line = (char*)objgl_realloc(parser->line, parser->lineRes);
+	}
+
+	if(len){
+		memcpy(parser->line + parser->lineLen, bytes, len);
+	}
+
+	parser->lineLen += len;
+}
+
+objgl2Parser* objgl2_parser_create(const char *path, const objgl2LoadOptions *options){
+	objgl2Parser *parser = (objgl2Parser*)objgl_alloc(sizeof(objgl2Parser));
+	parser->options = options ? *options : (const objgl2LoadOptions){0};
+	parser->path = NULL;
+	parser->line = NULL;
+	parser->lineLen = parser->lineRes = 0;
+	parser->bytesFed = parser->feeds = 0;
+	parser->parseTime = 0;
+	parser->cancelled = 0;
+
+	if(path){
+		uint_fast32_t len = 0;
+		while(path[len]){++len;}
+
+		parser->path = (char*)objgl_alloc(len + 1);
+		memcpy(parser->path, path, len + 1);
+	}
+
+	objgl_parser_begin(&parser->state, &parser->options, NULL, parser->path);
+
+	return parser;
+}
+
+char objgl2_parser_feed(objgl2Parser *parser, const char *bytes, uint_least32_t len){
+	objparser_internal *p = &parser->state;
+
+	if(p->stop || parser->cancelled){
+		return 1;
+	}
+
+	double startTime = p->stats ? objgl_now() : 0;
+	parser->bytesFed += len;
+	++parser->feeds;
+
+	//the unfinished line is completed first
+	if(parser->lineLen){
+		const char *newline = (const char*)memchr(bytes, '\n', len);
+		uint_fast32_t n = newline ? (uint_fast32_t)(newline - bytes) + 1 : len;
+
+		objgl_parser_append(parser, bytes, n);
+		bytes += n;
+		len -= n;
+
+		if(newline){
+			objgl_parser_lines(p, parser->line, 0, parser->lineLen);
+			parser->lineLen = 0;
+		}
+	}
+
+	//the whole lines are parsed where they are, only the last unfinished one is copied
+	uint_fast32_t end = len;
+	while(end && bytes[end - 1] != '\n'){--end;}
+
+	if(end && !p->stop){
+		objgl_parser_lines(p, (char*)bytes, 0, end);
+	}
+
+	if(!p->stop){
+		objgl_parser_append(parser, bytes + end, len - end);
+	}
+
+	if(!p->stop && parser->options.snapshot && parser->bytesFed >= p->snap.next){
+		objgl_snapshot(&p->snap, &p->parse, &parser->options, p->stats, parser->bytesFed);
+	}
+
+	if(p->stats){
+		parser->parseTime += objgl_now() - startTime;
+	}
+
+	if(!p->stop && parser->options.progress && parser->options.progress(parser->options.userdata, parser->bytesFed, 0)){
+		parser->cancelled = 1;
+	}
+
+	return p->stop || parser->cancelled;
+}
+
+objgl2Data objgl2_parser_finish(objgl2Parser *parser){
+	objparser_internal *p = &parser->state;
+	double startTime = p->stats ? objgl_now() : 0;
+
+	//the last line doesn't have to end with a newline
+	if(parser->lineLen && !p->stop && !parser->cancelled){
+		objgl_parser_append(parser, "\n", 1);
+		objgl_parser_lines(p, parser->line, 0, parser->lineLen);
+	}
+
+	//the last chance to cancel, dedup and assembly are not interrupted
+	if(!parser->cancelled && parser->options.progress){
+		parser->cancelled = parser->options.progress(parser->options.userdata, parser->bytesFed, 0);
+	}
+
+	if(p->stats){
+		p->stats->parseSeconds = parser->parseTime + objgl_now() - startTime;
+		p->stats->bytesRead = parser->bytesFed;
+		p->stats->refills = parser->feeds;
+	}
+
+	objgl2Data obj = objgl_parser_result(p, parser->cancelled ? OBJGL2_ECANCELLED : OBJGL2_OK, NULL);
+
+	objgl_free(parser->line);
+	objgl_free(parser->path);
+	objgl_free(parser);
+
+	return obj;
+}
+
+void objgl2_parser_delete(objgl2Parser *parser){
+	if(!parser){
+		return;
+	}
+
+	parser->options.error = NULL;
+	objgl_parser_result(&parser->state, OBJGL2_ECANCELLED, NULL);
+
+	objgl_free(parser->line);
+	objgl_free(parser->path);
+	objgl_free(parser);
+}
+
+#ifdef OBJGL_FSTREAM_IMPL
+#if OBJGL_FSTREAM_IMPL
+//a line ends a chunk if the hash of its last bytes has these bits clear, one line in 8192, ~256KB of typical 30 byte lines
+#define OBJGL_RELOAD_MASK 8191
+#define OBJGL_RELOAD_MINCHUNK (16 << 10)
+#define OBJGL_RELOAD_MAXCHUNK (4 << 20)
+
+typedef struct{
+	uint_least32_t type; //'u' usemtl, 'o' object, 'm' mtllib, '\0' end of the data
+	uint_least32_t name, nameLen; //in the chunk's name pool
+	uint_least32_t numPositions, numTexcoords, numNormals, numVerts; //the chunk's counts when the line was read
+} objreloadevent_internal;
+
+//a line-aligned piece of the file and what it parsed to
+typedef struct{
+	uint_least64_t hash, begin, len;
+	objgl_vec3 *positions, *normals;
+	objgl_vec2 *texcoords;
+	objinfo_internal info;
+	objfacevert *verts; //triangulated like the parser does it
+	unsigned char *relative; //bit n is set if component n of the vert is relative to the chunk's counts (a negative index)
+	uint_fast32_t numVerts, resVerts;
+	objreloadevent_internal *events;
+	uint_fast32_t numEvents, resEvents;
+	objstrpool_internal names;
+	//OBJGL2_VALIDATE: the first face the chunk rejects on its own, and what its faces need from the chunks before
+	const char *invalid;
+	objgl_pos invalidPos; //where that face's line starts in the chunk
+	uint_fast32_t invalidEvent; //the events before it
+	objgl_count reach[3]; //positions, texcoords and normals
+	char reused; //taken over by the next version of the file
+} objchunk_internal;
+
+struct __ObjGL2Reloader{
+	char *path;
+	objgl2LoadOptions options;
+	uint_least64_t size;
+	int_least64_t mtime, mtimeNsec;
+	objchunk_internal *chunks;
+	uint_fast32_t numChunks;
+	objgl2Parsed *parsed; //obj.data is assembled by the reloader
+	objgl2Size dirtyBegin, dirtyEnd;
+	char *file; //kept between the updates, reading into memory that's already mapped is several times faster
+	uint_least64_t resFile;
+	char stale; //the chunks are of a version that failed to load, they don't describe parsed
+};
+
+//four independent lanes, so the multiplies of consecutive words overlap
+uint_least64_t objgl_hashbytes64(const char *data, uint_least64_t len){
+	uint_least64_t lanes[4] = {14695981039346656037UL ^ len, 0x9E3779B97F4A7C15UL, 0xC2B2AE3D27D4EB4FUL, 0x165667B19E3779F9UL};
+
+	for(; len >= 32; len -= 32, data += 32){
+		for(uint_fast32_t i = 0; i < 4; ++i){
+			uint_least64_t word;
+			memcpy(&word, data + i * 8, 8);
+			lanes[i] = (lanes[i] ^ word) * 0x9E3779B97F4A7C15UL;
+			lanes[i] ^= lanes[i] >> 29;
+		}
+	}
+
+	uint_least64_t hash = lanes[0];
+
+	for(uint_fast32_t i = 1; i < 4; ++i){
+		hash = (hash ^ lanes[i]) * 0x9E3779B97F4A7C15UL;
+		hash ^= hash >> 29;
+	}
+
+	for(; len; --len, ++data){
+		hash = (hash ^ (unsigned char)*data) * 1099511628211UL;
+	}
+
+	return hash ^ (hash >> 32);
+}
+
+void objgl_chunk_delete(objchunk_internal *chunk){
+	objgl_free(chunk->positions);
+	objgl_free(chunk->normals);
+	objgl_free(chunk->texcoords);
+	objgl_free(chunk->verts);
+	objgl_free(chunk->relative);
+	objgl_free(chunk->events);
+	objgl_free(chunk->names.data);
+}
+
+void objgl_chunk_event(objchunk_internal *chunk, uint_least32_t type, const char *name, uint_least32_t len){
+	if(chunk->numEvents >= chunk->resEvents){
+		chunk->resEvents += chunk->resEvents + 4;
+		chunk->events = (objreloadevent_internal*)objgl_realloc(chunk->events, sizeof(objreloadevent_internal) * chunk->resEvents);
+	}
+
+	objreloadevent_internal *e = &chunk->events[chunk->numEvents++];
+	e->type = type;
+	e->name = len ? objgl_strpool_add(&chunk->names, name, len, NULL) : 0;
+	e->nameLen = len;
+	e->numPositions = chunk->info.numPositions;
+	e->numTexcoords = chunk->info.numTexcoords;
+	e->numNormals = chunk->info.numNormals;
+	e->numVerts = chunk->numVerts;
+}
+
+//negative indices count back from the chunk's attributes read so far, the merge adds the attributes of the chunks before
+objfacevert objgl_chunk_vert(objfacevert vert, const objinfo_internal *info, unsigned char *relative){
+	const objgl_count counts[3] = {info->numPositions, info->numTexcoords, info->numNormals};
+	*relative = 0;
+
+	for(uint_fast32_t c = 0; c < 3; ++c){
+		if((objgl_sindex)vert.a[c] < 0){
+			vert.a[c] = (objgl2Index)((objgl_sindex)counts[c] + (objgl_sindex)vert.a[c] + 1);
+			*relative |= 1 << c;
+		}
+	}
+
+	return vert;
+}
+
+//only the first rejected face of a chunk is kept, the merge fails on the first one that's loaded
+void objgl_chunk_invalid(objchunk_internal *chunk, const char *reason, objgl_pos pos){
+	if(!chunk->invalid){
+		chunk->invalid = reason;
+		chunk->invalidPos = pos;
+		chunk->invalidEvent = chunk->numEvents;
+	}
+}
+
+//objgl_checkface for a chunk that doesn't know what's before it. The attributes a face needs from the chunks before go to reach,
+//prefix is what they have and fails the face right away, NULL if not known yet
+const char* objgl_chunk_checkface(objchunk_internal *chunk, const objfacevert *verts, uint_fast32_t num, const objgl_count *prefix){
+	const objgl_count counts[3] = {chunk->info.numPositions, chunk->info.numTexcoords, chunk->info.numNormals};
+
+	for(uint_fast32_t c = 0; c < 3; ++c){
+		if(c && !verts[0].a[c]){
+			continue;
+		}
+
+		for(uint_fast32_t i = 0; i < num; ++i){
+			objgl_sindex index = (objgl_sindex)verts[i].a[c];
+
+			if(!index){
+				return objgl_badindex[c];
+			}
+
+			//a negative index needs as many attributes as it counts back, a positive one as far as it points
+			objgl_count distance = index < 0 ? (objgl_count)0 - (objgl_count)index : (objgl_count)index;
+			objgl_count need = distance > counts[c] ? distance - counts[c] : 0;
+
+			if(prefix && need > prefix[c]){
+				return objgl_badindex[c];
+			}
+
+			chunk->reach[c] = need > chunk->reach[c] ? need : chunk->reach[c];
+		}
+	}
+
+	return NULL;
+}
+
+//the same line handling as objgl_readobj_scratch, but the state changes are recorded as events for the merge.
+//prefix is passed to objgl_chunk_checkface, NULL unless the chunk is parsed again to find the face OBJGL2_VALIDATE rejects
+void objgl_chunk_parse(objchunk_internal *chunk, char *data, unsigned int flags, const objgl_count *prefix){
+	objgl_pos pos = 0, len = chunk->len;
+	char validate = (flags & OBJGL2_VALIDATE) != 0;
+	objgl2Index keepTexcoords = flags & OBJGL2_SKIP_TEXCOORDS ? 0 : (objgl2Index)-1, keepNormals = flags & OBJGL2_SKIP_NORMALS ? 0 : (objgl2Index)-1;
+	objcache_internal cache = {(objfacevert*)objgl_alloc(sizeof(objfacevert) * 32), 32};
+	chunk->info = (const objinfo_internal){0, 0, 0, 64, 64, 64};
+	chunk->positions = (objgl_vec3*)objgl_alloc(sizeof(objgl_vec3) * chunk->info.resPositions);
+	chunk->normals = (objgl_vec3*)objgl_alloc(sizeof(objgl_vec3) * chunk->info.resNormals);
+	chunk->texcoords = (objgl_vec2*)objgl_alloc(sizeof(objgl_vec2) * chunk->info.resTexcoords);
+
+	while(pos < len){
+		switch(data[pos]){
+		case 'v':{
+			++pos;
+			unsigned int mode = data[pos] == 'n' ? 1 : data[pos] == 't' ? 2 : 0;
+			pos += mode != 0;
+
+			if((mode == 1 && !keepNormals) || (mode == 2 && !keepTexcoords)){
+				while(data[pos] != '\n' && data[pos] != '\0'){++pos;}
+				pos += data[pos] == '\n';
+				break;
+			}
+
+			objgl_vec4 vec = objgl_parsevector(data, &pos);
+			objinfo_internal *info = &chunk->info;
+
+			switch(mode){
+			case 0:
+				if(info->numPositions >= info->resPositions){
+					info->resPositions += info->resPositions;
+					chunk->positions = (objgl_vec3*)objgl_realloc(chunk->positions, sizeof(objgl_vec3) * info->resPositions);
+				}
+
+				memcpy(&chunk->positions[info->numPositions++], vec.a, sizeof(objgl_vec3));
+				break;
+			case 1:
+				if(info->numNormals >= info->resNormals){
+					info->resNormals += info->resNormals;
+					chunk->normals = (objgl_vec3*)objgl_realloc(chunk->normals, sizeof(objgl_vec3) * info->resNormals);
+				}
+
+				memcpy(&chunk->normals[info->numNormals++], vec.a, sizeof(objgl_vec3));
+				break;
+			case 2:
+				if(info->numTexcoords >= info->resTexcoords){
+					info->resTexcoords += info->resTexcoords;
+					chunk->texcoords = (objgl_vec2*)objgl_realloc(chunk->texcoords, sizeof(objgl_vec2) * info->resTexcoords);
+				}
+
+				memcpy(&chunk->texcoords[info->numTexcoords++], vec.a, sizeof(objgl_vec2));
+				break;
+			}
+			break;
+		}
+		case 'o':{
+			objgl_pos temp = pos + 1;
+			while(data[temp] == ' '){++temp;}
+
+			objgl_chunk_event(chunk, 'o', &data[temp], objgl_strlen(&data[temp]));
+
+			while(data[pos] != '\n' && data[pos] != '\0'){++pos;}
+			pos += data[pos] == '\n';
+			break;
+		}
+		case 'u':{
+			if(objgl_iskeyword(&data[pos], "usemtl")){
+				pos += 6;
+				while(data[pos] == ' '){++pos;}
+
+				objgl_chunk_event(chunk, 'u', &data[pos], objgl_strlen(&data[pos]));
+			}
+
+			while(data[pos] != '\n' && data[pos] != '\0'){++pos;}
+			pos += data[pos] == '\n';
+			break;
+		}
+		case 'm':{
+			if(objgl_iskeyword(&data[pos], "mtllib")){
+				pos += 6;
+
+				while(1){
+					while(data[pos] == ' ' || data[pos] == '\t'){++pos;}
+
+					uint_least32_t libnamelen = objgl_strlen(&data[pos]);
+
+					if(!libnamelen){
+						break;
+					}
+
+					objgl_chunk_event(chunk, 'm', &data[pos], libnamelen);
+					pos += libnamelen;
+				}
+			}
+
+			while(data[pos] != '\n' && data[pos] != '\0'){++pos;}
+			pos += data[pos] == '\n';
+			break;
+		}
+		case 'f':{
+			objgl_pos lineStart = pos++;
+
+			uint_fast32_t numindices = objgl_parseindices(data, &pos, &cache, NULL, NULL);
+			pos += data[pos] == '\n';
+
+			//without OBJGL2_VALIDATE a broken face is dropped, the reload has no error to fail with
+			if(numindices < 3){
+				if(validate){
+					objgl_chunk_invalid(chunk, numindices ? "a face with less than 3 vertices" : "a face line with something else than indices", lineStart);
+				}
+				break;
+			}
+
+			uint_fast32_t tris = numindices - 2;
+
+			if(!keepTexcoords || !keepNormals){
+				objgl_keepcomponents(cache.cache, numindices, keepTexcoords, keepNormals);
+			}
+
+			if(validate){
+				const char *reason = objgl_chunk_checkface(chunk, cache.cache, numindices, prefix);
+
+				if(reason){
+					objgl_chunk_invalid(chunk, reason, lineStart);
+					break;
+				}
+			}
+
+			if(chunk->numVerts + tris * 3 > chunk->resVerts){
+				chunk->resVerts += chunk->resVerts + tris * 3 + 64;
+				chunk->verts = (objfacevert*)objgl_realloc(chunk->verts, sizeof(objfacevert) * chunk->resVerts);
+				chunk->relative = (unsigned char*)objgl_realloc(chunk->relative, chunk->resVerts);
+			}
+
+			for(uint_fast32_t i = 0, j = 1; i < tris; ++i, ++j){
+				uint_fast32_t v = chunk->numVerts;
+				chunk->verts[v] = objgl_chunk_vert(cache.cache[0], &chunk->info, &chunk->relative[v]);
+				chunk->verts[v + 1] = objgl_chunk_vert(cache.cache[j], &chunk->info, &chunk->relative[v + 1]);
+				chunk->verts[v + 2] = objgl_chunk_vert(cache.cache[j + 1], &chunk->info, &chunk->relative[v + 2]);
+				chunk->numVerts += 3;
+			}
+			break;
+		}
+		case '\0':
+			objgl_chunk_event(chunk, '\0', NULL, 0);
+			pos = len;
+			break;
+		default:
+			while(data[pos] != '\n' && data[pos] != '\0'){++pos;}
+			pos += data[pos] == '\n';
+			break;
+		}
+	}
+
+	objgl_free(cache.cache);
+}
+
+char objgl_chunk_sameshape(const objchunk_internal *a, const objchunk_internal *b){
+	return a->info.numPositions == b->info.numPositions && a->info.numTexcoords == b->info.numTexcoords && a->info.numNormals == b->info.numNormals &&
+		a->numVerts == b->numVerts && a->numEvents == b->numEvents && a->names.len == b->names.len &&
+		(!a->numVerts || (!memcmp(a->verts, b->verts, sizeof(objfacevert) * a->numVerts) && !memcmp(a->relative, b->relative, a->numVerts))) &&
+		(!a->numEvents || !memcmp(a->events, b->events, sizeof(objreloadevent_internal) * a->numEvents)) &&
+		(!a->names.len || !memcmp(a->names.data, b->names.data, a->names.len)) &&
+		a->invalid == b->invalid && !memcmp(a->reach, b->reach, sizeof(a->reach)); //and OBJGL2_VALIDATE says the same about them
+}
+
+char objgl_chunk_eq(const void *ctx, uint_least32_t index, const char *str, uint_fast32_t len){
+	const objchunk_internal *chunk = &((const objchunk_internal*)ctx)[index];
+	uint_least64_t hash;
+	memcpy(&hash, str, sizeof(hash));
+
+	return !chunk->reused && chunk->hash == hash && chunk->len == len;
+}
+
+typedef struct{
+	objchunk_internal *chunks;
+	char *data;
+	const uint_least32_t *todo;
+	unsigned int flags;
+} objchunktasks_internal;
+
+void objgl_chunk_task(void *ctx, uint_least32_t index){
+	const objchunktasks_internal *t = (const objchunktasks_internal*)ctx;
+	objchunk_internal *chunk = &t->chunks[t->todo[index]];
+
+	objgl_chunk_parse(chunk, t->data + chunk->begin, t->flags, NULL);
+}
+
+void objgl_chunkhash_task(void *ctx, uint_least32_t index){
+	const objchunktasks_internal *t = (const objchunktasks_internal*)ctx;
+	objchunk_internal *chunk = &t->chunks[index];
+
+	chunk->hash = objgl_hashbytes64(t->data + chunk->begin, chunk->len);
+}
+
+void objgl_material_push(objmaterial_internal *mat, objfacevert vert){
+	if(mat->numIndices >= mat->resIndices){
+		mat->resIndices += mat->resIndices;
+		mat->indices = (objfacevert*)objgl_realloc(mat->indices, sizeof(objfacevert) * mat->resIndices);
+	}
+
+	mat->indices[mat->numIndices++] = vert;
+}
+
+//replays the chunks in the order of the file, so the result is what the parser would read from all of it.
+//Returns why OBJGL2_VALIDATE rejects a face that's loaded and sets its line, the merge stops there, NULL if every face is fine
+const char* objgl_reload_merge(objgl2Reloader *r, objparse_internal *parse, uint_least64_t *line){
+	objinfo_internal total = (const objinfo_internal){0};
+
+	for(uint_fast32_t i = 0; i < r->numChunks; ++i){
+		total.numPositions += r->chunks[i].info.numPositions;
+		total.numTexcoords += r->chunks[i].info.numTexcoords;
+		total.numNormals += r->chunks[i].info.numNormals;
+	}
+
+	*parse = (const objparse_internal){{{0}}};
+	parse->positions = (objgl_vec3*)objgl_alloc(sizeof(objgl_vec3) * (total.numPositions + 1));
+	parse->texcoords = (objgl_vec2*)objgl_alloc(sizeof(objgl_vec2) * (total.numTexcoords + 1));
+	parse->normals = (objgl_vec3*)objgl_alloc(sizeof(objgl_vec3) * (total.numNormals + 1));
+	parse->hasNormals = !(r->options.flags & OBJGL2_SKIP_NORMALS);
+	parse->hasTextures = !(r->options.flags & OBJGL2_SKIP_TEXCOORDS);
+	objgl_matstate_init(&parse->mat, (objmaterial_internal*)objgl_alloc(sizeof(objmaterial_internal) * 64), 64, NULL);
+
+	objinfo_internal *info = &parse->info;
+	uint_fast32_t nameLen = 0, objDirLen = objgl_dirlen(r->path);
+	char stop = 0;
+	const char *invalid = NULL;
+
+	for(uint_fast32_t i = 0; i < r->numChunks && !stop; ++i){
+		const objchunk_internal *chunk = &r->chunks[i];
+		const objgl_count prefix[3] = {info->numPositions, info->numTexcoords, info->numNormals};
+		objreloadevent_internal end = (const objreloadevent_internal){0};
+		end.numPositions = chunk->info.numPositions;
+		end.numTexcoords = chunk->info.numTexcoords;
+		end.numNormals = chunk->info.numNormals;
+		end.numVerts = chunk->numVerts;
+
+		//the chunk doesn't know which face is the first bad one once the attributes before it are counted, it's parsed again to find it
+		objchunk_internal exact = (const objchunk_internal){0};
+
+		if(chunk->invalid || chunk->reach[0] > prefix[0] || chunk->reach[1] > prefix[1] || chunk->reach[2] > prefix[2]){
+			exact.len = chunk->len;
+			objgl_chunk_parse(&exact, r->file + chunk->begin, r->options.flags, prefix);
+		}
+
+		for(uint_fast32_t e = 0, v = 0; e <= chunk->numEvents && !stop; ++e){
+			const objreloadevent_internal *event = e < chunk->numEvents ? &chunk->events[e] : &end;
+			const char *name = chunk->names.data ? &chunk->names.data[event->name] : "";
+
+			//the face is before this event and no object ended the load yet
+			if(exact.invalid && exact.invalidEvent == e){
+				invalid = exact.invalid;
+				*line = 1;
+
+				for(const char *c = r->file, *face = r->file + chunk->begin + exact.invalidPos; (c = (const char*)memchr(c, '\n', (size_t)(face - c))); ++c){
+					++*line;
+				}
+
+				stop = 1;
+				break;
+			}
+
+			for(; v < event->numVerts; ++v){
+				objfacevert vert = chunk->verts[v];
+
+				for(uint_fast32_t c = 0; c < 3; ++c){
+					if(chunk->relative[v] & (1 << c)){
+						vert.a[c] = (objgl2Index)((objgl_sindex)prefix[c] + (objgl_sindex)vert.a[c]);
+					}
+				}
+
+				if(v % 3 == 0){
+					parse->hasNormals = parse->hasNormals && vert.a[2];
+					parse->hasTextures = parse->hasTextures && vert.a[1];
+				}
+
+				objgl_material_push(&parse->mat.cur, vert);
+				++parse->numIndices;
+			}
+
+			info->numPositions = prefix[0] + event->numPositions;
+			info->numTexcoords = prefix[1] + event->numTexcoords;
+			info->numNormals = prefix[2] + event->numNormals;
+
+			if(event == &end){
+				break;
+			}
+
+			switch(event->type){
+			case 'u':
+				objgl_usemtl(&parse->mat, name, event->nameLen, NULL, NULL);
+				break;
+			case 'o':
+				if(!parse->name){
+					nameLen = event->nameLen;
+					parse->name = (char*)objgl_alloc(nameLen + 1);
+					memcpy(parse->name, name, nameLen);
+					parse->name[nameLen] = '\0';
+				} else{
+					//the parser's objgl_strcmp, a second object stops the load unless it starts with the first one's name
+					stop = event->nameLen < nameLen || !objgl_strneq(name, parse->name, nameLen);
+				}
+				break;
+			case 'm':
+				if(r->options.mtldb){
+					uint_fast32_t pathlen;
+					char *path = objgl_joinpath(r->path, objDirLen, name, event->nameLen, &pathlen);
+					objgl_mutex_lock(&r->options.mtldb->lock);
+					uint_least32_t lib = objgl_mtldb_library(r->options.mtldb, path, pathlen, NULL);
+					objgl_mutex_unlock(&r->options.mtldb->lock);
+
+					objmtlrefs_internal *refs = &parse->mtlRefs;
+
+					if(refs->numLibraries >= refs->resLibraries){
+						refs->resLibraries += refs->resLibraries + 4;
+						refs->libraries = (uint_least32_t*)objgl_realloc(refs->libraries, sizeof(uint_least32_t) * refs->resLibraries);
+					}
+
+					refs->libraries[refs->numLibraries++] = lib;
+				}
+				break;
+			default:
+				stop = 1;
+				break;
+			}
+		}
+
+		objgl_chunk_delete(&exact);
+
+		memcpy(&parse->positions[prefix[0]], chunk->positions, sizeof(objgl_vec3) * (info->numPositions - prefix[0]));
+		memcpy(&parse->texcoords[prefix[1]], chunk->texcoords, sizeof(objgl_vec2) * (info->numTexcoords - prefix[1]));
+		memcpy(&parse->normals[prefix[2]], chunk->normals, sizeof(objgl_vec3) * (info->numNormals - prefix[2]));
+	}
+
+	parse->mat.list[parse->mat.index] = parse->mat.cur;
+	objgl_free(parse->mat.table.slots);
+	parse->mat.table = (const objstrtable_internal){0};
+
+	return invalid;
+}
+
+//frees a merge that isn't built
+void objgl_reload_drop(objparse_internal *parse){
+	for(uint_fast32_t i = 0; i < parse->mat.num; ++i){
+		objgl_free(parse->mat.list[i].indices);
+	}
+
+	objgl_free(parse->mat.list);
+	objgl_free(parse->mat.names.data);
+	objgl_free(parse->mtlRefs.libraries);
+	objgl_free(parse->name);
+	objgl_free(parse->positions);
+	objgl_free(parse->texcoords);
+	objgl_free(parse->normals);
+}
+
+int objgl_reload_fail(objgl2Reloader *r, int code, const char *message){
+	if(r->options.error){
+		*r->options.error = (const objgl2Error){code, message};
+	}
+
+	return OBJGL2_RELOAD_FAILED;
+}
+
+int objgl2_reloader_update(objgl2Reloader *r){
+	if(r->options.error){
+		*r->options.error = (const objgl2Error){OBJGL2_OK, NULL};
+	}
+
+	struct stat st;
+
+	if(stat(r->path, &st)){
+		return objgl_reload_fail(r, OBJGL2_EIO, "can't stat the file");
+	}
+
+	int_least64_t mtimeNsec = 0;
+#ifdef __linux__
+	mtimeNsec = st.st_mtim.tv_nsec;
+#endif
+
+	if(r->parsed && (uint_least64_t)st.st_size == r->size && (int_least64_t)st.st_mtime == r->mtime && mtimeNsec == r->mtimeNsec){
+		return OBJGL2_RELOAD_UNCHANGED;
+	}
+
+	FILE *f = fopen(r->path, "rb");
+
+	if(!f){
+		return objgl_reload_fail(r, OBJGL2_EIO, "can't open the file");
+	}
+
+	long size = fseek(f, 0, SEEK_END) ? -1 : ftell(f);
+
+	if(size < 0 || fseek(f, 0, SEEK_SET)){
+		fclose(f);
+		return objgl_reload_fail(r, OBJGL2_EIO, "can't read the file");
+	}
+
+	if((uint_least64_t)size + 2 > r->resFile){
+		objgl_free(r->file);
+		r->resFile = (uint_least64_t)size + 2;
+		r->file = (char*)objgl_alloc(r->resFile);
+	}
+
+	char *data = r->file;
+	uint_least64_t len = fread(data, 1, (size_t)size, f);
+	fclose(f);
+
+	if(len != (uint_least64_t)size){
+		return objgl_reload_fail(r, OBJGL2_EIO, "can't read the file");
+	}
+
+	//the last line is terminated like the others
+	if(!len || data[len - 1] != '\n'){
+		data[len++] = '\n';
+	}
+
+	data[len] = '\0';
+
+	r->size = (uint_least64_t)st.st_size;
+	r->mtime = (int_least64_t)st.st_mtime;
+	r->mtimeNsec = mtimeNsec;
+
+	//old chunks by their content, the unchanged ones are taken over as they are
+	objstrtable_internal table = (const objstrtable_internal){0};
+
+	for(uint_fast32_t i = 0; i < r->numChunks; ++i){
+		objgl_strtable_insert(&table, (uint_least32_t)r->chunks[i].hash, i, NULL);
+	}
+
+	uint_fast32_t numChunks = 0, resChunks = 16, numTodo = 0;
+	objchunk_internal *chunks = (objchunk_internal*)objgl_alloc(sizeof(objchunk_internal) * resChunks);
+
+	for(uint_least64_t begin = 0, pos = 0; pos < len;){
+		//the lines ending before the minimum can't end the chunk
+		uint_least64_t from = pos - begin < OBJGL_RELOAD_MINCHUNK - 1 && begin + OBJGL_RELOAD_MINCHUNK - 1 < len ? begin + OBJGL_RELOAD_MINCHUNK - 1 : pos;
+		const char *newline = (const char*)memchr(&data[from], '\n', len - from);
+		pos = newline ? (uint_least64_t)(newline - data) + 1 : len;
+
+		uint_least64_t tail = 0;
+		memcpy(&tail, &data[pos - begin > 8 ? pos - 8 : begin], pos - begin > 8 ? 8 : pos - begin);
+		tail *= 0x9E3779B97F4A7C15UL;
+
+		if(pos < len && pos - begin < OBJGL_RELOAD_MAXCHUNK && (pos - begin < OBJGL_RELOAD_MINCHUNK || ((tail >> 40) & OBJGL_RELOAD_MASK))){
+			continue;
+		}
+
+		if(numChunks >= resChunks){
+			resChunks += resChunks;
+			chunks = (objchunk_internal*)objgl_realloc(chunks, sizeof(objchunk_internal) * resChunks);
+		}
+
+		chunks[numChunks] = (const objchunk_internal){0};
+		chunks[numChunks].begin = begin;
+		chunks[numChunks].len = pos - begin;
+		++numChunks;
+		begin = pos;
+	}
+
+	uint_least32_t *todo = (uint_least32_t*)objgl_alloc(sizeof(uint_least32_t) * (numChunks + 1));
+	objchunktasks_internal tasks = {chunks, data, todo, r->options.flags};
+	const objgl2Scheduler *scheduler = r->options.scheduler;
+
+	if(scheduler && numChunks > 1){
+		scheduler->wait(scheduler->userdata, scheduler->submit(scheduler->userdata, objgl_chunkhash_task, &tasks, numChunks));
+	} else{
+		for(uint_fast32_t i = 0; i < numChunks; ++i){
+			objgl_chunkhash_task(&tasks, i);
+		}
+	}
+
+	for(uint_fast32_t i = 0; i < numChunks; ++i){
+		uint_least32_t found = objgl_strtable_find(&table, (uint_least32_t)chunks[i].hash, (const char*)&chunks[i].hash, chunks[i].len, objgl_chunk_eq, r->chunks);
+
+		if(found != OBJGL_NOTFOUND){
+			uint_least64_t begin = chunks[i].begin;
+			r->chunks[found].reused = 1;
+			chunks[i] = r->chunks[found];
+			chunks[i].begin = begin;
+			chunks[i].reused = 0;
+		} else{
+			todo[numTodo++] = i;
+		}
+	}
+
+	objgl_free(table.slots);
+
+	if(scheduler && numTodo > 1){
+		scheduler->wait(scheduler->userdata, scheduler->submit(scheduler->userdata, objgl_chunk_task, &tasks, numTodo));
+	} else{
+		for(uint_fast32_t i = 0; i < numTodo; ++i){
+			objgl_chunk_task(&tasks, i);
+		}
+	}
+
+	objgl_free(todo);
+
+	//the same faces and events in the same places, only the attribute values may differ
+	char patch = r->parsed && !r->stale && numChunks == r->numChunks;
+
+	for(uint_fast32_t i = 0; i < numChunks && patch; ++i){
+		patch = chunks[i].hash == r->chunks[i].hash || objgl_chunk_sameshape(&chunks[i], &r->chunks[i]);
+	}
+
+	int result = OBJGL2_RELOAD_UNCHANGED;
+	r->dirtyBegin = r->dirtyEnd = 0;
+
+	if(patch){
+		objgl2Parsed *parsed = r->parsed;
+		const objgl2Index counts[3] = {parsed->numPositions, parsed->numTexcoords, parsed->numNormals};
+		unsigned char *dirty[3];
+		char anyDirty = 0;
+
+		for(uint_fast32_t c = 0; c < 3; ++c){
+			dirty[c] = (unsigned char*)objgl_calloc(counts[c] + 1, 1);
+		}
 
-					normals[info.numNormals++] = *((objgl_vec3*)&vec);
-					break;
-				case 2:
-					if(info.numTexcoords >= info.resTexcoords){
-						uint_fast32_t oldsize = info.resTexcoords;
-						info.resTexcoords += info.resTexcoords;
-						texcoords = (objgl_vec2*)objgl_realloc(texcoords, sizeof(objgl_vec2) * info.resTexcoords, sizeof(objgl_vec2) * oldsize);
+		for(objgl_count i = 0, p = 0, t = 0, n = 0; i < numChunks; ++i){
+			const objchunk_internal *chunk = &chunks[i];
+
+			if(chunk->hash != r->chunks[i].hash){
+				for(uint_fast32_t k = 0; k < chunk->info.numPositions && p + k < counts[0]; ++k){
+					if(memcmp(&parsed->positions[p + k], &chunk->positions[k], sizeof(objgl_vec3))){
+						parsed->positions[p + k] = chunk->positions[k];
+						dirty[0][p + k] = anyDirty = 1;
 					}
+				}
 
-					texcoords[info.numTexcoords++] = *((objgl_vec2*)&vec);
-					break;
+				for(uint_fast32_t k = 0; k < chunk->info.numTexcoords && t + k < counts[1]; ++k){
+					if(memcmp(&parsed->texcoords[t + k], &chunk->texcoords[k], sizeof(objgl_vec2))){
+						parsed->texcoords[t + k] = chunk->texcoords[k];
+						dirty[1][t + k] = anyDirty = 1;
+					}
+				}
+
+				for(uint_fast32_t k = 0; k < chunk->info.numNormals && n + k < counts[2]; ++k){
+					if(memcmp(&parsed->normals[n + k], &chunk->normals[k], sizeof(objgl_vec3))){
+						parsed->normals[n + k] = chunk->normals[k];
+						dirty[2][n + k] = anyDirty = 1;
+					}
 				}
-				break;
 			}
-			case 'o':{
-				uint_fast32_t temp = buffPos;
-				++temp;
 
-				while(strinfo.buffer[temp] == ' '){++temp;}
-				char* strstart = &strinfo.buffer[temp];
+			p += chunk->info.numPositions;
+			t += chunk->info.numTexcoords;
+			n += chunk->info.numNormals;
+		}
 
-				if(name && !objgl_strcmp(strstart, name)){
-					goto loopexit;
-				} else if(!name){
-					uint_least32_t strlen = objgl_strlen(strstart);
-					name = (char*)objgl_alloc(strlen + 1);
-					name[strlen] = '\0';
-					for(; strlen; --strlen){
-						name[strlen - 1] = strstart[strlen - 1];
-					}
+		const objgl2Data *obj = &parsed->obj;
+		const objfacevert *keys = (const objfacevert*)parsed->keys;
 
-					buffPos = temp;
-					while(strinfo.buffer[++buffPos] != '\n');
-					++buffPos;
-				}
-				break;
+		for(objgl_count i = 0; i < obj->numVertices && anyDirty; ++i){
+			objfacevert key = keys[i];
+
+			//the keys are 1-based, 0 - 1 wraps around and fails the bounds check
+			if((key.a[0] - 1 < counts[0] && dirty[0][key.a[0] - 1]) ||
+				(obj->hasTexCoords && key.a[1] - 1 < counts[1] && dirty[1][key.a[1] - 1]) ||
+				(obj->hasNormals && key.a[2] - 1 < counts[2] && dirty[2][key.a[2] - 1])){
+				objgl_assemble_keys(obj->data, obj->vertSize, keys, i, i + 1, parsed->positions, parsed->texcoords, parsed->normals, obj->hasTexCoords, obj->hasNormals);
+
+				r->dirtyBegin = r->dirtyBegin == r->dirtyEnd ? i : r->dirtyBegin;
+				r->dirtyEnd = i + 1;
 			}
-			case 'u':{
-				const char *usemtl = "usemtl";
-				char isTrue = 1;
+		}
 
-				while(*usemtl && isTrue){
-					isTrue = isTrue && (*usemtl == strinfo.buffer[buffPos++]);
-					++usemtl;
-				}
+		for(uint_fast32_t c = 0; c < 3; ++c){
+			objgl_free(dirty[c]);
+		}
 
-				if(!isTrue){
-					while(strinfo.buffer[buffPos] != '\n'){++buffPos;}
-					++buffPos;
-					break;
-				}
+		if(r->dirtyBegin != r->dirtyEnd){
+			objgl_bounds_compute(&parsed->obj);
+			objgl2_bvh_refit(&parsed->obj);
+		}
 
-				while(strinfo.buffer[buffPos] == ' '){++buffPos;}
+		result = anyDirty ? OBJGL2_RELOAD_PATCHED : OBJGL2_RELOAD_UNCHANGED;
+	}
 
-				char* matname = &strinfo.buffer[buffPos];
-				uint_least32_t matnamelen = objgl_strlen(matname);
-				uint_least32_t hash = objgl2_hashfunc32_string(matname, matnamelen);
+	for(uint_fast32_t i = 0; i < r->numChunks; ++i){
+		if(!r->chunks[i].reused){
+			objgl_chunk_delete(&r->chunks[i]);
+		}
+	}
 
-				if(!curMaterial.name && !curMaterial.hash){
-					curMaterial.hash = hash;
-					curMaterial.name = (char*)objgl_alloc(matnamelen + 1);
-					curMaterial.name[matnamelen] = '\0';
+	objgl_free(r->chunks);
+	r->chunks = chunks;
+	r->numChunks = numChunks;
 
-					for(; matnamelen; --matnamelen){
-						curMaterial.name[matnamelen - 1] = matname[matnamelen - 1];
-					}
-				} else if(hash != curMaterial.hash){
-					materials[matIndex] = curMaterial;
-
-					char found = 0;
-					for(matIndex = 0; matIndex < numMaterials; ++matIndex){
-						if(materials[matIndex].hash == hash){
-							found = 1;
-							break;
-						}
-					}
+	if(!patch){
+		objparse_internal parse;
+		uint_least64_t line = 0;
+		const char *invalid = objgl_reload_merge(r, &parse, &line);
 
-					if(!found){
-						if(numMaterials >= resMaterials){
-							uint_fast32_t oldsize = resMaterials;
-							resMaterials += resMaterials;
-							materials = (objmaterial_internal*)objgl_realloc(materials, sizeof(objmaterial_internal) * resMaterials, sizeof(objmaterial_internal) * oldsize);
-						}
-
-						curMaterial.hash = hash;
-						curMaterial.resIndices = 256;
-						curMaterial.numIndices = 0;
-						curMaterial.indices = (objfacevert*)objgl_alloc(sizeof(objfacevert) * curMaterial.resIndices);
-						curMaterial.name = (char*)objgl_alloc(matnamelen + 1);
-						curMaterial.name[matnamelen] = '\0';
-
-						for(; matnamelen; --matnamelen){
-							curMaterial.name[matnamelen - 1] = matname[matnamelen - 1];
-						}
-						matIndex = numMaterials;
-						++numMaterials;
-					} else{
-						curMaterial = materials[matIndex];
-					}
-				}
+		//the mesh of the last version that loaded stays
+		if(invalid){
+			objgl_reload_drop(&parse);
+			r->stale = 1;
+			objgl_reload_fail(r, OBJGL2_EINDEX, invalid);
 
-				break;
+			if(r->options.error){
+				r->options.error->line = line;
 			}
-			case 'f':{
-				++buffPos;
 
-				uint_fast32_t numindices = objgl_parseindices(strinfo.buffer, &buffPos, &vertCache, &info);
-				uint_fast32_t totalindices = (numindices - 2) * 3;
-				uint_fast32_t tris = (numindices - 2);
+			return OBJGL2_RELOAD_FAILED;
+		}
+
+		objscratch_internal scratch = (const objscratch_internal){0};
+		objgl2Parsed *parsed = (objgl2Parsed*)objgl_alloc(sizeof(objgl2Parsed));
+		*parsed = (const objgl2Parsed){0};
 
-				if(curMaterial.numIndices + totalindices >= curMaterial.resIndices){
-					uint_fast32_t oldsize = curMaterial.resIndices;
-					curMaterial.resIndices += curMaterial.resIndices + totalindices;
-					curMaterial.indices = (objfacevert*)objgl_realloc(curMaterial.indices, sizeof(objfacevert) * curMaterial.resIndices, sizeof(objfacevert) * oldsize);
-				}
+		parsed->obj = objgl_build(&parse, &r->options, &scratch, NULL, parsed);
+		objgl_free(parse.mat.list);
+		objgl_scratch_delete(&scratch, NULL);
 
-				if(numindices < 4){
-					curMaterial.indices[curMaterial.numIndices++] = vertCache.cache[0];
-					curMaterial.indices[curMaterial.numIndices++] = vertCache.cache[1];
-					curMaterial.indices[curMaterial.numIndices++] = vertCache.cache[2];
+		objgl2Data *obj = &parsed->obj;
+		obj->data = (float*)objgl_alloc((size_t)obj->vertSize * obj->numVertices + 1);
+		objgl_assemble_keys(obj->data, obj->vertSize, (const objfacevert*)parsed->keys, 0, obj->numVertices, parsed->positions, parsed->texcoords, parsed->normals, obj->hasTexCoords, obj->hasNormals);
 
-					numIndices += 3;
-				} else{
-					for(uint_fast32_t i = 0, j = 1; i < tris; ++i){
-						curMaterial.indices[curMaterial.numIndices++] = vertCache.cache[0];
-						curMaterial.indices[curMaterial.numIndices++] = vertCache.cache[j];
-						curMaterial.indices[curMaterial.numIndices++] = vertCache.cache[++j];
-					}
+		if(r->options.bvh){
+			objgl2_bvh_build(obj, r->options.scheduler);
+		}
+
+		objgl2_parsed_delete(r->parsed);
+		r->parsed = parsed;
+		r->stale = 0;
+		r->dirtyBegin = 0;
+		r->dirtyEnd = obj->numVertices;
+		result = OBJGL2_RELOAD_REBUILT;
+	}
+
+	return result;
+}
+
+objgl2Reloader* objgl2_reloader_create(const char *path, const objgl2LoadOptions *options){
+	objgl2Reloader *r = (objgl2Reloader*)objgl_alloc(sizeof(objgl2Reloader));
+	*r = (const objgl2Reloader){0};
+
+	uint_fast32_t len = 0;
+	while(path[len]){++len;}
+
+	r->path = (char*)objgl_alloc(len + 1);
+	memcpy(r->path, path, len + 1);
+
+	//the stats and the progress are per load, a reload isn't one
+	if(options){
+		r->options.mtldb = options->mtldb;
+		r->options.scheduler = options->scheduler;
+		r->options.error = options->error;
+		r->options.bvh = options->bvh;
+		r->options.flags = options->flags;
+	}
+
+	if(objgl2_reloader_update(r) == OBJGL2_RELOAD_FAILED){
+		objgl2_reloader_delete(r);
+		return NULL;
+	}
+
+	return r;
+}
+
+const objgl2Data* objgl2_reloader_data(const objgl2Reloader *r){
+	return &r->parsed->obj;
+}
+
+void objgl2_reloader_dirty(const objgl2Reloader *r, objgl2Size *begin, objgl2Size *end){
+	*begin = r->dirtyBegin;
+	*end = r->dirtyEnd;
+}
+
+void objgl2_reloader_delete(objgl2Reloader *r){
+	if(!r){
+		return;
+	}
+
+	for(uint_fast32_t i = 0; i < r->numChunks; ++i){
+		objgl_chunk_delete(&r->chunks[i]);
+	}
+
+	objgl_free(r->chunks);
+	objgl2_parsed_delete(r->parsed);
+	objgl_free(r->file);
+	objgl_free(r->path);
+	objgl_free(r);
+}
+
+#ifdef __linux__
+struct __ObjGL2Watcher{
+	int fd;
+	int *dirs; //inotify watch of the file's directory, editors often save by renaming a new file over the old one
+	char **names;
+	uint_fast32_t numFiles, resFiles;
+};
+
+objgl2Watcher* objgl2_watcher_create(void){
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if(fd < 0){
+		return NULL;
+	}
+
+	objgl2Watcher *w = (objgl2Watcher*)objgl_alloc(sizeof(objgl2Watcher));
+	*w = (const objgl2Watcher){0};
+	w->fd = fd;
 
-					numIndices += totalindices;
+	return w;
+}
+
+int objgl2_watcher_add(objgl2Watcher *w, const char *path){
+	uint_fast32_t dirlen = objgl_dirlen(path);
+	char *dir = (char*)objgl_alloc(dirlen + 2);
+
+	if(dirlen){
+		memcpy(dir, path, dirlen);
+		dir[dirlen] = '\0';
+	} else{
+		dir[0] = '.';
+		dir[1] = '\0';
+	}
+
+	int wd = inotify_add_watch(w->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+	objgl_free(dir);
+
+	if(wd < 0){
+		return -1;
+	}
+
+	if(w->numFiles >= w->resFiles){
+		w->resFiles += w->resFiles + 4;
+		w->dirs = (int*)objgl_realloc(w->dirs, sizeof(int) * w->resFiles);
+		w->names = (char**)objgl_realloc(w->names, sizeof(char*) * w->resFiles);
+	}
+
+	uint_fast32_t len = 0;
+	while(path[dirlen + len]){++len;}
+
+	w->dirs[w->numFiles] = wd;
+	w->names[w->numFiles] = (char*)objgl_alloc(len + 1);
+	memcpy(w->names[w->numFiles], &path[dirlen], len + 1);
+
+	return (int)w->numFiles++;
+}
+
+uint_least32_t objgl2_watcher_poll(objgl2Watcher *w, int timeoutMs, int *changed, uint_least32_t maxChanged){
+	struct pollfd pfd = {w->fd, POLLIN, 0};
+	uint_least32_t numChanged = 0;
+
+	if(poll(&pfd, 1, timeoutMs) <= 0){
+		return 0;
+	}
+
+	char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+
+	while((len = read(w->fd, events, sizeof(events))) > 0){
+		for(char *ptr = events; ptr < events + len;){
+			const struct inotify_event *event = (const struct inotify_event*)ptr;
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			for(uint_fast32_t i = 0; i < w->numFiles && event->len; ++i){
+				if(w->dirs[i] != event->wd || strcmp(w->names[i], event->name)){
+					continue;
 				}
 
-				hasNormals = hasNormals && vertCache.cache[0].a[2];
-				hasTextures = hasTextures && vertCache.cache[0].a[1];
+				//a file saved twice between the polls is reported once
+				char seen = 0;
 
-				break;
-			}
-			case '\0':
-				goto loopexit;
-			default:
-				while(strinfo.buffer[buffPos] != '\n' && strinfo.buffer[buffPos] != '\0'){++buffPos;}
-				++buffPos;
-				break;
-			}
-		}
+				for(uint_fast32_t j = 0; j < numChanged; ++j){
+					seen = seen || changed[j] == (int)i;
+				}
 
-		if(!strinfo.eof){
-			if(buffPos >= bufferLen){
-				bufferLen = streamreader(&strinfo);
-				buffPos = strinfo.buffOffset;
+				if(!seen && numChanged < maxChanged){
+					changed[numChanged++] = (int)i;
+				}
 			}
-		} else{
-			goto loopexit;
 		}
 	}
 
-	loopexit:
-	materials[matIndex] = curMaterial;
-	strinfo.buffOffset = buffPos;
-	objgl_free(vertCache.cache);
+	return numChanged;
+}
 
-	uint_least32_t uniques = 0;
-	uint_least32_t *uniqueIndices = (uint_least32_t*)objgl_alloc(sizeof(uint_least32_t) * numIndices);
-	objhashentry *hashtable = (objhashentry*)objgl_alloc(sizeof(objhashentry) * numIndices);
-	objgl2Material *mats = (objgl2Material*)objgl_alloc(sizeof(objgl2Material) * numMaterials);
+void objgl2_watcher_delete(objgl2Watcher *w){
+	if(!w){
+		return;
+	}
 
-	for(uint_fast32_t i = 0, k = 0; i < numMaterials; ++i){
-		objmaterial_internal mat = materials[i];
-		mats[i].indices = &uniqueIndices[k];
+	for(uint_fast32_t i = 0; i < w->numFiles; ++i){
+		objgl_free(w->names[i]);
+	}
+
+	close(w->fd);
+	objgl_free(w->dirs);
+	objgl_free(w->names);
+	objgl_free(w);
+}
+#else
+objgl2Watcher* objgl2_watcher_create(void){
+	return NULL;
+}
+
+int objgl2_watcher_add(objgl2Watcher *w, const char *path){
+	return -1;
+}
+
+uint_least32_t objgl2_watcher_poll(objgl2Watcher *w, int timeoutMs, int *changed, uint_least32_t maxChanged){
+	return 0;
+}
+
+void objgl2_watcher_delete(objgl2Watcher *w){
+}
+#endif
+#endif
+#endif
+
+#ifdef OBJGL_FSTREAM_IMPL
+#if OBJGL_FSTREAM_IMPL
+typedef struct objcacheentry_internal objcacheentry_internal;
+
+struct objcacheentry_internal{
+	objgl2Data obj; //first, so a pointer to it is a pointer to the entry
+	char *path;
+	uint_least32_t hash;
+	uint_least64_t dev, ino, size;
+	int_least64_t mtime, mtimeNsec;
+	uint_least64_t bytes;
+	uint_fast32_t refs;
+	char loading; //the first acquire is parsing it, the others wait
+	char detached; //out of the map and the LRU list, freed by the last release
+	objgl2Error error;
+	objcacheentry_internal *next; //in the bucket
+	objcacheentry_internal *newer, *older; //in the LRU list
+};
+
+struct __ObjGL2Cache{
+	objgl2LoadOptions options;
+	uint_least64_t budget, bytes;
+	objcacheentry_internal **buckets;
+	uint_fast32_t mask, count;
+	objcacheentry_internal *newest, *oldest;
+	objgl_mutex lock;
+	objgl_cond loaded;
+};
+
+objgl2Cache* objgl2_cache_create(uint_least64_t budget, const objgl2LoadOptions *options){
+	objgl2Cache *cache = (objgl2Cache*)objgl_alloc(sizeof(objgl2Cache));
+	*cache = (const objgl2Cache){0};
+	cache->budget = budget;
+	cache->mask = 63;
+	cache->buckets = (objcacheentry_internal**)objgl_calloc(cache->mask + 1, sizeof(objcacheentry_internal*));
+
+	if(options){
+		cache->options.mtldb = options->mtldb;
+		cache->options.scheduler = options->scheduler;
+		cache->options.weld = options->weld;
+		cache->options.bvh = options->bvh;
+		cache->options.flags = options->flags;
+	}
+
+	objgl_mutex_init(&cache->lock);
+	objgl_cond_init(&cache->loaded);
+
+	return cache;
+}
+
+void objgl_cache_unlink(objgl2Cache *cache, objcacheentry_internal *entry){
+	objcacheentry_internal **slot = &cache->buckets[entry->hash & cache->mask];
+	while(*slot != entry){slot = &(*slot)->next;}
+	*slot = entry->next;
+
+	*(entry->newer ? &entry->newer->older : &cache->newest) = entry->older;
+	*(entry->older ? &entry->older->newer : &cache->oldest) = entry->newer;
+	entry->newer = entry->older = NULL;
 
-		for(uint_fast32_t j = 0; j < mat.numIndices; ++j, ++k){
-			uniqueIndices[k] = objgl_insert(&mat.indices[j], hashtable, numIndices, &uniques);
+	cache->bytes -= entry->bytes;
+	--cache->count;
+	entry->detached = 1;
+}
+
+void objgl_cache_free(objcacheentry_internal *entry){
+	objgl2_deleteobj(&entry->obj);
+	objgl_free(entry->path);
+	objgl_free(entry);
+}
+
+void objgl_cache_touch(objgl2Cache *cache, objcacheentry_internal *entry){
+	if(cache->newest == entry){
+		return;
+	}
+
+	*(entry->newer ? &entry->newer->older : &cache->newest) = entry->older;
+	*(entry->older ? &entry->older->newer : &cache->oldest) = entry->newer;
+
+	entry->older = cache->newest;
+	entry->newer = NULL;
+	*(cache->newest ? &cache->newest->newer : &cache->oldest) = entry;
+	cache->newest = entry;
+}
+
+//drops the least recently used meshes nobody holds until the cache fits the budget
+void objgl_cache_evict(objgl2Cache *cache){
+	for(objcacheentry_internal *entry = cache->oldest; entry && cache->bytes > cache->budget;){
+		objcacheentry_internal *newer = entry->newer;
+
+		if(!entry->refs){
+			objgl_cache_unlink(cache, entry);
+			objgl_cache_free(entry);
 		}
 
-		mats[i].len = mat.numIndices;
-		mats[i].name = mat.name;
-		objgl_free(mat.indices);
+		entry = newer;
 	}
+}
 
-	objgl_free(materials);
+void objgl_cache_grow(objgl2Cache *cache){
+	uint_fast32_t size = (cache->mask + 1) * 2;
+	objcacheentry_internal **buckets = (objcacheentry_internal**)objgl_calloc(size, sizeof(objcacheentry_internal*));
 
-	unsigned int vertSize = sizeof(float) * (3 + 3 * hasNormals + 2 * hasTextures);
-	void *data = objgl_alloc(vertSize * uniques);
+	for(uint_fast32_t i = 0; i <= cache->mask; ++i){
+		while(cache->buckets[i]){
+			objcacheentry_internal *entry = cache->buckets[i];
+			cache->buckets[i] = entry->next;
+			entry->next = buckets[entry->hash & (size - 1)];
+			buckets[entry->hash & (size - 1)] = entry;
+		}
+	}
+
+	objgl_free(cache->buckets);
+	cache->buckets = buckets;
+	cache->mask = size - 1;
+}
+
+const objgl2Data* objgl2_cache_acquire(objgl2Cache *cache, const char *path, objgl2Error *error){
+	if(error){
+		*error = (const objgl2Error){OBJGL2_OK, NULL};
+	}
 
-	if(hasTextures && hasNormals){
-		for(uint_fast32_t i = 0, j = 0; i < numIndices && j < uniques; ++i){
-			objhashentry glhash = hashtable[i];
+	//the identity is taken before the load, an edit during it is seen by the next acquire
+	struct stat st;
 
-			if(glhash.hash){
-				*((objgl_vec3*)((size_t)data + glhash.index * vertSize)) = positions[glhash.vert.a[0] - 1];
-				*((objgl_vec2*)((size_t)data + glhash.index * vertSize + sizeof(float) * 3)) = texcoords[glhash.vert.a[1] - 1];
-				*((objgl_vec3*)((size_t)data + glhash.index * vertSize + sizeof(float) * 5)) = normals[glhash.vert.a[2] - 1];
-				++j;
-			}
+	if(stat(path, &st)){
+		if(error){
+			*error = (const objgl2Error){OBJGL2_EIO, "can't stat the file"};
 		}
-	} else if(hasTextures){
-		for(uint_fast32_t i = 0, j = 0; i < numIndices && j < uniques; ++i){
-			objhashentry glhash = hashtable[i];
 
-			if(glhash.hash){
-				*((objgl_vec3*)((size_t)data + glhash.index * vertSize)) = positions[glhash.vert.a[0] - 1];
-				*((objgl_vec2*)((size_t)data + glhash.index * vertSize + sizeof(float) * 3)) = texcoords[glhash.vert.a[1] - 1];
-				++j;
-			}
+		return NULL;
+	}
+
+	int_least64_t mtimeNsec = 0;
+#ifdef __linux__
+	mtimeNsec = st.st_mtim.tv_nsec;
+#endif
+
+	uint_fast32_t pathLen = 0;
+	while(path[pathLen]){++pathLen;}
+
+	uint_least32_t hash = objgl2_hashfunc32_string(path, pathLen);
+
+	objgl_mutex_lock(&cache->lock);
+
+	objcacheentry_internal *entry = cache->buckets[hash & cache->mask];
+	while(entry && (entry->hash != hash || strcmp(entry->path, path))){entry = entry->next;}
+
+	if(entry && (entry->dev != (uint_least64_t)st.st_dev || entry->ino != (uint_least64_t)st.st_ino || entry->size != (uint_least64_t)st.st_size ||
+		entry->mtime != (int_least64_t)st.st_mtime || entry->mtimeNsec != mtimeNsec)){
+		//the file changed, whoever holds the old mesh keeps it until the release
+		objgl_cache_unlink(cache, entry);
+
+		if(!entry->refs){
+			objgl_cache_free(entry);
 		}
-	} else if(hasNormals){
-		for(uint_fast32_t i = 0, j = 0; i < numIndices && j < uniques; ++i){
-			objhashentry glhash = hashtable[i];
 
-			if(glhash.hash){
-				*((objgl_vec3*)((size_t)data + glhash.index * vertSize)) = positions[glhash.vert.a[0] - 1];
-				*((objgl_vec3*)((size_t)data + glhash.index * vertSize + sizeof(float) * 3)) = normals[glhash.vert.a[2] - 1];
-				++j;
-			}
+		entry = NULL;
+	}
+
+	if(entry){
+		++entry->refs;
+		objgl_cache_touch(cache, entry);
+
+		while(entry->loading){
+			objgl_cond_wait(&cache->loaded, &cache->lock);
 		}
 	} else{
-		for(uint_fast32_t i = 0, j = 0; i < numIndices && j < uniques; ++i){
-			objhashentry glhash = hashtable[i];
+		if(cache->count + 1 > cache->mask + 1){
+			objgl_cache_grow(cache);
+		}
 
-			if(glhash.hash){
-				*((objgl_vec3*)((size_t)data + glhash.index * vertSize)) = positions[glhash.vert.a[0] - 1];
-				++j;
+		entry = (objcacheentry_internal*)objgl_alloc(sizeof(objcacheentry_internal));
+		*entry = (const objcacheentry_internal){{0}};
+		entry->path = (char*)objgl_alloc(pathLen + 1);
+		memcpy(entry->path, path, pathLen + 1);
+		entry->hash = hash;
+		entry->dev = (uint_least64_t)st.st_dev;
+		entry->ino = (uint_least64_t)st.st_ino;
+		entry->size = (uint_least64_t)st.st_size;
+		entry->mtime = (int_least64_t)st.st_mtime;
+		entry->mtimeNsec = mtimeNsec;
+		entry->refs = 1;
+		entry->loading = 1;
+
+		entry->next = cache->buckets[hash & cache->mask];
+		cache->buckets[hash & cache->mask] = entry;
+		++cache->count;
+
+		entry->older = cache->newest;
+		*(cache->newest ? &cache->newest->newer : &cache->oldest) = entry;
+		cache->newest = entry;
+
+		objgl_mutex_unlock(&cache->lock);
+
+		objgl2Stats stats;
+		objgl2LoadOptions options = cache->options;
+		options.stats = &stats;
+		options.error = &entry->error;
+
+		objgl2StreamInfo strinfo = objgl2_init_filestream(entry->path, 1 << 18);
+		objgl2Data obj = objgl2_readobj_ex(&strinfo, &options);
+		objgl2_deletestream(&strinfo);
+
+		objgl_mutex_lock(&cache->lock);
+
+		entry->obj = obj;
+		entry->loading = 0;
+
+		if(entry->error.code != OBJGL2_OK){
+			if(!entry->detached){
+				objgl_cache_unlink(cache, entry);
 			}
+		} else if(!entry->detached){
+			entry->bytes = stats.bytes;
+			cache->bytes += entry->bytes;
 		}
+
+		objgl_cond_broadcast(&cache->loaded);
+		objgl_cache_evict(cache);
 	}
 
-	objgl2Data obj;
-	obj.data = (float*)data;
-	obj.hasNormals = hasNormals;
-	obj.hasTexCoords = hasTextures;
-	obj.indices = uniqueIndices;
-	obj.name = name;
-	obj.numIndices = numIndices;
-	obj.numMaterials = numMaterials;
-	obj.numVertices = uniques;
-	obj.materials = mats;
-	obj.vertSize = vertSize;
+	if(entry->error.code != OBJGL2_OK){
+		if(error){
+			*error = entry->error;
+		}
+
+		if(!--entry->refs){
+			objgl_cache_free(entry);
+		}
 
-	objgl_free(positions);
-	objgl_free(normals);
-	objgl_free(texcoords);
-	objgl_free(hashtable);
+		entry = NULL;
+	}
 
-	*strinfoptr = strinfo;
-	return obj;
+	objgl_mutex_unlock(&cache->lock);
+
+	return entry ? &entry->obj : NULL;
+}
+
+void objgl2_cache_release(objgl2Cache *cache, const objgl2Data *obj){
+	objcacheentry_internal *entry = (objcacheentry_internal*)obj;
+
+	objgl_mutex_lock(&cache->lock);
+
+	if(!--entry->refs){
+		if(entry->detached){
+			objgl_cache_free(entry);
+		} else{
+			objgl_cache_evict(cache);
+		}
+	}
+
+	objgl_mutex_unlock(&cache->lock);
+}
+
+void objgl2_cache_delete(objgl2Cache *cache){
+	if(!cache){
+		return;
+	}
+
+	while(cache->oldest){
+		objcacheentry_internal *entry = cache->oldest;
+		objgl_cache_unlink(cache, entry);
+		objgl_cache_free(entry);
+	}
+
+	objgl_free(cache->buckets);
+	objgl_cond_destroy(&cache->loaded);
+	objgl_mutex_destroy(&cache->lock);
+	objgl_free(cache);
+}
+#endif
+#endif
+
+typedef struct{
+	uint_least64_t size;
+	uint_least32_t index;
+} objbatchtask_internal;
+
+typedef struct __ObjGLBatch objbatch_internal;
+
+//tasks[head..tail) is the worker's deque, the owner pops the head (the biggest file), thieves take the tail
+typedef struct{
+	objbatch_internal *batch;
+	uint_least32_t *tasks;
+	uint_fast32_t head, tail;
+	uint_fast32_t index;
+	objgl_mutex lock;
+	objscratch_internal scratch;
+} objbatchworker_internal;
+
+struct __ObjGLBatch{
+	objgl2StreamInfo *strinfos;
+	objgl2Data *objs;
+	const objgl2LoadOptions *options;
+	uint_least64_t *sizes; //measured once for the sort, the progress reports reuse them
+	objbatchworker_internal *workers;
+	uint_fast32_t numWorkers;
+};
+
+int objgl_batchtask_cmp(const void *a, const void *b){
+	uint_least64_t x = ((const objbatchtask_internal*)a)->size, y = ((const objbatchtask_internal*)b)->size;
+
+	return (x < y) - (x > y);
+}
+
+char objgl_batch_pop(objbatchworker_internal *worker, char steal, uint_least32_t *task){
+	char found = 0;
+
+	objgl_mutex_lock(&worker->lock);
+
+	if(worker->head < worker->tail){
+		*task = steal ? worker->tasks[--worker->tail] : worker->tasks[worker->head++];
+		found = 1;
+	}
+
+	objgl_mutex_unlock(&worker->lock);
+
+	return found;
+}
+
+void objgl_batch_work(objbatchworker_internal *worker){
+	objbatch_internal *batch = worker->batch;
+	objgl2LoadOptions options = *batch->options;
+	uint_least32_t task;
+
+	while(1){
+		char found = objgl_batch_pop(worker, 0, &task);
+
+		//nothing gets added once the batch runs, so if every deque is empty we're done
+		for(uint_fast32_t i = 1; i < batch->numWorkers && !found; ++i){
+			found = objgl_batch_pop(&batch->workers[(worker->index + i) % batch->numWorkers], 1, &task);
+		}
+
+		if(!found){
+			break;
+		}
+
+		options.stats = batch->options->stats ? &batch->options->stats[task] : NULL;
+		options.error = batch->options->error ? &batch->options->error[task] : NULL;
+		batch->objs[task] = objgl_readobj_scratch(&batch->strinfos[task], &options, &worker->scratch, NULL, &batch->sizes[task]);
+	}
+}
+
+void objgl_batch_task(void *ctx, uint_least32_t index){
+	objbatch_internal *batch = (objbatch_internal*)ctx;
+
+	objgl_batch_work(&batch->workers[index]);
+}
+
+void objgl2_readobj_batch(objgl2StreamInfo *strinfos, objgl2Data *objs, uint_least32_t count, unsigned int numThreads, const objgl2LoadOptions *options){
+	const objgl2LoadOptions defaults = (const objgl2LoadOptions){0};
+
+	if(!count){
+		return;
+	}
+
+	if(!options){
+		options = &defaults;
+	}
+
+	if(!numThreads){
+		numThreads = objgl_numcores();
+	}
+
+#if !OBJGL_THREADS_IMPL
+	numThreads = options->scheduler ? numThreads : 1;
+#endif
+
+	if(numThreads > count){
+		numThreads = count;
+	}
+
+	//biggest first, dealt round-robin, so every deque is sorted as well
+	objbatchtask_internal *sorted = (objbatchtask_internal*)objgl_alloc(sizeof(objbatchtask_internal) * count);
+
+	uint_least64_t *sizes = (uint_least64_t*)objgl_alloc(sizeof(uint_least64_t) * count);
+
+	for(uint_fast32_t i = 0; i < count; ++i){
+		sorted[i].size = sizes[i] = objgl_streamsize(&strinfos[i]);
+		sorted[i].index = i;
+	}
+
+	qsort(sorted, count, sizeof(objbatchtask_internal), objgl_batchtask_cmp);
+
+	objbatch_internal batch = {strinfos, objs, options, sizes, NULL, numThreads};
+	uint_least32_t *tasks = (uint_least32_t*)objgl_alloc(sizeof(uint_least32_t) * count);
+	batch.workers = (objbatchworker_internal*)objgl_alloc(sizeof(objbatchworker_internal) * numThreads);
+
+	for(uint_fast32_t i = 0, k = 0; i < numThreads; ++i){
+		objbatchworker_internal *worker = &batch.workers[i];
+		*worker = (const objbatchworker_internal){0};
+		worker->batch = &batch;
+		worker->index = i;
+		worker->tasks = &tasks[k];
+		objgl_mutex_init(&worker->lock);
+
+		for(uint_fast32_t j = i; j < count; j += numThreads){
+			tasks[k++] = sorted[j].index;
+		}
+
+		worker->tail = &tasks[k] - worker->tasks;
+	}
+
+	objgl_free(sorted);
+
+	const objgl2Scheduler *scheduler = options->scheduler;
+
+	if(scheduler){
+		scheduler->wait(scheduler->userdata, scheduler->submit(scheduler->userdata, objgl_batch_task, &batch, numThreads));
+	} else if(numThreads > 1){
+		objgl2Scheduler *pool = objgl2_threadpool_create(numThreads - 1);
+		pool->wait(pool->userdata, pool->submit(pool->userdata, objgl_batch_task, &batch, numThreads));
+		objgl2_threadpool_delete(pool);
+	} else{
+		objgl_batch_work(&batch.workers[0]);
+	}
+
+	for(uint_fast32_t i = 0; i < numThreads; ++i){
+		objgl_scratch_delete(&batch.workers[i].scratch, NULL);
+		objgl_mutex_destroy(&batch.workers[i].lock);
+	}
+
+	objgl_free(batch.workers);
+	objgl_free(tasks);
+	objgl_free(sizes);
 }
 
 #ifdef __cplusplus
@@ -3,43 +3,136 @@
 
 #define OBJGL_FSTREAM 1
 #define OBJGL_BSTREAM 0
+#define OBJGL_ZSTREAM 2
 
 #ifndef OBJGL_FSTREAM_IMPL
 #define OBJGL_FSTREAM_IMPL 1
 #endif
 
+//compressed file streams, gzip needs zlib (-lz), zstd needs libzstd (-lzstd)
+#ifndef OBJGL_ZLIB_IMPL
+#define OBJGL_ZLIB_IMPL 0
+#endif
+
+#ifndef OBJGL_ZSTD_IMPL
+#define OBJGL_ZSTD_IMPL 0
+#endif
+
+//worker threads of objgl2_readobj_batch (pthreads or Win32), 0 loads the batch on the calling thread
+#ifndef OBJGL_THREADS_IMPL
+#define OBJGL_THREADS_IMPL 1
+#endif
+
+//64-bit counts (numIndices, numVertices, material lengths) for meshes with more than 4G indices,
+//OBJGL_INDEX64_IMPL makes the indices 64-bit as well for more than 4G vertices. Set them the same for every file that includes this
+#ifndef OBJGL_64BIT_IMPL
+#define OBJGL_64BIT_IMPL 0
+#endif
+
+#ifndef OBJGL_INDEX64_IMPL
+#define OBJGL_INDEX64_IMPL 0
+#endif
+
 #include <stdint.h>
 
+#if OBJGL_64BIT_IMPL || OBJGL_INDEX64_IMPL
+typedef uint_least64_t objgl2Size;
+#else
+typedef uint_least32_t objgl2Size;
+#endif
+
+#if OBJGL_INDEX64_IMPL
+typedef uint_least64_t objgl2Index;
+#else
+typedef uint_least32_t objgl2Index;
+#endif
+
+#define OBJGL2_NOTEXTURE 0xFFFFFFFF
+
+enum{
+	OBJGL2_MAP_AMBIENT, //map_Ka
+	OBJGL2_MAP_DIFFUSE, //map_Kd
+	OBJGL2_MAP_SPECULAR, //map_Ks
+	OBJGL2_MAP_EMISSIVE, //map_Ke
+	OBJGL2_MAP_SHININESS, //map_Ns
+	OBJGL2_MAP_OPACITY, //map_d
+	OBJGL2_MAP_BUMP, //map_bump, bump
+	OBJGL2_MAP_COUNT
+};
+
+typedef struct __ObjGL2MtlDB objgl2MtlDB;
+
+typedef struct{
+	float ambient[3], diffuse[3], specular[3], emissive[3]; //Ka, Kd, Ks, Ke
+	float shininess, opacity, ior; //Ns, d (or 1 - Tr), Ni
+	int_least32_t illum;
+	uint_least32_t maps[OBJGL2_MAP_COUNT]; //texture indices in the database, OBJGL2_NOTEXTURE if not present
+	const char *name;
+} objgl2MtlMaterial;
+
+//of the positions the faces use, all zeros if there are none
+typedef struct{
+	float min[3], max[3];
+	float center[3], radius; //encloses all of them but isn't the smallest sphere that does
+} objgl2Bounds;
+
+/*
+ * bounding volume hierarchy over the triangles, for ray casts and picking. nodes[0] is the root and an inner node's first child follows it,
+ * a leaf's triangles all belong to one material - the tree is split by the materials first and by the SAH within them
+ */
+typedef struct{
+	float min[3];
+	objgl2Index first; //inner node - index of the second child, leaf - offset of its triangles in objgl2BVH's triangles
+	float max[3];
+	objgl2Index count; //triangles of a leaf, 0 for inner nodes
+} objgl2BVHNode;
+
+typedef struct{
+	objgl2BVHNode *nodes;
+	objgl2Index *triangles; //triangle t uses indices[3 * t] .. indices[3 * t + 2]
+	objgl2Size numNodes, numTriangles;
+	uint_least32_t depth; //levels of the deepest leaf
+} objgl2BVH;
+
 #ifndef OBJGL_H_
 typedef struct{
-	uint_least32_t *indices;
-	uint_least32_t len;
+	objgl2Index *indices;
+	objgl2Size len;
 	char *name;
+	const objgl2MtlMaterial *mtl; //NULL if not found in any of the mtllib files
+	objgl2Bounds bounds;
 } objgl2Material;
 
 typedef struct{
 	float *data;
-	uint_least32_t *indices;
+	objgl2Index *indices;
 	objgl2Material *materials;
-	uint_least32_t numIndices, numVertices, vertSize, numMaterials;
+	objgl2Size numIndices, numVertices;
+	uint_least32_t vertSize, numMaterials;
 	unsigned char hasNormals, hasTexCoords;
 	char *name;
+	char *strings; //pool holding all of the material names
+	objgl2Bounds bounds; //of all of the materials
+	objgl2BVH *bvh; //NULL unless it was built, see objgl2_bvh_build
 } objgl2Data;
 #endif
 
 typedef struct __ObjGLStreamInfo objgl2StreamInfo;
 
-typedef uint_least32_t (*objgl2_streamreader_ptr)(objgl2StreamInfo*);
+//returns the position of the last newline in the buffer, the parser reads up to it
+typedef objgl2Size (*objgl2_streamreader_ptr)(objgl2StreamInfo*);
 
 struct __ObjGLStreamInfo{
 	uint_least64_t fOffset; //file offset from beginning SEEK_SET
-	uint_least32_t bufferLen; //buffer size
-	uint_least32_t buffOffset; //buffer offset
+	objgl2Size bufferLen; //buffer size, 64-bit with OBJGL_64BIT_IMPL so a buffer stream can be larger than 4GB
+	objgl2Size buffOffset; //buffer offset
 	objgl2_streamreader_ptr function;
 	char* filename; //null terminated file path
 	char* buffer; //buffer for holding data
 	char eof;
+	char failed; //the stream couldn't be read, the load fails with OBJGL2_EIO
 	char type;
+	void *handle; //state of the stream reader, e.g. a decompressor
 };
 
 #ifdef __cplusplus
@@ -48,18 +141,290 @@ extern "C"{
 
 objgl2StreamInfo objgl2_init_bufferstream(char* buffer);
 void objgl2_deletestream(objgl2StreamInfo* info);
-uint_least32_t objgl2_bufferstreamreader(objgl2StreamInfo* info);
+objgl2Size objgl2_bufferstreamreader(objgl2StreamInfo* info);
 
+/*
+ * the file is kept open between the reads and the partial line at the end of the buffer is moved to its front,
+ * a line longer than bufferSize grows the buffer
+ */
 #ifdef OBJGL_FSTREAM_IMPL
 #if OBJGL_FSTREAM_IMPL
-uint_least32_t objgl2_filestreamreader(objgl2StreamInfo* info);
+objgl2Size objgl2_filestreamreader(objgl2StreamInfo* info);
 objgl2StreamInfo objgl2_init_filestream(char *filename, unsigned int bufferSize);
 #endif
 #endif
 
+/*
+ * compressed files are decompressed by a thread of their own, ahead of the parser, into 4 buffers of bufferSize.
+ * A line longer than bufferSize grows its buffer. Files that can't be opened fail the load with OBJGL2_EIO.
+ */
+#if OBJGL_FSTREAM_IMPL && (OBJGL_ZLIB_IMPL || OBJGL_ZSTD_IMPL)
+objgl2Size objgl2_zstreamreader(objgl2StreamInfo* info);
+#endif
+
+#if OBJGL_FSTREAM_IMPL && OBJGL_ZLIB_IMPL
+objgl2StreamInfo objgl2_init_gzstream(const char *filename, unsigned int bufferSize); //gzip, zlib or an uncompressed file
+#endif
+
+#if OBJGL_FSTREAM_IMPL && OBJGL_ZSTD_IMPL
+objgl2StreamInfo objgl2_init_zstdstream(const char *filename, unsigned int bufferSize);
+#endif
+
+#define OBJGL2_PROBE_BUCKETS 16
+
+typedef struct{
+	double ioSeconds, parseSeconds, dedupSeconds, assemblySeconds, bvhSeconds; //wall time of each phase, I/O is the time spent in the stream reader
+	uint_least64_t bytesRead; //bytes consumed by the parser
+	uint_least64_t refills; //stream reader calls
+	uint_least64_t allocations; //malloc, calloc and realloc calls
+	uint_least64_t peakBytes; //peak of the bytes allocated by the loader
+	uint_least64_t bytes; //bytes still allocated at the end, i.e. the size of the returned objgl2Data
+	uint_least64_t probes[OBJGL2_PROBE_BUCKETS]; //dedup hash table probe lengths, the last bucket counts the longer ones as well
+	uint_least64_t positionLines, texcoordLines, normalLines, faceLines, materialLines, objectLines, mtllibLines, otherLines;
+} objgl2Stats;
+
+typedef void (*objgl2_task_ptr)(void *ctx, uint_least32_t index);
+
+/*
+ * the loader's parallel work goes through these, so it can share the cores with your own job system.
+ * submit - runs fn(ctx, 0) .. fn(ctx, count - 1), in any order and on any threads, returns a handle for wait
+ * wait - returns once all of the submitted calls are done, it's called exactly once per handle.
+ *        It may be called from inside of a submitted task (a batch worker waits for its assembly),
+ *        so it should run other work meanwhile instead of blocking the thread
+ */
+typedef struct{
+	void *userdata;
+	void* (*submit)(void *userdata, objgl2_task_ptr fn, void *ctx, uint_least32_t count);
+	void (*wait)(void *userdata, void *handle);
+} objgl2Scheduler;
+
+enum{
+	OBJGL2_OK,
+	OBJGL2_ECANCELLED, //the progress callback asked to stop, the returned objgl2Data is zeroed
+	OBJGL2_EIO, //the file couldn't be read, the returned objgl2Data is zeroed too
+	OBJGL2_EINDEX //a face line with something else than indices, or one OBJGL2_VALIDATE found it can't assemble, zeroed as well
+};
+
+typedef struct{
+	int code;
+	const char *message; //static string, NULL if OBJGL2_OK
+	uint_least64_t line; //of the face OBJGL2_EINDEX is about, counted from 1, 0 for the other codes
+} objgl2Error;
+
+//bytesTotal is 0 if the stream can't tell its size, return non-zero to cancel the load
+typedef char (*objgl2_progress_ptr)(void *userdata, uint_least64_t bytesRead, uint_least64_t bytesTotal);
+
+//how often a buffer stream reports the progress, file streams report it on every refill
+#define OBJGL2_PROGRESS_CHUNK (1 << 20)
+
+/*
+ * what the load has deduplicated so far, for showing a big file while it loads.
+ * Snapshots only grow: the vertices and the indices of every material published before stay as they were, unless relayout is set,
+ * then a vertex component turned out to be missing in the file and the vertices were repacked without it.
+ * The pointers are valid only during the callback. Materials have no mtl yet, they are resolved at the end of the load.
+ * The result of the load continues the last snapshot, so its vertex order differs from a load without snapshots.
+ */
+typedef struct{
+	const float *data;
+	objgl2Size numVertices;
+	unsigned int vertSize;
+	char hasNormals, hasTexCoords;
+	char relayout;
+	const objgl2Material *materials;
+	uint_least32_t numMaterials;
+	uint_least64_t bytesRead;
+} objgl2Snapshot;
+
+typedef void (*objgl2_snapshot_ptr)(void *userdata, const objgl2Snapshot *snapshot);
+
+#define OBJGL2_SNAPSHOT_BYTES (16 << 20)
+
+/*
+ * welding merges the vertices that are this close after dedup, not only the face vertices with the same v/vt/vn indices
+ * (CAD and scan exports repeat the positions under different indices). A vertex goes into the first one it's close to.
+ * The distances are euclidean, 0 merges only the equal values. Components the file doesn't have aren't compared
+ */
+typedef struct{
+	float position;
+	float texcoord;
+	float normal;
+} objgl2Weld;
+
+//objgl2LoadOptions flags, the skipped attribute lines aren't parsed and dedup keys the face vertices only on what's loaded
+#define OBJGL2_SKIP_TEXCOORDS 1
+#define OBJGL2_SKIP_NORMALS 2
+#define OBJGL2_LOAD_POSITIONS_ONLY (OBJGL2_SKIP_TEXCOORDS | OBJGL2_SKIP_NORMALS)
+//checked mode for untrusted files: a face with less than 3 vertices, or an index that's 0 or past the attributes read before the face,
+//fails the load with OBJGL2_EINDEX instead of reading out of bounds. A reloader keeps its previous data then
+#define OBJGL2_VALIDATE 4
+//a second o line doesn't end the load, every object goes into one objgl2Data named after the first
+#define OBJGL2_ALL_OBJECTS 8
+
+typedef struct{
+	objgl2MtlDB *mtldb; //resolves mtllib lines, NULL to ignore them
+	objgl2Stats *stats; //filled with the statistics of the load, NULL if you don't need them
+	const objgl2Scheduler *scheduler; //runs the parallel phases, NULL - single load runs on the calling thread, a batch uses its own thread pool
+	objgl2_progress_ptr progress; //called between the chunks of the file and once more before dedup, NULL if not needed
+	void *userdata; //passed to progress and snapshot
+	objgl2Error *error; //why the load failed, NULL if you don't care
+	objgl2_snapshot_ptr snapshot; //called every snapshotBytes of the file with what's been loaded so far, NULL if not needed
+	uint_least64_t snapshotBytes; //0 - OBJGL2_SNAPSHOT_BYTES
+	const objgl2Weld *weld; //NULL - only the identical face vertices are merged
+	char bvh; //non-zero builds objgl2Data's bvh after the assembly, on the scheduler if there is one. objgl2_parseobj has no vertices to build it from
+	unsigned int flags; //OBJGL2_SKIP_*, 0 loads everything
+} objgl2LoadOptions;
+
 objgl2Data objgl2_readobj(objgl2StreamInfo *strinfo);
+objgl2Data objgl2_readobj_ex(objgl2StreamInfo *strinfo, const objgl2LoadOptions *options);
 void objgl2_deleteobj(objgl2Data* obj);
 
+/*
+ * the BVH of a loaded object, objgl2LoadOptions' bvh builds it during the load. Building replaces the old one,
+ * refit updates its bounds after the positions changed (the indices have to stay the same), a reloader does it on a patch.
+ * A ray cast finds the nearest hit, the triangles are hit from both sides. A packet traces a few rays through the tree together,
+ * it pays off for coherent rays (a pixel block, a picking cone)
+ */
+#define OBJGL2_NOHIT ((objgl2Index)-1)
+
+typedef struct{
+	float origin[3];
+	float dir[3]; //doesn't have to be normalized, t is then in its lengths
+	float tmax; //hits further than this are ignored
+} objgl2Ray;
+
+typedef struct{
+	float t; //the hit point is origin + t * dir
+	float u, v; //barycentric coordinates of the second and the third vertex
+	objgl2Index triangle; //OBJGL2_NOHIT if the ray didn't hit anything
+	uint_least32_t material;
+} objgl2Hit;
+
+void objgl2_bvh_build(objgl2Data *obj, const objgl2Scheduler *scheduler); //scheduler may be NULL
+void objgl2_bvh_refit(objgl2Data *obj);
+char objgl2_bvh_raycast(const objgl2Data *obj, const objgl2Ray *ray, objgl2Hit *hit); //non-zero if something was hit
+void objgl2_bvh_raycast_packet(const objgl2Data *obj, const objgl2Ray *rays, uint_least32_t count, objgl2Hit *hits);
+
+/*
+ * parse and dedup without the assembly, for building your own vertex format (objgl2.hpp does).
+ * Returns NULL if the load failed (see options->error)
+ */
+typedef struct __ObjGL2Parsed objgl2Parsed;
+
+typedef struct{
+	const objgl2Data *obj; //indices, materials, name, numVertices, hasNormals, hasTexCoords; data is NULL
+	const float *positions, *texcoords, *normals; //xyz, uv, xyz
+	objgl2Index numPositions, numTexcoords, numNormals;
+	const objgl2Index *keys; //(position, texcoord, normal) of every vertex, 1-based, 0 if the face vertex didn't have it
+} objgl2ParsedInfo;
+
+objgl2Parsed* objgl2_parseobj(objgl2StreamInfo *strinfo, const objgl2LoadOptions *options);
+objgl2ParsedInfo objgl2_parsed_info(const objgl2Parsed *parsed);
+void objgl2_parsed_dropattributes(objgl2Parsed *parsed); //frees the attributes and the keys once you've built the vertices
+
+/*
+ * assembles the vertices straight into your memory (a mapped staging buffer, shared memory) instead of a malloc'd data, stride bytes apart.
+ * objgl2_parsed_info(parsed).obj has the sizes: numVertices * stride bytes for the vertices, of which vertSize each are written, and numIndices indices.
+ * stride 0 means vertSize, vertices or indices may be NULL, scheduler may be NULL. Returns 0 if stride is less than vertSize or the attributes were dropped
+ */
+char objgl2_parsed_assemble(const objgl2Parsed *parsed, void *vertices, uint_least32_t stride, objgl2Index *indices, const objgl2Scheduler *scheduler);
+void objgl2_parsed_delete(objgl2Parsed *parsed);
+
+/*
+ * automatic instancing for files that repeat a part as many o blocks (CAD and BIM exports). Every o block is read, and the blocks with the same
+ * faces, materials, texcoords and normals whose positions differ only by a translation (within tolerance on every axis, 0 - exactly) are stored once.
+ * The options work as for objgl2_readobj_ex except for the snapshots, options->bvh builds a tree per mesh. Zeroed if the load failed
+ */
+typedef struct{
+	uint_least32_t mesh; //in objgl2Instances' meshes
+	float translation[3]; //added to the mesh's positions, zeros for the block the mesh was taken from
+	const char *name; //of the o line, NULL for the faces before the first one
+} objgl2Instance;
+
+typedef struct{
+	objgl2Data *meshes; //with the positions of the first block that had them, all in the same vertex layout, without a name
+	objgl2Instance *instances; //one per o block with faces, in the file order
+	uint_least32_t numMeshes, numInstances;
+	char *strings; //pool holding the object and material names
+} objgl2Instances;
+
+objgl2Instances objgl2_readobj_instanced(objgl2StreamInfo *strinfo, const objgl2LoadOptions *options, float tolerance);
+void objgl2_deleteinstances(objgl2Instances *instances);
+
+/*
+ * push parsing, for data that can't be pulled through a stream (pipes, sockets): feed the bytes as they arrive, in pieces of any size.
+ * path is only used to find the mtllib files, NULL if there's no file. The options are copied, what they point to must outlive the parser.
+ * The progress callback gets the bytes fed so far and 0 as the total, stats->refills counts the feeds.
+ */
+typedef struct __ObjGL2Parser objgl2Parser;
+
+objgl2Parser* objgl2_parser_create(const char *path, const objgl2LoadOptions *options);
+char objgl2_parser_feed(objgl2Parser *parser, const char *bytes, uint_least32_t len); //non-zero once no more data is needed, the object ended or the load was cancelled
+objgl2Data objgl2_parser_finish(objgl2Parser *parser); //parses the last line, builds the object and deletes the parser
+void objgl2_parser_delete(objgl2Parser *parser); //throws the parse away without building the object
+
+/*
+ * loads count streams into objs[0..count) on numThreads workers (0 - one per core), the calling thread is one of them.
+ * The workers are submitted to options->scheduler, or to a thread pool created just for this batch.
+ * options->stats and options->error, if not NULL, point to arrays of count objgl2Stats and objgl2Error, one per stream.
+ * The buffers reused by a worker across the files aren't counted in the stats.
+ */
+void objgl2_readobj_batch(objgl2StreamInfo *strinfos, objgl2Data *objs, uint_least32_t count, unsigned int numThreads, const objgl2LoadOptions *options);
+
+//the default scheduler, a pool of numThreads threads (0 - one per core, minus the thread that waits, as it helps)
+objgl2Scheduler* objgl2_threadpool_create(unsigned int numThreads);
+void objgl2_threadpool_delete(objgl2Scheduler *pool);
+
+#ifdef OBJGL_FSTREAM_IMPL
+#if OBJGL_FSTREAM_IMPL
+/*
+ * hot reload: keeps the file's parse in line-aligned chunks and re-parses only the chunks that changed.
+ * If the faces didn't change, the vertices using the edited positions, texcoords or normals are patched in place,
+ * otherwise dedup and assembly run again over the cached chunks. Uses options->mtldb, scheduler and error.
+ */
+typedef struct __ObjGL2Reloader objgl2Reloader;
+
+enum{
+	OBJGL2_RELOAD_FAILED = -1, //see options->error, the previous data stays
+	OBJGL2_RELOAD_UNCHANGED,
+	OBJGL2_RELOAD_PATCHED, //same indices, some of the vertices changed, see objgl2_reloader_dirty
+	OBJGL2_RELOAD_REBUILT //the data was replaced, pointers from objgl2_reloader_data are stale
+};
+
+objgl2Reloader* objgl2_reloader_create(const char *path, const objgl2LoadOptions *options); //NULL if the first load failed
+int objgl2_reloader_update(objgl2Reloader *reloader); //cheap if the file's size and mtime didn't change
+const objgl2Data* objgl2_reloader_data(const objgl2Reloader *reloader);
+void objgl2_reloader_dirty(const objgl2Reloader *reloader, objgl2Size *begin, objgl2Size *end); //vertices patched by the last update
+void objgl2_reloader_delete(objgl2Reloader *reloader);
+
+//tells which files were written or replaced, Linux only (inotify), create returns NULL elsewhere
+typedef struct __ObjGL2Watcher objgl2Watcher;
+
+objgl2Watcher* objgl2_watcher_create(void);
+int objgl2_watcher_add(objgl2Watcher *watcher, const char *path); //returns the file's id, -1 on failure
+uint_least32_t objgl2_watcher_poll(objgl2Watcher *watcher, int timeoutMs, int *changed, uint_least32_t maxChanged); //ids of the changed files, -1 timeout waits forever
+void objgl2_watcher_delete(objgl2Watcher *watcher);
+
+/*
+ * shares the meshes loaded from the same file: a file is parsed once, even if several threads ask for it at the same time,
+ * and stays cached until it changes (path, device, inode, size and mtime) or the cache goes over its byte budget.
+ * Only the meshes nobody holds are evicted, the least recently acquired first. Uses options->mtldb, scheduler and weld.
+ */
+typedef struct __ObjGL2Cache objgl2Cache;
+
+objgl2Cache* objgl2_cache_create(uint_least64_t budget, const objgl2LoadOptions *options);
+const objgl2Data* objgl2_cache_acquire(objgl2Cache *cache, const char *path, objgl2Error *error); //NULL if the load failed, release it when you're done
+void objgl2_cache_release(objgl2Cache *cache, const objgl2Data *obj);
+void objgl2_cache_delete(objgl2Cache *cache); //everything has to be released by then
+#endif
+#endif
+
+objgl2MtlDB* objgl2_mtldb_create(void);
+void objgl2_mtldb_delete(objgl2MtlDB *db);
+uint_least32_t objgl2_mtldb_addbuffer(objgl2MtlDB *db, const char *path, const char *buffer);
+const objgl2MtlMaterial* objgl2_mtldb_find(const objgl2MtlDB *db, const char *name);
+uint_least32_t objgl2_mtldb_numtextures(const objgl2MtlDB *db);
+const char* objgl2_mtldb_texture(const objgl2MtlDB *db, uint_least32_t texture);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,561 @@
+#ifndef OBJGL2_HPP_
+#define OBJGL2_HPP_
+
+/*
+ * C++20 front end of objgl2: an owning Mesh, blocking, std::future and co_await loads,
+ * progress reporting and cancellation through std::stop_token, and load<Layout<...>>
+ * assembling straight into a vertex format chosen at compile time.
+ * objgl2.c is still compiled as C, this header only wraps objgl2.h.
+ */
+
+#include "objgl2.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace objgl2{
+
+class Cancelled : public std::runtime_error{
+public:
+	Cancelled() : std::runtime_error("objgl2: the load was cancelled"){}
+};
+
+//owns an objgl2Data, move-only
+class Mesh{
+public:
+	Mesh() noexcept : data_{}{}
+	explicit Mesh(objgl2Data data) noexcept : data_(data){}
+	Mesh(Mesh &&other) noexcept : data_(std::exchange(other.data_, objgl2Data{})){}
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	Mesh& operator=(Mesh &&other) noexcept{
+		if(this != &other){
+			reset();
+			data_ = std::exchange(other.data_, objgl2Data{});
+		}
+
+		return *this;
+	}
+
+	~Mesh(){
+		reset();
+	}
+
+	void reset() noexcept{
+		objgl2_deleteobj(&data_);
+	}
+
+	//gives up the ownership, objgl2_deleteobj is then up to you
+	objgl2Data release() noexcept{
+		return std::exchange(data_, objgl2Data{});
+	}
+
+	const objgl2Data& get() const noexcept{return data_;}
+	explicit operator bool() const noexcept{return data_.indices != nullptr;}
+
+	//interleaved, vertexSize() bytes per vertex
+	std::span<const float> vertices() const noexcept{return {data_.data, std::size_t(data_.numVertices) * data_.vertSize / sizeof(float)};}
+	std::span<const objgl2Index> indices() const noexcept{return {data_.indices, std::size_t(data_.numIndices)};}
+	std::span<const objgl2Material> materials() const noexcept{return {data_.materials, data_.numMaterials};}
+
+	objgl2Size numVertices() const noexcept{return data_.numVertices;}
+	uint_least32_t vertexSize() const noexcept{return data_.vertSize;}
+	bool hasNormals() const noexcept{return data_.hasNormals;}
+	bool hasTexCoords() const noexcept{return data_.hasTexCoords;}
+	const char* name() const noexcept{return data_.name;}
+	const objgl2Bounds& bounds() const noexcept{return data_.bounds;} //the materials have their own
+	const objgl2BVH* bvh() const noexcept{return data_.bvh;} //nullptr unless LoadOptions::bvh was set
+
+	//need the bvh, the hit's triangle is OBJGL2_NOHIT on a miss
+	bool raycast(const objgl2Ray &ray, objgl2Hit &hit) const noexcept{return objgl2_bvh_raycast(&data_, &ray, &hit);}
+	void raycast(std::span<const objgl2Ray> rays, std::span<objgl2Hit> hits) const noexcept{objgl2_bvh_raycast_packet(&data_, rays.data(), uint_least32_t(std::min(rays.size(), hits.size())), hits.data());}
+
+private:
+	objgl2Data data_;
+};
+
+//bytesTotal is 0 if the size of the stream is unknown
+using ProgressCallback = std::function<void(std::uint64_t bytesRead, std::uint64_t bytesTotal)>;
+
+//what's been loaded so far, see objgl2Snapshot, the pointers are valid only during the call
+using SnapshotCallback = std::function<void(const objgl2Snapshot &snapshot)>;
+
+struct LoadOptions{
+	std::stop_token stop; //checked at every refill, every OBJGL2_PROGRESS_CHUNK bytes of a buffer and once before dedup
+	ProgressCallback progress; //called from the loading thread
+	SnapshotCallback snapshot; //called from the loading thread every snapshotBytes
+	std::uint64_t snapshotBytes = OBJGL2_SNAPSHOT_BYTES;
+	objgl2MtlDB *mtldb = nullptr;
+	const objgl2Scheduler *scheduler = nullptr;
+	objgl2Stats *stats = nullptr;
+	const objgl2Weld *weld = nullptr; //must outlive the load
+	bool bvh = false; //builds Mesh::bvh, the layouts of load<Layout<...>> don't get one
+	unsigned int flags = 0; //OBJGL2_SKIP_TEXCOORDS, OBJGL2_SKIP_NORMALS or OBJGL2_LOAD_POSITIONS_ONLY, OBJGL2_VALIDATE, OBJGL2_ALL_OBJECTS
+	unsigned int bufferSize = 1 << 18; //file stream buffer, grows if a line doesn't fit
+};
+
+namespace detail{
+
+inline char progress(void *userdata, uint_least64_t bytesRead, uint_least64_t bytesTotal){
+	const LoadOptions *options = static_cast<const LoadOptions*>(userdata);
+
+	if(options->progress){
+		options->progress(bytesRead, bytesTotal);
+	}
+
+	return options->stop.stop_requested();
+}
+
+inline void snapshot(void *userdata, const objgl2Snapshot *snapshot){
+	static_cast<const LoadOptions*>(userdata)->snapshot(*snapshot);
+}
+
+//deletes the stream even if the load throws
+struct StreamGuard{
+	objgl2StreamInfo info;
+	~StreamGuard(){objgl2_deletestream(&info);}
+};
+
+inline objgl2LoadOptions options(const LoadOptions &options, objgl2Error *error){
+	objgl2LoadOptions c{};
+	c.mtldb = options.mtldb;
+	c.stats = options.stats;
+	c.scheduler = options.scheduler;
+	c.weld = options.weld;
+	c.bvh = options.bvh;
+	c.flags = options.flags;
+	c.error = error;
+
+	if(options.progress || options.stop.stop_possible()){
+		c.progress = progress;
+		c.userdata = const_cast<LoadOptions*>(&options);
+	}
+
+	if(options.snapshot){
+		c.snapshot = snapshot;
+		c.snapshotBytes = options.snapshotBytes;
+		c.userdata = const_cast<LoadOptions*>(&options);
+	}
+
+	return c;
+}
+
+inline void check(const objgl2Error &error){
+	if(error.code == OBJGL2_ECANCELLED){
+		throw Cancelled();
+	} else if(error.code == OBJGL2_EINDEX){
+		throw std::runtime_error(std::string(error.message) + " at line " + std::to_string(error.line));
+	} else if(error.code != OBJGL2_OK){
+		throw std::runtime_error(error.message ? error.message : "objgl2: the load failed");
+	}
+}
+
+inline Mesh load(objgl2StreamInfo &strinfo, const LoadOptions &options){
+	objgl2Error error{};
+	objgl2LoadOptions c = detail::options(options, &error);
+
+	Mesh mesh(objgl2_readobj_ex(&strinfo, &c));
+	check(error);
+
+	return mesh;
+}
+
+} //namespace detail
+
+//blocking load of a file, throws Cancelled if options.stop was requested
+inline Mesh load(const std::string &path, const LoadOptions &options = {}){
+	if(options.stop.stop_requested()){
+		throw Cancelled();
+	}
+
+	detail::StreamGuard stream{objgl2_init_filestream(const_cast<char*>(path.c_str()), options.bufferSize)};
+
+	return detail::load(stream.info, options);
+}
+
+//blocking load of the OBJ contents
+inline Mesh load_buffer(const std::string &contents, const LoadOptions &options = {}){
+	if(options.stop.stop_requested()){
+		throw Cancelled();
+	}
+
+	detail::StreamGuard stream{objgl2_init_bufferstream(const_cast<char*>(contents.c_str()))};
+
+	return detail::load(stream.info, options);
+}
+
+/*
+ * loads on a new thread. The future's destructor waits for the load like every std::async one does,
+ * request a stop first and it returns at the next chunk boundary
+ */
+inline std::future<Mesh> load_async(std::string path, LoadOptions options = {}){
+	return std::async(std::launch::async, [path = std::move(path), options = std::move(options)]{
+		return load(path, options);
+	});
+}
+
+//co_await co_load(path, options) - loads on a new thread, the coroutine is resumed on that thread
+class LoadAwaiter{
+public:
+	LoadAwaiter(std::string path, LoadOptions options) : path_(std::move(path)), options_(std::move(options)){}
+
+	bool await_ready() const noexcept{
+		return false;
+	}
+
+	void await_suspend(std::coroutine_handle<> handle){
+		std::thread([this, handle]{
+			try{
+				mesh_ = load(path_, options_);
+			} catch(...){
+				exception_ = std::current_exception();
+			}
+
+			handle.resume();
+		}).detach();
+	}
+
+	Mesh await_resume(){
+		if(exception_){
+			std::rethrow_exception(exception_);
+		}
+
+		return std::move(mesh_);
+	}
+
+private:
+	std::string path_;
+	LoadOptions options_;
+	Mesh mesh_;
+	std::exception_ptr exception_;
+};
+
+inline LoadAwaiter co_load(std::string path, LoadOptions options = {}){
+	return LoadAwaiter(std::move(path), std::move(options));
+}
+
+/*
+ * compile-time vertex layouts: load<Layout<Pos3f, UV2h, NormalOct16>>(path) returns a TypedMesh whose
+ * vertices are packed in that order, the assembly is generated for the layout with no per-vertex dispatch.
+ * Your own attribute formats just need the same three members as the ones below.
+ */
+enum class Source{
+	Position, //xyz
+	TexCoord, //uv
+	Normal //xyz
+};
+
+template<class A>
+concept VertexAttribute = requires(unsigned char *dst, const float *src){
+	{A::source} -> std::convertible_to<Source>;
+	{A::size} -> std::convertible_to<std::size_t>;
+	A::encode(dst, src); //writes A::size bytes, dst is not aligned
+};
+
+namespace detail{
+
+//round to nearest even, overflows to infinity
+inline std::uint16_t half(float value){
+	std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+	std::uint32_t sign = (bits >> 16) & 0x8000;
+	std::uint32_t mantissa = bits & 0x7FFFFF;
+	std::int32_t exponent = std::int32_t((bits >> 23) & 0xFF) - 127 + 15;
+
+	if(((bits >> 23) & 0xFF) == 0xFF){
+		return std::uint16_t(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	} else if(exponent >= 31){
+		return std::uint16_t(sign | 0x7C00);
+	} else if(exponent <= 0){
+		if(exponent < -10){
+			return std::uint16_t(sign);
+		}
+
+		mantissa |= 0x800000;
+		std::uint32_t shift = std::uint32_t(14 - exponent);
+		std::uint32_t result = mantissa >> shift;
+		std::uint32_t rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+		result += rest > halfway || (rest == halfway && (result & 1));
+
+		return std::uint16_t(sign | result);
+	}
+
+	std::uint32_t result = (std::uint32_t(exponent) << 10) | (mantissa >> 13);
+	std::uint32_t rest = mantissa & 0x1FFF;
+	result += rest > 0x1000 || (rest == 0x1000 && (result & 1));
+
+	return std::uint16_t(sign | result);
+}
+
+inline std::int16_t snorm16(float value){
+	return std::int16_t(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline std::uint16_t unorm16(float value){
+	return std::uint16_t(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+template<class T, std::size_t N>
+inline void store(unsigned char *dst, const std::array<T, N> &values){
+	std::memcpy(dst, values.data(), sizeof(T) * N);
+}
+
+} //namespace detail
+
+struct Pos3f{
+	static constexpr Source source = Source::Position;
+	static constexpr std::size_t size = 12;
+	static void encode(unsigned char *dst, const float *src){detail::store(dst, std::array<float, 3>{src[0], src[1], src[2]});}
+};
+
+struct Pos3h{
+	static constexpr Source source = Source::Position;
+	static constexpr std::size_t size = 6;
+	static void encode(unsigned char *dst, const float *src){detail::store(dst, std::array<std::uint16_t, 3>{detail::half(src[0]), detail::half(src[1]), detail::half(src[2])});}
+};
+
+struct UV2f{
+	static constexpr Source source = Source::TexCoord;
+	static constexpr std::size_t size = 8;
+	static void encode(unsigned char *dst, const float *src){detail::store(dst, std::array<float, 2>{src[0], src[1]});}
+};
+
+struct UV2h{
+	static constexpr Source source = Source::TexCoord;
+	static constexpr std::size_t size = 4;
+	static void encode(unsigned char *dst, const float *src){detail::store(dst, std::array<std::uint16_t, 2>{detail::half(src[0]), detail::half(src[1])});}
+};
+
+//clamped to [0, 1], no wrapping texture coordinates
+struct UV2unorm16{
+	static constexpr Source source = Source::TexCoord;
+	static constexpr std::size_t size = 4;
+	static void encode(unsigned char *dst, const float *src){detail::store(dst, std::array<std::uint16_t, 2>{detail::unorm16(src[0]), detail::unorm16(src[1])});}
+};
+
+struct Normal3f{
+	static constexpr Source source = Source::Normal;
+	static constexpr std::size_t size = 12;
+	static void encode(unsigned char *dst, const float *src){detail::store(dst, std::array<float, 3>{src[0], src[1], src[2]});}
+};
+
+//octahedral encoding in two snorm16s, the normal doesn't need to be normalized
+struct NormalOct16{
+	static constexpr Source source = Source::Normal;
+	static constexpr std::size_t size = 4;
+
+	static void encode(unsigned char *dst, const float *src){
+		float l1 = std::fabs(src[0]) + std::fabs(src[1]) + std::fabs(src[2]);
+		l1 = l1 > 0.0f ? l1 : 1.0f;
+
+		float x = src[0] / l1, y = src[1] / l1;
+
+		if(src[2] < 0.0f){
+			float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = fx;
+		}
+
+		detail::store(dst, std::array<std::int16_t, 2>{detail::snorm16(x), detail::snorm16(y)});
+	}
+};
+
+template<VertexAttribute... Attributes>
+struct Layout{
+	static_assert(sizeof...(Attributes) > 0, "a layout needs at least one attribute");
+
+	static constexpr std::size_t count = sizeof...(Attributes);
+	static constexpr std::size_t stride = (Attributes::size + ...);
+	static constexpr std::array<std::size_t, count> offsets = []{
+		std::array<std::size_t, count> result{};
+		std::array<std::size_t, count> sizes{Attributes::size...};
+
+		for(std::size_t i = 1; i < count; ++i){
+			result[i] = result[i - 1] + sizes[i - 1];
+		}
+
+		return result;
+	}();
+
+	template<std::size_t I>
+	using Attribute = std::tuple_element_t<I, std::tuple<Attributes...>>;
+
+	struct Vertex{
+		unsigned char bytes[stride];
+	};
+
+	static constexpr bool uses(Source source){
+		return ((Attributes::source == source) || ...);
+	}
+
+	//src - the position, texcoord and normal of the vertex
+	static void encode(unsigned char *dst, const float *const *src){
+		encode(dst, src, std::make_index_sequence<count>{});
+	}
+
+private:
+	template<std::size_t... I>
+	static void encode(unsigned char *dst, const float *const *src, std::index_sequence<I...>){
+		(Attribute<I>::encode(dst + offsets[I], src[static_cast<std::size_t>(Attribute<I>::source)]), ...);
+	}
+};
+
+//move-only, owns the vertices and the indices, materials and name of the load
+template<class L>
+class TypedMesh{
+public:
+	using Vertex = typename L::Vertex;
+
+	TypedMesh() = default;
+
+	std::span<const Vertex> vertices() const noexcept{return {vertices_.get(), numVertices_};}
+	const void* data() const noexcept{return vertices_.get();}
+	static constexpr std::size_t stride() noexcept{return L::stride;}
+
+	std::span<const objgl2Index> indices() const noexcept{return obj() ? std::span<const objgl2Index>(obj()->indices, std::size_t(obj()->numIndices)) : std::span<const objgl2Index>();}
+	std::span<const objgl2Material> materials() const noexcept{return obj() ? std::span<const objgl2Material>(obj()->materials, obj()->numMaterials) : std::span<const objgl2Material>();}
+	const char* name() const noexcept{return obj() ? obj()->name : nullptr;}
+	objgl2Bounds bounds() const noexcept{return obj() ? obj()->bounds : objgl2Bounds{};}
+
+	//whether the file had them, the layout's attributes that it didn't have are zeros
+	bool hasNormals() const noexcept{return obj() && obj()->hasNormals;}
+	bool hasTexCoords() const noexcept{return obj() && obj()->hasTexCoords;}
+
+	explicit operator bool() const noexcept{return parsed_ != nullptr;}
+
+private:
+	struct ParsedDeleter{
+		void operator()(objgl2Parsed *parsed) const noexcept{objgl2_parsed_delete(parsed);}
+	};
+
+	const objgl2Data* obj() const noexcept{return parsed_ ? objgl2_parsed_info(parsed_.get()).obj : nullptr;}
+
+	std::unique_ptr<objgl2Parsed, ParsedDeleter> parsed_;
+	std::unique_ptr<Vertex[]> vertices_;
+	std::size_t numVertices_ = 0;
+
+	template<class Layout>
+	friend TypedMesh<Layout> assemble(objgl2Parsed *parsed, const LoadOptions &options);
+};
+
+namespace detail{
+
+template<class L>
+struct Assembly{
+	unsigned char *dst;
+	const objgl2Index *keys;
+	const float *bases[3];
+	std::size_t strides[3]; //in floats, 0 for the attributes the file doesn't have, so they all read the zeros
+	std::size_t numVertices;
+
+	void run(std::size_t begin, std::size_t end) const{
+		for(std::size_t v = begin; v < end; ++v){
+			const objgl2Index *key = &keys[v * 3];
+			const float *src[3] = {
+				bases[0] + std::size_t(key[0] - 1) * strides[0],
+				bases[1] + std::size_t(key[1] - 1) * strides[1],
+				bases[2] + std::size_t(key[2] - 1) * strides[2]
+			};
+
+			L::encode(dst + v * L::stride, src);
+		}
+	}
+};
+
+//vertices per task when the options carry a scheduler
+constexpr std::size_t assemblyChunk = 65536;
+
+template<class L>
+void assembleTask(void *ctx, uint_least32_t index){
+	const Assembly<L> *assembly = static_cast<const Assembly<L>*>(ctx);
+	std::size_t begin = std::size_t(index) * assemblyChunk;
+
+	assembly->run(begin, std::min(begin + assemblyChunk, assembly->numVertices));
+}
+
+inline objgl2Parsed* parse(objgl2StreamInfo &strinfo, const LoadOptions &options){
+	objgl2Error error{};
+	objgl2LoadOptions c = detail::options(options, &error);
+
+	objgl2Parsed *parsed = objgl2_parseobj(&strinfo, &c);
+	check(error);
+
+	return parsed;
+}
+
+} //namespace detail
+
+//builds the layout's vertices from a parse, takes the ownership of parsed
+template<class L>
+TypedMesh<L> assemble(objgl2Parsed *parsed, const LoadOptions &options = {}){
+	static constexpr float zeros[3] = {};
+
+	TypedMesh<L> mesh;
+	mesh.parsed_.reset(parsed);
+
+	objgl2ParsedInfo info = objgl2_parsed_info(parsed);
+	mesh.numVertices_ = std::size_t(info.obj->numVertices);
+	mesh.vertices_ = std::make_unique_for_overwrite<typename L::Vertex[]>(mesh.numVertices_);
+
+	detail::Assembly<L> assembly{
+		mesh.vertices_.get()->bytes, info.keys,
+		{info.positions, info.obj->hasTexCoords ? info.texcoords : zeros, info.obj->hasNormals ? info.normals : zeros},
+		{3, std::size_t(info.obj->hasTexCoords ? 2 : 0), std::size_t(info.obj->hasNormals ? 3 : 0)},
+		mesh.numVertices_
+	};
+
+	if(options.scheduler && mesh.numVertices_ > detail::assemblyChunk){
+		uint_least32_t chunks = uint_least32_t((mesh.numVertices_ + detail::assemblyChunk - 1) / detail::assemblyChunk);
+		options.scheduler->wait(options.scheduler->userdata, options.scheduler->submit(options.scheduler->userdata, detail::assembleTask<L>, &assembly, chunks));
+	} else{
+		assembly.run(0, mesh.numVertices_);
+	}
+
+	objgl2_parsed_dropattributes(parsed);
+
+	return mesh;
+}
+
+template<class L>
+TypedMesh<L> load(const std::string &path, const LoadOptions &options = {}){
+	if(options.stop.stop_requested()){
+		throw Cancelled();
+	}
+
+	detail::StreamGuard stream{objgl2_init_filestream(const_cast<char*>(path.c_str()), options.bufferSize)};
+
+	return assemble<L>(detail::parse(stream.info, options), options);
+}
+
+template<class L>
+TypedMesh<L> load_buffer(const std::string &contents, const LoadOptions &options = {}){
+	if(options.stop.stop_requested()){
+		throw Cancelled();
+	}
+
+	detail::StreamGuard stream{objgl2_init_bufferstream(const_cast<char*>(contents.c_str()))};
+
+	return assemble<L>(detail::parse(stream.info, options), options);
+}
+
+} //namespace objgl2
+
+#endif
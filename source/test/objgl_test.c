@@ -0,0 +1,1171 @@
+/*
+ * Checks the loader features against what they should give, mostly a plain objgl2_readobj load of the same data.
+ * The files are generated, there's nothing to download.
+ *
+ * cc -O2 source/test/objgl_test.c source/objgl2/objgl2.c source/objgl.c -o objgl_test -lpthread -lm
+ *
+ * Add -DOBJGL_ZLIB_IMPL=1 -lz to check the gzip stream too.
+ *
+ * ./objgl_test [--tmp prefix]
+ *
+ * Prints one line per check and returns the number of the failed ones. The files go to prefix*, the working directory by default.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../objgl2/objgl2.h"
+#include "../objgl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#if OBJGL_ZLIB_IMPL
+#include <zlib.h>
+#endif
+
+typedef struct{
+	char *data;
+	size_t len, res;
+} objgl_testbuffer;
+
+static unsigned int testfailures;
+static const char *tmpprefix = "objgl_test_";
+
+static void objgl_test_check(char ok, const char *name, const char *detail){
+	printf("%s %s%s%s\n", ok ? "ok" : "FAIL", name, ok || !detail ? "" : ": ", ok || !detail ? "" : detail);
+	testfailures += !ok;
+}
+
+static void objgl_test_append(objgl_testbuffer *buf, const char *str){
+	size_t len = strlen(str);
+
+	if(buf->len + len + 1 > buf->res){
+		buf->res += buf->res + len + 1;
+		buf->data = (char*)realloc(buf->data, buf->res);
+	}
+
+	memcpy(buf->data + buf->len, str, len + 1);
+	buf->len += len;
+}
+
+static void objgl_test_printf(objgl_testbuffer *buf, const char *format, double a, double b, double c){
+	char line[128];
+	snprintf(line, sizeof(line), format, a, b, c);
+	objgl_test_append(buf, line);
+}
+
+/*
+ * a size x size grid in two materials, quads with v/vt/vn in the first half and triangles with negative
+ * indices in the second. offset moves every position along x, so the grid can be repeated as an instance
+ */
+static void objgl_test_grid(objgl_testbuffer *buf, unsigned int size, float offset){
+	for(unsigned int y = 0; y < size; ++y){
+		for(unsigned int x = 0; x < size; ++x){
+			objgl_test_printf(buf, "v %g %g %g\n", x + offset, y, (float)((x * y) % 7) * 0.125f);
+			objgl_test_printf(buf, "vt %g %g\n", (float)x / size, (float)y / size, 0);
+			objgl_test_printf(buf, "vn %g %g %g\n", 0, (float)(x % 3) * 0.5f, 1);
+		}
+	}
+
+	unsigned int half = (size - 1) / 2;
+	objgl_test_append(buf, "usemtl red\n");
+
+	for(unsigned int y = 0; y < half; ++y){
+		for(unsigned int x = 0; x + 1 < size; ++x){
+			//relative to the last vertex of the grid
+			long a = (long)(y * size + x) - (long)(size * size), b = a + 1, c = a + size + 1, d = a + size;
+			char line[256];
+			snprintf(line, sizeof(line), "f %ld/%ld/%ld %ld/%ld/%ld %ld/%ld/%ld %ld/%ld/%ld\n", a, a, a, b, b, b, c, c, c, d, d, d);
+			objgl_test_append(buf, line);
+		}
+	}
+
+	objgl_test_append(buf, "usemtl blue\n");
+
+	for(unsigned int y = half; y + 1 < size; ++y){
+		for(unsigned int x = 0; x + 1 < size; ++x){
+			long a = (long)(y * size + x) - (long)(size * size) , b = a + 1, c = a + size + 1, d = a + size;
+			char line[256];
+			snprintf(line, sizeof(line), "f %ld/%ld/%ld %ld/%ld/%ld %ld/%ld/%ld\nf %ld/%ld/%ld %ld/%ld/%ld %ld/%ld/%ld\n",
+				a, a, a, b, b, b, c, c, c, a, a, a, c, c, c, d, d, d);
+			objgl_test_append(buf, line);
+		}
+	}
+}
+
+//every '\n' becomes "\r\n", and the spaces of the v and f lines tabs if tabs is set
+static objgl_testbuffer objgl_test_convert(const char *src, char crlf, char tabs){
+	objgl_testbuffer buf = {0};
+	char lineStart = 1, vf = 0;
+	char c[3] = {0};
+
+	objgl_test_append(&buf, "");
+
+	for(; *src; ++src){
+		if(lineStart){
+			vf = *src == 'v' || *src == 'f';
+		}
+
+		lineStart = *src == '\n';
+		c[0] = *src == ' ' && tabs && vf ? '\t' : *src;
+		c[1] = '\0';
+
+		if(*src == '\n' && crlf){
+			c[0] = '\r';
+			c[1] = '\n';
+		}
+
+		objgl_test_append(&buf, c);
+	}
+
+	return buf;
+}
+
+static void objgl_test_write(const char *path, const char *data){
+	FILE *f = fopen(path, "wb");
+
+	if(f){
+		fwrite(data, 1, strlen(data), f);
+		fclose(f);
+	}
+}
+
+static const char* objgl_test_path(const char *name){
+	static char paths[8][256];
+	static unsigned int next;
+	char *path = paths[next++ % 8];
+
+	snprintf(path, 256, "%s%s", tmpprefix, name);
+
+	return path;
+}
+
+static objgl2Data objgl_test_load(const char *data, const objgl2LoadOptions *options){
+	objgl2StreamInfo strinfo = objgl2_init_bufferstream((char*)data);
+	objgl2Data obj = options ? objgl2_readobj_ex(&strinfo, options) : objgl2_readobj(&strinfo);
+	objgl2_deletestream(&strinfo);
+
+	return obj;
+}
+
+static objgl2Data objgl_test_push(const char *data, size_t chunk, const objgl2LoadOptions *options){
+	objgl2Parser *parser = objgl2_parser_create(NULL, options);
+	size_t len = strlen(data);
+
+	for(size_t i = 0; i < len; i += chunk){
+		if(objgl2_parser_feed(parser, data + i, (uint_least32_t)(len - i < chunk ? len - i : chunk))){
+			break;
+		}
+	}
+
+	return objgl2_parser_finish(parser);
+}
+
+//the same triangles with the same vertices in every material, the vertex order may differ
+static char objgl_test_same(const objgl2Data *a, const objgl2Data *b, float tolerance){
+	if(a->numIndices != b->numIndices || a->numMaterials != b->numMaterials || a->vertSize != b->vertSize ||
+		a->hasNormals != b->hasNormals || a->hasTexCoords != b->hasTexCoords){
+		return 0;
+	}
+
+	for(uint_least32_t i = 0; i < a->numMaterials; ++i){
+		const objgl2Material *ma = &a->materials[i], *mb = &b->materials[i];
+
+		if(ma->len != mb->len || (ma->name && mb->name ? strcmp(ma->name, mb->name) != 0 : ma->name != mb->name)){
+			return 0;
+		}
+
+		for(objgl2Size j = 0; j < ma->len; ++j){
+			if(ma->indices[j] >= a->numVertices || mb->indices[j] >= b->numVertices){
+				return 0;
+			}
+
+			const float *va = (const float*)((const char*)a->data + (size_t)ma->indices[j] * a->vertSize);
+			const float *vb = (const float*)((const char*)b->data + (size_t)mb->indices[j] * b->vertSize);
+
+			for(uint_least32_t k = 0; k < a->vertSize / sizeof(float); ++k){
+				if(fabsf(va[k] - vb[k]) > tolerance){
+					return 0;
+				}
+			}
+		}
+	}
+
+	return 1;
+}
+
+static void objgl_test_error(const char *name, const objgl2Data *obj, const objgl2Error *error, int code, uint_least64_t line){
+	char detail[128];
+	snprintf(detail, sizeof(detail), "code %d line %llu, expected code %d line %llu, %llu indices",
+		error->code, (unsigned long long)error->line, code, (unsigned long long)line, (unsigned long long)obj->numIndices);
+	objgl_test_check(error->code == code && error->line == line && (code == OBJGL2_OK || !obj->numIndices), name, detail);
+}
+
+static void objgl_test_stats(void){
+	//a material name starting with f and a repeated o line are not geometry
+	const char *obj = "o a\nv 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvn 0 0 1\nusemtl fv\nf 1/1/1 2/1/1 3/1/1\no a\nf 3/1/1 2/1/1 1/1/1\n# x\n";
+	objgl2Stats stats;
+	objgl2LoadOptions options = {0};
+	options.stats = &stats;
+	objgl2Data loaded = objgl_test_load(obj, &options);
+
+	objgl_test_check(stats.positionLines == 3 && stats.texcoordLines == 1 && stats.normalLines == 1 && stats.faceLines == 2 &&
+		stats.materialLines == 1 && stats.objectLines == 2 && stats.otherLines == 1, "stats, line counts", NULL);
+	objgl_test_check(stats.bytesRead == strlen(obj) && stats.allocations && stats.peakBytes >= stats.bytes, "stats, bytes and allocations", NULL);
+	objgl_test_check(loaded.numIndices == 6 && loaded.numMaterials == 1 && !strcmp(loaded.materials[0].name, "fv"), "stats, the counted load", NULL);
+	objgl2_deleteobj(&loaded);
+}
+
+static void objgl_test_batch(const objgl2Data *ref, const char *obj){
+	char bad[] = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\nf 1 2 x\n";
+	objgl_test_write(objgl_test_path("batch.obj"), obj);
+
+	objgl2StreamInfo strinfos[3] = {
+		objgl2_init_bufferstream((char*)obj),
+		objgl2_init_filestream((char*)objgl_test_path("batch.obj"), 4096),
+		objgl2_init_bufferstream(bad)
+	};
+	objgl2Data objs[3];
+	objgl2Error errors[3];
+	objgl2Stats stats[3];
+	objgl2LoadOptions options = {0};
+	options.error = errors;
+	options.stats = stats;
+
+	objgl2_readobj_batch(strinfos, objs, 3, 2, &options);
+
+	objgl_test_check(errors[0].code == OBJGL2_OK && objgl_test_same(ref, &objs[0], 0), "batch, buffer stream", NULL);
+	objgl_test_check(errors[1].code == OBJGL2_OK && objgl_test_same(ref, &objs[1], 0) && stats[1].faceLines, "batch, file stream", NULL);
+	objgl_test_error("batch, broken face", &objs[2], &errors[2], OBJGL2_EINDEX, 5);
+
+	for(int i = 0; i < 3; ++i){
+		objgl2_deleteobj(&objs[i]);
+		objgl2_deletestream(&strinfos[i]);
+	}
+
+	remove(objgl_test_path("batch.obj"));
+}
+
+static void objgl_test_streams(const objgl2Data *ref, const char *obj){
+	objgl_test_write(objgl_test_path("streams.obj"), obj);
+	objgl2StreamInfo strinfo = objgl2_init_filestream((char*)objgl_test_path("streams.obj"), 64);
+	objgl2Data file = objgl2_readobj(&strinfo);
+	objgl2_deletestream(&strinfo);
+	objgl_test_check(objgl_test_same(ref, &file, 0), "file stream with a small buffer", NULL);
+	objgl2_deleteobj(&file);
+
+	//lines a lot longer than the buffer, a comment and a face of 60 vertices
+	objgl_testbuffer longer = {0};
+	objgl_test_append(&longer, obj);
+	objgl_test_append(&longer, "#");
+
+	for(int i = 0; i < 100; ++i){
+		objgl_test_append(&longer, " comment");
+	}
+
+	objgl_test_append(&longer, "\nf");
+
+	for(int i = 0; i < 60; ++i){
+		objgl_test_printf(&longer, " %g/%g/%g", i + 1, i + 1, i + 1);
+	}
+
+	objgl_test_append(&longer, "\n");
+	objgl2Data buffer = objgl_test_load(longer.data, NULL);
+	objgl_test_write(objgl_test_path("streams.obj"), longer.data);
+	strinfo = objgl2_init_filestream((char*)objgl_test_path("streams.obj"), 64);
+	file = objgl2_readobj(&strinfo);
+	objgl2_deletestream(&strinfo);
+	objgl_test_check(buffer.numIndices == ref->numIndices + 58 * 3 && objgl_test_same(&buffer, &file, 0), "file stream, lines longer than the buffer", NULL);
+	objgl2_deleteobj(&buffer);
+	objgl2_deleteobj(&file);
+
+	free(longer.data);
+	remove(objgl_test_path("streams.obj"));
+}
+
+static void objgl_test_lines(const objgl2Data *ref, const char *obj){
+	const char *names[] = {"crlf", "tabs", "crlf and tabs"};
+
+	for(int i = 0; i < 3; ++i){
+		objgl_testbuffer converted = objgl_test_convert(obj, i != 1, i != 0);
+		objgl2Error error;
+		objgl2LoadOptions options = {0};
+		options.error = &error;
+		char name[64];
+
+		objgl2Data buffer = objgl_test_load(converted.data, &options);
+		snprintf(name, sizeof(name), "%s, buffer stream", names[i]);
+		objgl_test_check(error.code == OBJGL2_OK && objgl_test_same(ref, &buffer, 0), name, NULL);
+
+		options.flags = OBJGL2_VALIDATE;
+		objgl2Data validated = objgl_test_load(converted.data, &options);
+		snprintf(name, sizeof(name), "%s, validated", names[i]);
+		objgl_test_check(error.code == OBJGL2_OK && objgl_test_same(ref, &validated, 0), name, NULL);
+
+		objgl2_deleteobj(&buffer);
+		objgl2_deleteobj(&validated);
+		free(converted.data);
+	}
+
+	//the last line without its newline
+	objgl_testbuffer cut = {0};
+	objgl_test_append(&cut, obj);
+	cut.data[--cut.len] = '\0';
+
+	objgl2Data buffer = objgl_test_load(cut.data, NULL);
+	objgl_test_check(objgl_test_same(ref, &buffer, 0), "no final newline, buffer stream", NULL);
+	objgl2_deleteobj(&buffer);
+
+	objgl_test_write(objgl_test_path("nonl.obj"), cut.data);
+	objgl2StreamInfo strinfo = objgl2_init_filestream((char*)objgl_test_path("nonl.obj"), 4096);
+	objgl2Data file = objgl2_readobj(&strinfo);
+	objgl2_deletestream(&strinfo);
+	objgl_test_check(objgl_test_same(ref, &file, 0), "no final newline, file stream", NULL);
+	objgl2_deleteobj(&file);
+	remove(objgl_test_path("nonl.obj"));
+
+	free(cut.data);
+}
+
+//the push parser over the same data in pieces of any size, the pieces split the CRLFs too
+static void objgl_test_pushparser(const objgl2Data *ref, const char *obj){
+	const size_t chunks[] = {1, 2, 7, 4096, 1 << 30};
+	objgl_testbuffer crlf = objgl_test_convert(obj, 1, 1);
+	objgl_testbuffer cut = {0};
+	objgl_test_append(&cut, crlf.data);
+	cut.data[cut.len -= 2] = '\0';
+
+	for(unsigned int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i){
+		char name[64];
+
+		objgl2Data pushed = objgl_test_push(obj, chunks[i], NULL);
+		snprintf(name, sizeof(name), "push parser, %zu byte pieces", chunks[i]);
+		objgl_test_check(objgl_test_same(ref, &pushed, 0), name, NULL);
+		objgl2_deleteobj(&pushed);
+
+		pushed = objgl_test_push(crlf.data, chunks[i], NULL);
+		snprintf(name, sizeof(name), "push parser, crlf and tabs, %zu byte pieces", chunks[i]);
+		objgl_test_check(objgl_test_same(ref, &pushed, 0), name, NULL);
+		objgl2_deleteobj(&pushed);
+
+		//finish parses the last line
+		pushed = objgl_test_push(cut.data, chunks[i], NULL);
+		snprintf(name, sizeof(name), "push parser, no final newline, %zu byte pieces", chunks[i]);
+		objgl_test_check(objgl_test_same(ref, &pushed, 0), name, NULL);
+		objgl2_deleteobj(&pushed);
+	}
+
+	//stray bytes in a pushed face, with and without the checked mode
+	const char *stray = "v 0 0 0\r\nv 1 0 0\r\nv 0 1 0\r\nf 1 2 3\r\nf 1 2 \x01 3\r\nf 1 2 3\r\n";
+
+	for(unsigned int flags = 0; flags <= OBJGL2_VALIDATE; flags += OBJGL2_VALIDATE){
+		for(unsigned int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i){
+			objgl2Error error;
+			objgl2LoadOptions options = {0};
+			options.error = &error;
+			options.flags = flags;
+			char name[96];
+
+			objgl2Data pushed = objgl_test_push(stray, chunks[i], &options);
+			snprintf(name, sizeof(name), "push parser, stray byte in a face%s, %zu byte pieces", flags ? ", validated" : "", chunks[i]);
+			objgl_test_error(name, &pushed, &error, OBJGL2_EINDEX, 5);
+			objgl2_deleteobj(&pushed);
+		}
+	}
+
+	free(crlf.data);
+	free(cut.data);
+}
+
+typedef struct{
+	float *data;
+	objgl2Size numVertices;
+	unsigned int vertSize;
+	unsigned int count;
+	char grew; //every snapshot kept the vertices of the one before
+} objgl_testsnapshots;
+
+static void objgl_test_snapshot(void *userdata, const objgl2Snapshot *snapshot){
+	objgl_testsnapshots *s = (objgl_testsnapshots*)userdata;
+	size_t bytes = (size_t)snapshot->numVertices * snapshot->vertSize;
+
+	if(!snapshot->relayout && s->numVertices && (snapshot->vertSize != s->vertSize || snapshot->numVertices < s->numVertices ||
+		memcmp(s->data, snapshot->data, (size_t)s->numVertices * s->vertSize))){
+		s->grew = 0;
+	}
+
+	s->data = (float*)realloc(s->data, bytes + 1);
+
+	//an empty snapshot has no data
+	if(bytes){
+		memcpy(s->data, snapshot->data, bytes);
+	}
+	s->numVertices = snapshot->numVertices;
+	s->vertSize = snapshot->vertSize;
+	++s->count;
+}
+
+static void objgl_test_snapshots(const objgl2Data *ref, const char *obj){
+	objgl_testsnapshots s = {NULL, 0, 0, 0, 1};
+	objgl2LoadOptions options = {0};
+	options.snapshot = objgl_test_snapshot;
+	options.userdata = &s;
+	options.snapshotBytes = 4096;
+
+	//a buffer stream is cut into chunks only for the progress or the snapshots, so a small file has a single one
+	objgl2Data obj2 = objgl_test_load(obj, &options);
+	objgl_test_check(objgl_test_same(ref, &obj2, 0) && s.grew, "snapshots, buffer stream", NULL);
+	objgl2_deleteobj(&obj2);
+
+	s = (objgl_testsnapshots){s.data, 0, 0, 0, 1};
+	obj2 = objgl_test_push(obj, 1000, &options);
+	objgl_test_check(objgl_test_same(ref, &obj2, 0) && s.grew && s.count > 1 &&
+		s.numVertices <= obj2.numVertices && !memcmp(s.data, obj2.data, (size_t)s.numVertices * s.vertSize), "snapshots, push parser", NULL);
+	objgl2_deleteobj(&obj2);
+
+	free(s.data);
+}
+
+static void objgl_test_weld(const objgl2Data *ref, const char *obj){
+	//every position once more under a new index, the faces alternate between the copies
+	objgl_testbuffer dup = {0};
+	objgl_test_append(&dup, "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n");
+	objgl_test_append(&dup, "f 1 2 3\nf 5 7 8\nf 2 3 4\nf 6 7 8\n");
+	objgl2Data plain = objgl_test_load(dup.data, NULL);
+
+	objgl2Weld weld = {0, 0, 0};
+	objgl2LoadOptions options = {0};
+	options.weld = &weld;
+	objgl2Data welded = objgl_test_load(dup.data, &options);
+	objgl_test_check(objgl_test_same(&plain, &welded, 0) && plain.numVertices == 8 && welded.numVertices == 4, "weld, equal positions", NULL);
+	objgl2_deleteobj(&welded);
+	objgl2_deleteobj(&plain);
+
+	//nothing is this close in the grid, the welded load is the plain one
+	weld = (objgl2Weld){0.01f, 0.001f, 0.01f};
+	welded = objgl_test_load(obj, &options);
+	objgl_test_check(objgl_test_same(ref, &welded, 0) && welded.numVertices == ref->numVertices, "weld, nothing to merge", NULL);
+	objgl2_deleteobj(&welded);
+
+	//neighbours of the grid merge, every vertex stays within the tolerances of the one it replaced
+	weld = (objgl2Weld){1.5f, 0.5f, 1};
+	welded = objgl_test_load(obj, &options);
+	objgl_test_check(objgl_test_same(ref, &welded, 1.5f) && welded.numVertices < ref->numVertices, "weld, neighbours within the tolerances", NULL);
+	objgl2_deleteobj(&welded);
+
+	free(dup.data);
+}
+
+//the box is the one of the positions the faces use and the sphere holds them all
+static char objgl_test_boundsof(const objgl2Data *obj, const objgl2Material *mat, const objgl2Bounds *bounds){
+	float min[3] = {1e30f, 1e30f, 1e30f}, max[3] = {-1e30f, -1e30f, -1e30f};
+	char inside = 1;
+
+	for(uint_least32_t m = 0; m < obj->numMaterials; ++m){
+		if(mat && mat != &obj->materials[m]){
+			continue;
+		}
+
+		for(objgl2Size i = 0; i < obj->materials[m].len; ++i){
+			const float *v = (const float*)((const char*)obj->data + (size_t)obj->materials[m].indices[i] * obj->vertSize);
+			float d = 0;
+
+			for(int k = 0; k < 3; ++k){
+				min[k] = v[k] < min[k] ? v[k] : min[k];
+				max[k] = v[k] > max[k] ? v[k] : max[k];
+				d += (v[k] - bounds->center[k]) * (v[k] - bounds->center[k]);
+			}
+
+			inside = inside && sqrtf(d) <= bounds->radius * 1.0001f + 1e-5f;
+		}
+	}
+
+	for(int k = 0; k < 3; ++k){
+		inside = inside && min[k] == bounds->min[k] && max[k] == bounds->max[k];
+	}
+
+	return inside;
+}
+
+static void objgl_test_bounds(const objgl2Data *ref){
+	char ok = objgl_test_boundsof(ref, NULL, &ref->bounds);
+
+	for(uint_least32_t m = 0; m < ref->numMaterials; ++m){
+		ok = ok && objgl_test_boundsof(ref, &ref->materials[m], &ref->materials[m].bounds);
+	}
+
+	objgl_test_check(ok, "bounds of the object and of every material", NULL);
+}
+
+//nearest hit by testing every triangle of the plain load
+static float objgl_test_raycast(const objgl2Data *obj, const objgl2Ray *ray){
+	float best = ray->tmax;
+
+	for(objgl2Size t = 0; t + 2 < obj->numIndices; t += 3){
+		const float *v[3];
+
+		for(int k = 0; k < 3; ++k){
+			v[k] = (const float*)((const char*)obj->data + (size_t)obj->indices[t + k] * obj->vertSize);
+		}
+
+		float e1[3], e2[3], p[3], s[3], q[3];
+
+		for(int k = 0; k < 3; ++k){
+			e1[k] = v[1][k] - v[0][k];
+			e2[k] = v[2][k] - v[0][k];
+			s[k] = ray->origin[k] - v[0][k];
+		}
+
+		p[0] = ray->dir[1] * e2[2] - ray->dir[2] * e2[1];
+		p[1] = ray->dir[2] * e2[0] - ray->dir[0] * e2[2];
+		p[2] = ray->dir[0] * e2[1] - ray->dir[1] * e2[0];
+		float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+
+		if(fabsf(det) < 1e-12f){
+			continue;
+		}
+
+		float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / det;
+		q[0] = s[1] * e1[2] - s[2] * e1[1];
+		q[1] = s[2] * e1[0] - s[0] * e1[2];
+		q[2] = s[0] * e1[1] - s[1] * e1[0];
+		float w = (ray->dir[0] * q[0] + ray->dir[1] * q[1] + ray->dir[2] * q[2]) / det;
+		float d = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / det;
+
+		if(u >= 0 && w >= 0 && u + w <= 1 && d >= 0 && d < best){
+			best = d;
+		}
+	}
+
+	return best;
+}
+
+static void objgl_test_bvh(const objgl2Data *ref, const char *obj){
+	objgl2LoadOptions options = {0};
+	options.bvh = 1;
+	objgl2Data withbvh = objgl_test_load(obj, &options);
+	objgl2Ray packet[64];
+	objgl2Hit single[64], hits[64];
+	unsigned int misses = 0, rays = 0, packetMisses = 0;
+
+	for(float y = -0.77f; y < 12; y += 0.61f){
+		for(float x = -0.53f; x < 12; x += 0.43f){
+			objgl2Ray ray = {{x, y, 10}, {0.01f, -0.02f, -1}, 100};
+			objgl2Hit *hit = &single[rays % 64];
+			char found = objgl2_bvh_raycast(&withbvh, &ray, hit);
+			float expected = objgl_test_raycast(ref, &ray);
+
+			misses += found != (expected < ray.tmax) || (found && fabsf(hit->t - expected) > 1e-4f);
+			packet[rays % 64] = ray;
+
+			//the packet cast hits what the single rays hit
+			if(++rays % 64 == 0){
+				objgl2_bvh_raycast_packet(&withbvh, packet, 64, hits);
+
+				for(int i = 0; i < 64; ++i){
+					packetMisses += hits[i].triangle != single[i].triangle || (hits[i].triangle != OBJGL2_NOHIT && fabsf(hits[i].t - single[i].t) > 1e-4f);
+				}
+			}
+		}
+	}
+
+	char detail[64];
+	snprintf(detail, sizeof(detail), "%u of %u rays differ", misses, rays);
+	objgl_test_check(withbvh.bvh && objgl_test_same(ref, &withbvh, 0) && !misses, "bvh, rays against every triangle", detail);
+	snprintf(detail, sizeof(detail), "%u of %u rays differ", packetMisses, rays - rays % 64);
+	objgl_test_check(!packetMisses, "bvh, packets of rays", detail);
+	objgl2_deleteobj(&withbvh);
+}
+
+static void objgl_test_validate(const objgl2Data *ref, const char *obj){
+	static const struct{
+		const char *name, *data;
+		int code;
+		uint_least64_t line;
+	} cases[] = {
+		{"index 0", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\nf 0 2 3\n", OBJGL2_EINDEX, 5},
+		{"index past the positions", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n", OBJGL2_EINDEX, 4},
+		{"negative index before the first position", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf -1 -2 -4\n", OBJGL2_EINDEX, 4},
+		{"texcoord past the texcoords", "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nf 1/1 2/2 3/1\n", OBJGL2_EINDEX, 5},
+		{"index used before its position", "v 0 0 0\nv 1 0 0\nf 1 2 3\nv 0 1 0\n", OBJGL2_EINDEX, 3},
+		{"two vertices", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2\nf 1 2 3\n", OBJGL2_EINDEX, 4},
+		{"letter in a face", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 x\n", OBJGL2_EINDEX, 4},
+		{"crlf", "v 0 0 0\r\nv 1 0 0\r\nv 0 1 0\r\nf 1 2 3\r\nf 1 2 4\r\n", OBJGL2_EINDEX, 5},
+		{"tabs", "v\t0 0 0\nv 1\t0 0\nv 0 1 0\nf\t1\t2\t3\t\nf 1 2 3\n", OBJGL2_OK, 0},
+		{"no final newline", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3", OBJGL2_OK, 0},
+		{"no final newline, bad index", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 9", OBJGL2_EINDEX, 4},
+		{"garbage at the end", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3 ;", OBJGL2_EINDEX, 4},
+		{"comment after a face", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3 # a triangle\nf 1 2 3#\n", OBJGL2_OK, 0}
+	};
+
+	for(unsigned int i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i){
+		objgl2Error error;
+		objgl2LoadOptions options = {0};
+		options.error = &error;
+		options.flags = OBJGL2_VALIDATE;
+		char name[96];
+
+		objgl2Data obj2 = objgl_test_load(cases[i].data, &options);
+		snprintf(name, sizeof(name), "validate, %s", cases[i].name);
+		objgl_test_error(name, &obj2, &error, cases[i].code, cases[i].line);
+		objgl2_deleteobj(&obj2);
+
+		objgl2Data pushed = objgl_test_push(cases[i].data, 3, &options);
+		snprintf(name, sizeof(name), "validate, %s, push parser", cases[i].name);
+		objgl_test_error(name, &pushed, &error, cases[i].code, cases[i].line);
+		objgl2_deleteobj(&pushed);
+	}
+
+	objgl2Error error;
+	objgl2LoadOptions options = {0};
+	options.error = &error;
+	options.flags = OBJGL2_VALIDATE;
+	objgl2Data validated = objgl_test_load(obj, &options);
+	objgl_test_check(error.code == OBJGL2_OK && objgl_test_same(ref, &validated, 0), "validate, a valid file loads the same", NULL);
+	objgl2_deleteobj(&validated);
+}
+
+static void objgl_test_instancing(void){
+	objgl_testbuffer obj = {0}, parts[4] = {{0}};
+
+	for(int i = 0; i < 4; ++i){
+		char line[32];
+		snprintf(line, sizeof(line), "o part%d\n", i);
+		objgl_test_append(&parts[i], line);
+		objgl_test_grid(&parts[i], 6, 20.0f * i);
+		objgl_test_append(&obj, parts[i].data);
+	}
+
+	objgl2StreamInfo strinfo = objgl2_init_bufferstream(obj.data);
+	objgl2Instances inst = objgl2_readobj_instanced(&strinfo, NULL, 1e-4f);
+	objgl2_deletestream(&strinfo);
+
+	//a plain load reads the first object only, so every instance is compared with a load of its block alone
+	char same = inst.numMeshes == 1 && inst.numInstances == 4;
+
+	for(uint_least32_t i = 0; same && i < inst.numInstances; ++i){
+		const objgl2Instance *in = &inst.instances[i];
+		const objgl2Data *mesh = &inst.meshes[in->mesh];
+		objgl2Data ref = objgl_test_load(parts[i].data, NULL);
+
+		same = ref.numMaterials == mesh->numMaterials && ref.numIndices == mesh->numIndices;
+
+		for(uint_least32_t m = 0; same && m < ref.numMaterials; ++m){
+			const objgl2Material *mat = &mesh->materials[m];
+			same = mat->len == ref.materials[m].len;
+
+			for(objgl2Size k = 0; same && k < mat->len; ++k){
+				const float *a = (const float*)((const char*)mesh->data + (size_t)mat->indices[k] * mesh->vertSize);
+				const float *b = (const float*)((const char*)ref.data + (size_t)ref.materials[m].indices[k] * ref.vertSize);
+
+				for(int c = 0; c < 3; ++c){
+					same = same && fabsf(a[c] + in->translation[c] - b[c]) < 1e-4f;
+				}
+			}
+		}
+
+		objgl2_deleteobj(&ref);
+	}
+
+	objgl_test_check(same, "instancing, 4 translated copies", NULL);
+	objgl2_deleteinstances(&inst);
+
+	for(int i = 0; i < 4; ++i){
+		free(parts[i].data);
+	}
+
+	free(obj.data);
+}
+
+//objgl_loadObj gives what objgl2 gives
+static char objgl_test_samelegacy(const objgl2Data *ref, const ObjGLData *legacy){
+	if(legacy->numIndices != ref->numIndices || legacy->numVertices != ref->numVertices || legacy->vertSize != ref->vertSize ||
+		legacy->numMaterials != ref->numMaterials || legacy->hasNormals != ref->hasNormals || legacy->hasTexCoords != ref->hasTexCoords){
+		return 0;
+	}
+
+	for(unsigned int i = 0; i < legacy->numMaterials; ++i){
+		const objglMaterial *mat = &legacy->materials[i];
+
+		if(mat->len != ref->materials[i].len || (mat->name && ref->materials[i].name ? strcmp(mat->name, ref->materials[i].name) != 0 : mat->name != ref->materials[i].name)){
+			return 0;
+		}
+
+		for(unsigned int j = 0; j < mat->len; ++j){
+			if(mat->indices[j] != ref->materials[i].indices[j]){
+				return 0;
+			}
+		}
+	}
+
+	return !memcmp(legacy->data, ref->data, (size_t)ref->numVertices * ref->vertSize);
+}
+
+static void objgl_test_legacy(const objgl2Data *ref, const char *obj){
+	ObjGLData legacy = objgl_loadObj(obj);
+	objgl_test_check(objgl_test_samelegacy(ref, &legacy), "legacy objgl_loadObj", NULL);
+	objgl_delete(&legacy);
+
+	//the same file split into two objects halfway, the o lines change nothing else
+	objgl_testbuffer split = {0};
+	const char *half = strchr(obj + strlen(obj) / 2, '\n') + 1;
+	objgl_test_append(&split, "o first\n");
+	objgl_test_append(&split, obj);
+	split.len = strlen("o first\n") + (size_t)(half - obj);
+	split.data[split.len] = '\0';
+	objgl_test_append(&split, "o second\n");
+	objgl_test_append(&split, half);
+
+	ObjGLData objects = objgl_loadObj(split.data);
+	objgl_test_check(objgl_test_samelegacy(ref, &objects), "legacy objgl_loadObj, two objects", NULL);
+	objgl_delete(&objects);
+	free(split.data);
+
+	ObjGLData failed = objgl_loadObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf a b c\n");
+	objgl_test_check(!failed.data && !failed.indices && !failed.materials && !failed.numIndices && !failed.numMaterials, "legacy objgl_loadObj, a broken file gives a zeroed mesh", NULL);
+	objgl_delete(&failed);
+}
+
+static void objgl_test_assemble(const objgl2Data *ref, const char *obj){
+	objgl2StreamInfo strinfo = objgl2_init_bufferstream((char*)obj);
+	objgl2Parsed *parsed = objgl2_parseobj(&strinfo, NULL);
+	objgl2_deletestream(&strinfo);
+
+	if(!parsed){
+		objgl_test_check(0, "assemble into your own buffers", "the parse failed");
+		return;
+	}
+
+	const objgl2Data *info = objgl2_parsed_info(parsed).obj;
+	const uint_least32_t stride = 48;
+	unsigned char *vertices = (unsigned char*)malloc((size_t)info->numVertices * stride);
+	objgl2Index *indices = (objgl2Index*)malloc(sizeof(objgl2Index) * (size_t)info->numIndices);
+	memset(vertices, 0xAB, (size_t)info->numVertices * stride);
+
+	char ok = !objgl2_parsed_assemble(parsed, vertices, 4, indices, NULL) && objgl2_parsed_assemble(parsed, vertices, stride, indices, NULL);
+	ok = ok && info->numVertices == ref->numVertices && info->numIndices == ref->numIndices && info->vertSize == ref->vertSize &&
+		!memcmp(indices, ref->indices, sizeof(objgl2Index) * (size_t)ref->numIndices);
+
+	//the vertices where they should be, the bytes between them left alone
+	for(objgl2Size i = 0; ok && i < ref->numVertices; ++i){
+		ok = !memcmp(vertices + i * stride, (const char*)ref->data + (size_t)i * ref->vertSize, ref->vertSize);
+
+		for(uint_least32_t k = ref->vertSize; ok && k < stride; ++k){
+			ok = vertices[i * stride + k] == 0xAB;
+		}
+	}
+
+	objgl_test_check(ok, "assemble into your own buffers", NULL);
+
+	free(vertices);
+	free(indices);
+	objgl2_parsed_delete(parsed);
+}
+
+//ref's vertices without the skipped attributes, ref has all three
+static char objgl_test_skipped(const objgl2Data *ref, const objgl2Data *obj, unsigned int flags){
+	char texcoords = !(flags & OBJGL2_SKIP_TEXCOORDS), normals = !(flags & OBJGL2_SKIP_NORMALS);
+
+	if(obj->hasTexCoords != texcoords || obj->hasNormals != normals || obj->vertSize != sizeof(float) * (3 + 2 * texcoords + 3 * normals) ||
+		obj->numIndices != ref->numIndices || obj->numMaterials != ref->numMaterials){
+		return 0;
+	}
+
+	for(uint_least32_t m = 0; m < ref->numMaterials; ++m){
+		for(objgl2Size i = 0; i < ref->materials[m].len; ++i){
+			const float *a = (const float*)((const char*)ref->data + (size_t)ref->materials[m].indices[i] * ref->vertSize);
+			const float *b = (const float*)((const char*)obj->data + (size_t)obj->materials[m].indices[i] * obj->vertSize);
+			float expected[8];
+			int n = 0;
+
+			for(int k = 0; k < 8; ++k){
+				if(k < 3 || (k < 5 && texcoords) || (k >= 5 && normals)){
+					expected[n++] = a[k];
+				}
+			}
+
+			if(memcmp(expected, b, sizeof(float) * n)){
+				return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+static void objgl_test_skip(const objgl2Data *ref, const char *obj){
+	const unsigned int flags[3] = {OBJGL2_SKIP_TEXCOORDS, OBJGL2_SKIP_NORMALS, OBJGL2_LOAD_POSITIONS_ONLY};
+	const char *names[3] = {"skip texcoords", "skip normals", "positions only"};
+
+	for(int i = 0; i < 3; ++i){
+		objgl2LoadOptions options = {0};
+		options.flags = flags[i];
+		objgl2Data skipped = objgl_test_load(obj, &options);
+		objgl_test_check(objgl_test_skipped(ref, &skipped, flags[i]), names[i], NULL);
+		objgl2_deleteobj(&skipped);
+	}
+}
+
+//runs every task right away on the calling thread
+static void* objgl_test_submit(void *userdata, objgl2_task_ptr fn, void *ctx, uint_least32_t count){
+	for(uint_least32_t i = 0; i < count; ++i){
+		fn(ctx, i);
+	}
+
+	*(uint_least32_t*)userdata += count;
+
+	return NULL;
+}
+
+static void objgl_test_wait(void *userdata, void *handle){
+	(void)userdata;
+	(void)handle;
+}
+
+static void objgl_test_scheduler(const objgl2Data *ref, const char *obj){
+	uint_least32_t tasks = 0;
+	objgl2Scheduler calling = {&tasks, objgl_test_submit, objgl_test_wait};
+	objgl2Scheduler *pool = objgl2_threadpool_create(2);
+	const objgl2Scheduler *schedulers[2] = {&calling, pool};
+	const char *names[2] = {"scheduler, batch on your own scheduler", "scheduler, batch on a thread pool"};
+
+	for(int i = 0; i < 2; ++i){
+		objgl2StreamInfo strinfos[3] = {
+			objgl2_init_bufferstream((char*)obj),
+			objgl2_init_bufferstream((char*)obj),
+			objgl2_init_bufferstream((char*)obj)
+		};
+		objgl2Data objs[3];
+		objgl2LoadOptions options = {0};
+		options.scheduler = schedulers[i];
+
+		objgl2_readobj_batch(strinfos, objs, 3, 2, &options);
+
+		char same = 1;
+
+		for(int k = 0; k < 3; ++k){
+			same = same && objgl_test_same(ref, &objs[k], 0);
+			objgl2_deleteobj(&objs[k]);
+			objgl2_deletestream(&strinfos[k]);
+		}
+
+		objgl_test_check(same && (i || tasks), names[i], NULL);
+	}
+
+	objgl2_threadpool_delete(pool);
+}
+
+//cancels the loads of userdata bytes
+static char objgl_test_progress(void *userdata, uint_least64_t bytesRead, uint_least64_t bytesTotal){
+	(void)bytesRead;
+
+	return bytesTotal == *(const uint_least64_t*)userdata;
+}
+
+static void objgl_test_cancel(const char *obj){
+	uint_least64_t cancel = strlen(obj);
+	objgl2Error error;
+	objgl2LoadOptions options = {0};
+	options.progress = objgl_test_progress;
+	options.userdata = &cancel;
+	options.error = &error;
+
+	objgl2Data cancelled = objgl_test_load(obj, &options);
+	objgl_test_check(error.code == OBJGL2_ECANCELLED && !cancelled.numIndices && !cancelled.data, "progress, cancelled load", NULL);
+	objgl2_deleteobj(&cancelled);
+
+	//a file stream is measured by its size on disk
+	const char *path = objgl_test_path("cancel.obj");
+	objgl_test_write(path, obj);
+	objgl2StreamInfo file = objgl2_init_filestream((char*)path, 4096);
+	cancelled = objgl2_readobj_ex(&file, &options);
+	objgl2_deletestream(&file);
+	objgl_test_check(error.code == OBJGL2_ECANCELLED && !cancelled.numIndices, "progress, cancelled file stream", NULL);
+	objgl2_deleteobj(&cancelled);
+	remove(path);
+
+	//only the small file of the batch is cancelled, every stream has its own error
+	const char *small = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+	cancel = strlen(small);
+	objgl2StreamInfo strinfos[2] = {objgl2_init_bufferstream((char*)obj), objgl2_init_bufferstream((char*)small)};
+	objgl2Data objs[2];
+	objgl2Error errors[2];
+	options.error = errors;
+
+	objgl2_readobj_batch(strinfos, objs, 2, 2, &options);
+
+	objgl_test_check(errors[0].code == OBJGL2_OK && objs[0].numIndices && errors[1].code == OBJGL2_ECANCELLED && !objs[1].numIndices,
+		"progress, one cancelled file of a batch", NULL);
+
+	for(int i = 0; i < 2; ++i){
+		objgl2_deleteobj(&objs[i]);
+		objgl2_deletestream(&strinfos[i]);
+	}
+}
+
+#if OBJGL_ZLIB_IMPL
+static void objgl_test_gzip(const objgl2Data *ref, const char *obj){
+	const char *path = objgl_test_path("gzip.obj.gz");
+	gzFile f = gzopen(path, "wb");
+
+	if(f){
+		gzwrite(f, obj, (unsigned int)strlen(obj));
+		gzclose(f);
+	}
+
+	//a buffer smaller than a line, it has to grow
+	objgl2StreamInfo strinfo = objgl2_init_gzstream(path, 16);
+	objgl2Data gz = objgl2_readobj(&strinfo);
+	objgl2_deletestream(&strinfo);
+	objgl_test_check(objgl_test_same(ref, &gz, 0), "gzip stream", NULL);
+	objgl2_deleteobj(&gz);
+	remove(path);
+}
+#endif
+
+static void objgl_test_sleep(void){
+	//the mtime has to move
+	struct timespec ts = {0, 20000000};
+	nanosleep(&ts, NULL);
+}
+
+static void objgl_test_reloader(const char *obj){
+	const char *path = objgl_test_path("reload.obj");
+	objgl_testbuffer edit = {0};
+	objgl_test_append(&edit, obj);
+	objgl_test_write(path, edit.data);
+
+	objgl2Reloader *reloader = objgl2_reloader_create(path, NULL);
+	objgl2Data ref = objgl_test_load(edit.data, NULL);
+	objgl_test_check(reloader && objgl_test_same(&ref, objgl2_reloader_data(reloader), 0), "reloader, first load", NULL);
+	objgl2_deleteobj(&ref);
+
+	if(!reloader){
+		free(edit.data);
+		return;
+	}
+
+	objgl_test_check(objgl2_reloader_update(reloader) == OBJGL2_RELOAD_UNCHANGED, "reloader, unchanged file", NULL);
+
+	//a position edited in place, the same length
+	char *v = strstr(edit.data, "v 1 0 0");
+	v[2] = '7';
+	objgl_test_sleep();
+	objgl_test_write(path, edit.data);
+	int res = objgl2_reloader_update(reloader);
+	ref = objgl_test_load(edit.data, NULL);
+	objgl_test_check(res == OBJGL2_RELOAD_PATCHED && objgl_test_same(&ref, objgl2_reloader_data(reloader), 0), "reloader, patched position", NULL);
+	objgl2_deleteobj(&ref);
+
+	//a face more
+	objgl_test_append(&edit, "f 1/1/1 2/2/2 3/3/3\n");
+	objgl_test_sleep();
+	objgl_test_write(path, edit.data);
+	res = objgl2_reloader_update(reloader);
+	ref = objgl_test_load(edit.data, NULL);
+	objgl_test_check(res == OBJGL2_RELOAD_REBUILT && objgl_test_same(&ref, objgl2_reloader_data(reloader), 0), "reloader, added face", NULL);
+	objgl2_deleteobj(&ref);
+
+	objgl2_reloader_delete(reloader);
+	remove(path);
+	free(edit.data);
+}
+
+//the reloader with OBJGL2_VALIDATE rejects what a plain load rejects, at the same line, and keeps the last mesh that loaded
+static void objgl_test_reloadvalidate(void){
+	const char *path = objgl_test_path("reload_validate.obj");
+	objgl2Error error, plainError;
+	objgl2LoadOptions options = {0};
+	options.flags = OBJGL2_VALIDATE;
+	options.error = &error;
+
+	objgl_test_write(path, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 900000\n");
+	objgl2Reloader *reloader = objgl2_reloader_create(path, &options);
+	objgl_test_check(!reloader && error.code == OBJGL2_EINDEX && error.line == 4, "reloader, validate, bad first load", NULL);
+	objgl2_reloader_delete(reloader);
+
+	//big enough for several chunks, the faces at the end point back into the chunks before
+	objgl_testbuffer big = {0};
+	objgl_test_append(&big, "o grid\n");
+	objgl_test_grid(&big, 160, 0);
+	objgl_test_sleep();
+	objgl_test_write(path, big.data);
+
+	reloader = objgl2_reloader_create(path, &options);
+	objgl2Data ref = objgl_test_load(big.data, NULL);
+	objgl_test_check(reloader && objgl_test_same(&ref, objgl2_reloader_data(reloader), 0), "reloader, validate, several chunks", NULL);
+
+	if(!reloader){
+		objgl2_deleteobj(&ref);
+		free(big.data);
+		return;
+	}
+
+	static const char *const bad[] = {
+		"f 1 2 900000\n",
+		"f 1 2\n",
+		"f 1 2 x\n",
+		"f 1/1 2/0 3/3\n",
+		"f -1 -2 -99999999\n",
+		"f 1 2 25601\nv 0 0 0\n" //the v comes after the face
+	};
+	objgl2LoadOptions plainOptions = options;
+	plainOptions.error = &plainError;
+
+	for(unsigned int i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i){
+		objgl_testbuffer edit = {0};
+		objgl_test_append(&edit, big.data);
+		objgl_test_append(&edit, bad[i]);
+		objgl_test_sleep();
+		objgl_test_write(path, edit.data);
+
+		int res = objgl2_reloader_update(reloader);
+		objgl2Data plain = objgl_test_load(edit.data, &plainOptions);
+		char name[96], detail[128];
+		snprintf(name, sizeof(name), "reloader, validate, %.*s", (int)strcspn(bad[i], "\n"), bad[i]);
+		snprintf(detail, sizeof(detail), "result %d code %d line %llu, a load gives code %d line %llu",
+			res, error.code, (unsigned long long)error.line, plainError.code, (unsigned long long)plainError.line);
+		objgl_test_check(res == OBJGL2_RELOAD_FAILED && error.code == OBJGL2_EINDEX && plainError.code == OBJGL2_EINDEX && error.line == plainError.line &&
+			objgl_test_same(&ref, objgl2_reloader_data(reloader), 0), name, detail);
+		objgl2_deleteobj(&plain);
+		free(edit.data);
+	}
+
+	//a position edited after the failure, the chunks of the failed version don't describe the mesh any more
+	char *v = strstr(big.data, "v 1 0 0");
+	v[2] = '7';
+	objgl_test_sleep();
+	objgl_test_write(path, big.data);
+	int res = objgl2_reloader_update(reloader);
+	objgl2_deleteobj(&ref);
+	ref = objgl_test_load(big.data, NULL);
+	objgl_test_check(res == OBJGL2_RELOAD_REBUILT && error.code == OBJGL2_OK && objgl_test_same(&ref, objgl2_reloader_data(reloader), 0), "reloader, validate, fixed file", NULL);
+
+	//a second object ends the load, the face after it isn't checked
+	objgl_test_append(&big, "o other\nf 1 2 900000\n");
+	objgl_test_sleep();
+	objgl_test_write(path, big.data);
+	res = objgl2_reloader_update(reloader);
+	objgl_test_check(res != OBJGL2_RELOAD_FAILED && error.code == OBJGL2_OK && objgl_test_same(&ref, objgl2_reloader_data(reloader), 0), "reloader, validate, bad face after the object", NULL);
+
+	objgl2_deleteobj(&ref);
+	objgl2_reloader_delete(reloader);
+	remove(path);
+	free(big.data);
+}
+
+static void objgl_test_cache(const objgl2Data *ref, const char *obj){
+	const char *path = objgl_test_path("cache.obj");
+	objgl_test_write(path, obj);
+
+	objgl2Cache *cache = objgl2_cache_create(1 << 20, NULL);
+	objgl2Error error;
+	const objgl2Data *a = objgl2_cache_acquire(cache, path, &error);
+	const objgl2Data *b = objgl2_cache_acquire(cache, path, NULL);
+	objgl_test_check(a && a == b && objgl_test_same(ref, a, 0), "cache, shared and the same as a plain load", NULL);
+
+	const objgl2Data *missing = objgl2_cache_acquire(cache, objgl_test_path("missing.obj"), &error);
+	objgl_test_check(!missing && error.code == OBJGL2_EIO, "cache, missing file", NULL);
+
+	if(a){
+		objgl2_cache_release(cache, a);
+	}
+
+	if(b){
+		objgl2_cache_release(cache, b);
+	}
+
+	objgl2_cache_delete(cache);
+	remove(path);
+}
+
+static char objgl_test_color(const float *color, float r, float g, float b){
+	return fabsf(color[0] - r) < 1e-6f && fabsf(color[1] - g) < 1e-6f && fabsf(color[2] - b) < 1e-6f;
+}
+
+static void objgl_test_mtl(void){
+	const char *mtl = "newmtl red\nKd 1 0 0\nKa 0.5\nKs 0.25 \nKe 0 0 0.5\n"
+		"newmtl crlf\r\nKd 0 1 0\r\nKa 0.75\r\nKs\t0.5\t0.25\t0.125\r\n";
+	objgl2MtlDB *db = objgl2_mtldb_create();
+	objgl2_mtldb_addbuffer(db, objgl_test_path("colors.mtl"), mtl);
+
+	const objgl2MtlMaterial *red = objgl2_mtldb_find(db, "red"), *crlf = objgl2_mtldb_find(db, "crlf");
+
+	objgl_test_check(red && objgl_test_color(red->diffuse, 1, 0, 0), "mtl, Kd 1 0 0 stays red", NULL);
+	objgl_test_check(red && objgl_test_color(red->ambient, 0.5f, 0.5f, 0.5f), "mtl, Ka with r only is a grey", NULL);
+	objgl_test_check(red && objgl_test_color(red->specular, 0.25f, 0.25f, 0.25f), "mtl, r only with a trailing blank", NULL);
+	objgl_test_check(red && objgl_test_color(red->emissive, 0, 0, 0.5f), "mtl, zeros before the blue", NULL);
+	objgl_test_check(crlf && objgl_test_color(crlf->diffuse, 0, 1, 0), "mtl, crlf", NULL);
+	objgl_test_check(crlf && objgl_test_color(crlf->ambient, 0.75f, 0.75f, 0.75f), "mtl, r only with crlf", NULL);
+	objgl_test_check(crlf && objgl_test_color(crlf->specular, 0.5f, 0.25f, 0.125f), "mtl, tabs", NULL);
+
+	//and through a load
+	objgl2LoadOptions options = {0};
+	options.mtldb = db;
+	objgl_testbuffer obj = {0};
+	objgl_test_append(&obj, "mtllib ");
+	objgl_test_append(&obj, objgl_test_path("colors.mtl"));
+	objgl_test_append(&obj, "\nv 0 0 0\nv 1 0 0\nv 0 1 0\nusemtl red\nf 1 2 3\n");
+	objgl2Data loaded = objgl_test_load(obj.data, &options);
+	objgl_test_check(loaded.numMaterials == 1 && loaded.materials[0].mtl == red, "mtl, resolved by a load", NULL);
+	objgl2_deleteobj(&loaded);
+
+	//a directory opens but has no size, it's a missing library
+	objgl2Error error;
+	options.error = &error;
+	loaded = objgl_test_load("mtllib .\nv 0 0 0\nv 1 0 0\nv 0 1 0\nusemtl red\nf 1 2 3\n", &options);
+	objgl_test_check(error.code == OBJGL2_OK && loaded.numIndices == 3, "mtl, a directory as the library", NULL);
+	objgl2_deleteobj(&loaded);
+
+	free(obj.data);
+	objgl2_mtldb_delete(db);
+}
+
+int main(int argc, char **argv){
+	for(int i = 1; i < argc; ++i){
+		if(!strcmp(argv[i], "--tmp") && i + 1 < argc){
+			tmpprefix = argv[++i];
+		} else{
+			fprintf(stderr, "usage: %s [--tmp prefix]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	objgl_testbuffer obj = {0};
+	objgl_test_append(&obj, "# objgl test mesh\no grid\n");
+	objgl_test_grid(&obj, 12, 0);
+	objgl2Data ref = objgl_test_load(obj.data, NULL);
+
+	objgl_test_streams(&ref, obj.data);
+	objgl_test_lines(&ref, obj.data);
+	objgl_test_pushparser(&ref, obj.data);
+	objgl_test_snapshots(&ref, obj.data);
+	objgl_test_weld(&ref, obj.data);
+	objgl_test_bounds(&ref);
+	objgl_test_bvh(&ref, obj.data);
+	objgl_test_validate(&ref, obj.data);
+	objgl_test_instancing();
+	objgl_test_legacy(&ref, obj.data);
+	objgl_test_assemble(&ref, obj.data);
+	objgl_test_skip(&ref, obj.data);
+	objgl_test_stats();
+	objgl_test_batch(&ref, obj.data);
+	objgl_test_scheduler(&ref, obj.data);
+	objgl_test_cancel(obj.data);
+	objgl_test_reloader(obj.data);
+	objgl_test_reloadvalidate();
+	objgl_test_cache(&ref, obj.data);
+#if OBJGL_ZLIB_IMPL
+	objgl_test_gzip(&ref, obj.data);
+#endif
+	objgl_test_mtl();
+
+	objgl2_deleteobj(&ref);
+	free(obj.data);
+
+	printf("%u failed\n", testfailures);
+
+	return (int)testfailures;
+}